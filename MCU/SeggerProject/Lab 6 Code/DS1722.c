@@ -1,14 +1,11 @@
 // DS1722.c
-// DS1722 helpers using STM32L432KC_SPI driver. CE is ACTIVE-HIGH.
+// DS1722 helpers on the SPI1 bus manager. CE is ACTIVE-HIGH.
 
 #include "DS1722.h"
 #include "STM32L432KC_SPI.h"
 
-// Register addresses (SPI mode)
-#define DS1722_ADDR_CONFIG_R   0x00u
-#define DS1722_ADDR_TEMP_LSB   0x01u
-#define DS1722_ADDR_TEMP_MSB   0x02u
-#define DS1722_ADDR_CONFIG_W   0x80u
+// Mode 1 (CPHA=1 required), 8-bit, 5 MHz max SCK (datasheet)
+spi_dev_t ds1722_spi = { "ds1722", SPI_CE, 0, 0, 1, 8, 5000000u, 0, 0 };
 
 // CONFIG bits (format: 1 1 1  1SHOT  R2 R1 R0  SD)
 #define DS1722_SD_BIT      (1u<<0)
@@ -18,21 +15,20 @@
 #define DS1722_1SHOT_BIT   (1u<<4)
 
 // ---------- single-CE-window helpers ----------
-static inline void txn_begin(void){ spi_ce_high(); }
-static inline void txn_end(void)  { spi_ce_low();  }
+// Address byte + n data bytes in one bus transfer (polled when short)
+#define DS1722_MAX_BURST 4
 
 static void ds1722_read_burst(uint8_t start_addr, uint8_t *buf, int n){
-    txn_begin();
-    (void)spiSendReceive(start_addr);         // send start address
-    for (int i=0; i<n; i++) buf[i] = spiSendReceive(0x00);
-    txn_end();
+    uint8_t tx[1 + DS1722_MAX_BURST] = { start_addr };
+    uint8_t rx[1 + DS1722_MAX_BURST];
+    if (n > DS1722_MAX_BURST) n = DS1722_MAX_BURST;
+    spi_bus_transfer(&ds1722_spi, tx, rx, (uint16_t)(n + 1));
+    for (int i=0; i<n; i++) buf[i] = rx[1 + i];
 }
 
 static void ds1722_write1(uint8_t addr_w, uint8_t data){
-    txn_begin();
-    (void)spiSendReceive(addr_w);             // write-address (0x80)
-    (void)spiSendReceive(data);               // data
-    txn_end();
+    uint8_t tx[2] = { addr_w, data };         // write-address (0x80), data
+    spi_bus_transfer(&ds1722_spi, tx, 0, 2);
 }
 
 // ---------- public API ----------
@@ -42,7 +38,7 @@ uint8_t readConfiguration(void){
     return b;
 }
 
-void setTempConfiguration(int bits){
+uint8_t ds1722_cfg_for_bits(int bits){
     // Map bits to R2..R0 (8..12-bit)
     uint8_t r = 0;
     switch(bits){
@@ -57,8 +53,30 @@ void setTempConfiguration(int bits){
     // Build an exact CONFIG byte:
     //   top nibble must be 1110 (1SHOT=0), SD=0 (continuous), R2:R1:R0 per 'r'
     //   E0 | r gives: 8-bit=E0, 9-bit=E2, 10-bit=E4, 11-bit=E6, 12-bit=E8
-    uint8_t cfg = 0xE0u | r;
-    ds1722_write1(DS1722_ADDR_CONFIG_W, cfg);
+    return 0xE0u | r;
+}
+
+// Extract 8/9/10/11/12-bit from CONFIG (R2:R1:R0 at bits 3..1; 1xx→12)
+int ds1722_bits_from_cfg(uint8_t cfg){
+    uint8_t r = (cfg >> 1) & 0x7;
+    switch (r) {
+        case 0: return 8;
+        case 1: return 9;
+        case 2: return 10;
+        case 3: return 11;
+        default: return 12;
+    }
+}
+
+uint16_t ds1722_conv_ms(int bits){
+    static const uint16_t ms[5] = { 75, 150, 300, 600, 1200 };
+    if (bits < 8)  bits = 8;
+    if (bits > 12) bits = 12;
+    return ms[bits - 8];
+}
+
+void setTempConfiguration(int bits){
+    ds1722_write1(DS1722_ADDR_CONFIG_W, ds1722_cfg_for_bits(bits));
 
     // Optional: wait or discard one sample (12-bit worst ~1.2 s) before trusting next read.
 }
@@ -74,10 +92,13 @@ uint8_t readTempMSB(void){
     return b;
 }
 
-float ds1722_read_celsius(void){
+int16_t ds1722_read_raw(void){
     // Read LSB then MSB under one CE window; Q8.8 signed fixed point
     uint8_t buf[2];
     ds1722_read_burst(DS1722_ADDR_TEMP_LSB, buf, 2);
-    int16_t raw = (int16_t)((((uint16_t)buf[1])<<8) | buf[0]);
-    return (float)raw / 256;
+    return (int16_t)((((uint16_t)buf[1])<<8) | buf[0]);
+}
+
+float ds1722_read_celsius(void){
+    return (float)ds1722_read_raw() / 256;
 }
@@ -6,6 +6,17 @@
 #define DS1722_H
 
 #include <stdint.h>
+#include "spi_bus.h"
+
+// Bus descriptor (CE pin, mode 1, 5 MHz); add it to the spi_bus_init() table
+extern spi_dev_t ds1722_spi;
+
+// Register addresses (SPI mode). Reads auto-increment: one burst from
+// CONFIG_R returns CONFIG, TEMP_LSB, TEMP_MSB.
+#define DS1722_ADDR_CONFIG_R   0x00u
+#define DS1722_ADDR_TEMP_LSB   0x01u
+#define DS1722_ADDR_TEMP_MSB   0x02u
+#define DS1722_ADDR_CONFIG_W   0x80u
 
 // Read CONFIG register (addr 0x00)
 uint8_t readConfiguration(void);
@@ -17,7 +28,16 @@ void setTempConfiguration(int bits) ;
 uint8_t readTempLSB(void);
 uint8_t readTempMSB(void);
 
+// Combine MSB/LSB: °C in Q8.8 (integer path, see tfix.h)
+int16_t ds1722_read_raw(void);
+
 // (Optional helper) Combine MSB/LSB to °C
 float ds1722_read_celsius(void);
 
+// CONFIG byte for continuous mode at 8..12 bits, and back
+uint8_t ds1722_cfg_for_bits(int bits);
+int ds1722_bits_from_cfg(uint8_t cfg);
+// Worst-case conversion time at 8..12 bits (datasheet: 0.075 s .. 1.2 s)
+uint16_t ds1722_conv_ms(int bits);
+
 #endif
@@ -3,7 +3,12 @@
 
 #include "STM32L432KC_FLASH.h"
 
+// Wait states follow HCLK and are set by clockApply() (STM32L432KC_RCC.c)
 void configureFlash() {
-  FLASH->ACR |= FLASH_ACR_LATENCY_4WS;
   FLASH->ACR |= FLASH_ACR_PRFTEN;
-}
\ No newline at end of file
+}
+
+void flashSetLatency(uint32_t ws) {
+  FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY) | (ws << FLASH_ACR_LATENCY_Pos);
+  while (((FLASH->ACR & FLASH_ACR_LATENCY) >> FLASH_ACR_LATENCY_Pos) != ws);
+}
@@ -12,5 +12,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 void configureFlash();
+// Program the wait states and wait until the flash interface uses them
+void flashSetLatency(uint32_t ws);
 
-#endif
\ No newline at end of file
+#endif
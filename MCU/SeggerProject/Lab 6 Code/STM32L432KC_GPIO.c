@@ -42,19 +42,9 @@ int gpioPinToPort(int gpio_pin) {
  *    -- port: a GPIO port ID, e.g. GPIO_PORT_ID_A
  *    -- return: a pointer to a gpio-sized block of memory at the port "port" */
 GPIO_TypeDef * gpioPortToBase(int port) {
-  GPIO_TypeDef * port_id = 0x0;
-  switch (port) {
-    case GPIO_PORT_A:
-      port_id = (GPIO_TypeDef *) GPIOA_BASE;
-      break;
-    case GPIO_PORT_B:
-      port_id = (GPIO_TypeDef *) GPIOB_BASE;
-      break;
-    case GPIO_PORT_C:
-      port_id = (GPIO_TypeDef *) GPIOC_BASE;
-      break;
-  }
-  return port_id;
+  // Ports are GPIO_PORT_STRIDE apart; anything past C is not bonded out
+  if (port < GPIO_PORT_A || port > GPIO_PORT_C) return 0x0;
+  return GPIO_PORT_BASE(port);
 }
 
 /* Given a pin, returns a pointer to the corresponding port's base address.
@@ -101,13 +91,14 @@ void digitalWrite(int gpio_pin, int val) {
 	GPIO_TypeDef * GPIO_PORT_PTR = gpioPinToBase(gpio_pin);
 	int pin_offset = gpioPinOffset(gpio_pin);
 
+	// BSRR/BRR: single store, no read-modify-write of ODR
 	if (val == 1) {
-		GPIO_PORT_PTR->ODR |= (1 << pin_offset);
+		GPIO_PORT_PTR->BSRR = (1 << pin_offset);
 	}
 	else if (val == 0) {
-		GPIO_PORT_PTR->ODR &= ~(1 << pin_offset);
+		GPIO_PORT_PTR->BRR = (1 << pin_offset);
 	}
-	
+
 }
 
 void togglePin(int gpio_pin) {
@@ -115,6 +106,7 @@ void togglePin(int gpio_pin) {
 	GPIO_TypeDef * GPIO_PORT_PTR = gpioPinToBase(gpio_pin);
 	int pin_offset = gpioPinOffset(gpio_pin);
 
-	// Use XOR to toggle
-	GPIO_PORT_PTR->ODR ^= (1 << pin_offset);
+	// Read ODR, then set or reset through BSRR (no write-back of other pins)
+	uint32_t mask = 1u << pin_offset, odr = GPIO_PORT_PTR->ODR;
+	GPIO_PORT_PTR->BSRR = ((odr & mask) << 16) | (~odr & mask);
 }
\ No newline at end of file
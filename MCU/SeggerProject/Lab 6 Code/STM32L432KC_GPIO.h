@@ -105,4 +105,46 @@ void digitalWrite(int gpio_pin, int val);
 
 void togglePin(int gpio_pin);
 
+///////////////////////////////////////////////////////////////////////////////
+// Fast path
+//   Inline; with a constant pin ID (PA5, LED_PIN, ...) port and mask fold
+//   to constants, so each call is one load or one store. Writes go through
+//   BSRR/BRR: a single store, atomic against ISRs on the same port.
+//   Runtime pin IDs work too (shift + multiply instead of a switch).
+///////////////////////////////////////////////////////////////////////////////
+
+#define GPIO_PORT_STRIDE     (GPIOB_BASE - GPIOA_BASE)
+#define GPIO_PORT_BASE(port) ((GPIO_TypeDef *)(GPIOA_BASE + (uint32_t)(port) * GPIO_PORT_STRIDE))
+#define GPIO_PIN_BASE(pin)   GPIO_PORT_BASE((uint32_t)(pin) >> 4)
+#define GPIO_PIN_MASK(pin)   (1u << ((uint32_t)(pin) & 0x0Fu))
+
+static inline void gpioSet(int gpio_pin)   { GPIO_PIN_BASE(gpio_pin)->BSRR = GPIO_PIN_MASK(gpio_pin); }
+static inline void gpioClear(int gpio_pin) { GPIO_PIN_BASE(gpio_pin)->BRR  = GPIO_PIN_MASK(gpio_pin); }
+
+static inline void gpioWrite(int gpio_pin, int val) {
+  uint32_t m = GPIO_PIN_MASK(gpio_pin);
+  GPIO_PIN_BASE(gpio_pin)->BSRR = val ? m : (m << 16);
+}
+
+static inline int gpioRead(int gpio_pin) {
+  return (int)((GPIO_PIN_BASE(gpio_pin)->IDR >> ((uint32_t)gpio_pin & 0x0Fu)) & 1u);
+}
+
+// ODR read + one BSRR store: other pins on the port cannot be clobbered
+static inline void gpioToggle(int gpio_pin) {
+  GPIO_TypeDef *p = GPIO_PIN_BASE(gpio_pin);
+  uint32_t m = GPIO_PIN_MASK(gpio_pin), odr = p->ODR;
+  p->BSRR = ((odr & m) << 16) | (~odr & m);
+}
+
+// Port-wide batch operations (mask bit n = pin n of the port)
+static inline void gpioPortSet(GPIO_TypeDef *port, uint16_t mask)   { port->BSRR = mask; }
+static inline void gpioPortClear(GPIO_TypeDef *port, uint16_t mask) { port->BRR = mask; }
+static inline uint16_t gpioPortRead(GPIO_TypeDef *port)             { return (uint16_t)port->IDR; }
+
+// Pins in mask take their level from value, in one store
+static inline void gpioPortWrite(GPIO_TypeDef *port, uint16_t mask, uint16_t value) {
+  port->BSRR = ((uint32_t)(~value & mask) << 16) | (value & mask);
+}
+
 #endif
\ No newline at end of file
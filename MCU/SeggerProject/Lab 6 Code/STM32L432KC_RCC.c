@@ -2,36 +2,241 @@
 // Source code for RCC functions
 
 #include "STM32L432KC_RCC.h"
+#include "STM32L432KC_FLASH.h"
 
-void configurePLL() {
-   // Set clock to 80 MHz
-   // Output freq = (src_clk) * (N/M) / P
-   // (4 MHz) * (80/2) * 2  = 80 MHz
-   // M:, N:, P:
-   // Use HSI as PLLSRC
+static const uint32_t msi_hz[12] = {
+    100000, 200000, 400000, 800000, 1000000, 2000000,
+    4000000, 8000000, 16000000, 24000000, 32000000, 48000000
+};
+#define MSI_PLL_RANGE 6
 
-   RCC->CR &= ~_FLD2VAL(RCC_CR_PLLON, RCC->CR); // Turn off PLL
-   while (_FLD2VAL(RCC_CR_PLLRDY, 1) != 0); // Wait till PLL is unlocked (e.g., off)
+static const uint16_t ahb_divs[] = { 1, 2, 4, 8, 16, 64, 128, 256, 512 };
 
-   // Load configuration
-   RCC->PLLCFGR |= _VAL2FLD(RCC_PLLCFGR_PLLSRC, RCC_PLLCFGR_PLLSRC_MSI);
-   RCC->PLLCFGR |= _VAL2FLD(RCC_PLLCFGR_PLLM, 0b001); // M = 2
-   RCC->PLLCFGR |= _VAL2FLD(RCC_PLLCFGR_PLLN, 80);    // N = 80
-   RCC->PLLCFGR |= _VAL2FLD(RCC_PLLCFGR_PLLR, 0b00);  // R = 2
-   RCC->PLLCFGR |= RCC_PLLCFGR_PLLREN;                // Enable PLLCLK output
+// Highest HCLK per wait state count (RM0394 table 12)
+static const uint32_t ws_max_r1[] = { 16000000, 32000000, 48000000, 64000000, 80000000 };
+static const uint32_t ws_max_r2[] = { 6000000, 12000000, 18000000, 26000000 };
+#define R2_SYSCLK_MAX 26000000u
+#define R2_VCO_MAX    128000000u
 
-   // Enable PLL and wait until it's locked
-   RCC->CR |= RCC_CR_PLLON;
-   while(_FLD2VAL(RCC_CR_PLLRDY, RCC->CR) == 0);
+// State after reset: MSI 4 MHz, no prescalers, range 1, 0 WS
+static clock_plan_t cur = {
+    4000000, 4000000, 4000000, 4000000, 4000000, 4000000,
+    1, 1, 1, 0, MSI_PLL_RANGE, 0, 0, 0, 1, 0
+};
+
+static clock_hook_t hooks[CLOCK_MAX_HOOKS];
+static int n_hooks = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Planner
+///////////////////////////////////////////////////////////////////////////////
+
+// Is (sys, pll, vco) with AHB /div a better way to reach <= hz than *best?
+static int better(const clock_plan_t * best, uint32_t h, uint32_t sys, int pll, uint32_t vco) {
+    if (h != best->hclk) return h > best->hclk;
+    if (pll != best->pll) return !pll;
+    if (sys != best->sysclk) return sys < best->sysclk;
+    return pll && vco < CLOCK_PLL_IN_HZ * best->plln;   // M is always 1
 }
 
-void configureClock(){
-  // Configure and turn on PLL
-  configurePLL();
+static void consider(clock_plan_t * best, uint32_t hz, uint32_t sys, int pll,
+                     int range, int n, int r) {
+    uint32_t vco = pll ? CLOCK_PLL_IN_HZ * (uint32_t)n : 0;
+    for (unsigned i = 0; i < sizeof(ahb_divs) / sizeof(ahb_divs[0]); i++) {
+        uint32_t h = sys / ahb_divs[i];
+        if (h > hz || sys % ahb_divs[i]) continue;    // keep SystemCoreClock exact
+        if (!better(best, h, sys, pll, vco)) break;   // lower divisors were better
+        best->hclk = h;
+        best->sysclk = sys;
+        best->ahb_div = ahb_divs[i];
+        best->pll = (uint8_t)pll;
+        best->msirange = (uint8_t)range;
+        best->pllm = pll ? 1 : 0;
+        best->plln = (uint8_t)n;
+        best->pllr = (uint8_t)r;
+        break;
+    }
+}
+
+static uint8_t apb_div(uint32_t hclk, uint32_t max) {
+    uint8_t d = 1;
+    while (d < 16 && hclk / d > max) d <<= 1;
+    return d;
+}
+
+int clockPlan(uint32_t hz, clock_plan_t * p) {
+    clock_plan_t best = { 0 };
+    if (hz > CLOCK_MAX_HZ) hz = CLOCK_MAX_HZ;
+
+    for (int r = 0; r < 12; r++)
+        consider(&best, hz, msi_hz[r], 0, r, 0, 0);
+    for (int r = 2; r <= 8; r += 2)
+        for (int n = 16; n <= 86; n++) {           // VCO 64..344 MHz
+            uint32_t f = CLOCK_PLL_IN_HZ * (uint32_t)n / (uint32_t)r;
+            if (f <= CLOCK_MAX_HZ)
+                consider(&best, hz, f, 1, MSI_PLL_RANGE, n, r);
+        }
+    if (best.hclk == 0) return -1;
+
+    uint32_t vco = CLOCK_PLL_IN_HZ * best.plln;
+    best.vos = (best.sysclk <= R2_SYSCLK_MAX && (!best.pll || vco <= R2_VCO_MAX)) ? 2 : 1;
+    const uint32_t * ws_max = (best.vos == 2) ? ws_max_r2 : ws_max_r1;
+    best.latency = 0;
+    while (best.hclk > ws_max[best.latency]) best.latency++;
+
+    best.apb1_div = apb_div(best.hclk, CLOCK_PCLK1_MAX_HZ);
+    best.apb2_div = apb_div(best.hclk, CLOCK_PCLK2_MAX_HZ);
+    best.pclk1 = best.hclk / best.apb1_div;
+    best.pclk2 = best.hclk / best.apb2_div;
+    best.timclk1 = best.pclk1 * (best.apb1_div > 1 ? 2u : 1u);
+    best.timclk2 = best.pclk2 * (best.apb2_div > 1 ? 2u : 1u);
+    *p = best;
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Switching
+///////////////////////////////////////////////////////////////////////////////
+
+static uint32_t hpre_bits(uint16_t div) {
+    uint32_t log = 0;
+    while ((1u << log) < div) log++;
+    if (log == 0) return 0;
+    return (log > 5 ? log - 2 : log - 1) | 0x8u;  // no /32: 64 is 0b1100
+}
+
+static uint32_t ppre_bits(uint8_t div) {
+    uint32_t log = 0;
+    while ((1u << log) < div) log++;
+    return log ? ((log - 1) | 0x4u) : 0;
+}
+
+static void set_vos(uint32_t vos) {
+    PWR->CR1 = (PWR->CR1 & ~PWR_CR1_VOS) | (vos << PWR_CR1_VOS_Pos);
+    while (PWR->SR2 & PWR_SR2_VOSF);
+}
+
+static void set_sw(uint32_t sw, uint32_t sws) {
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | sw;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != sws);
+}
+
+// MSIRANGE may only change while MSI is ready (RM0394 6.4.1)
+static void set_msi(uint32_t range) {
+    while (!(RCC->CR & RCC_CR_MSIRDY));
+    RCC->CR = (RCC->CR & ~RCC_CR_MSIRANGE) | (range << RCC_CR_MSIRANGE_Pos) | RCC_CR_MSIRGSEL;
+    while (!(RCC->CR & RCC_CR_MSIRDY));
+}
+
+static void set_ahb(uint16_t div) {
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_HPRE) | (hpre_bits(div) << RCC_CFGR_HPRE_Pos);
+}
 
-  // Select PLL as clock source
-  RCC->CFGR = RCC_CFGR_SW_PLL | (RCC->CFGR & ~RCC_CFGR_SW);
-  while((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+static void set_apb(const clock_plan_t * p) {
+    RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2))
+              | (ppre_bits(p->apb1_div) << RCC_CFGR_PPRE1_Pos)
+              | (ppre_bits(p->apb2_div) << RCC_CFGR_PPRE2_Pos);
+}
+
+static void pll_off(void) {
+    RCC->CR &= ~RCC_CR_PLLON;
+    while (RCC->CR & RCC_CR_PLLRDY);
+}
+
+static void pll_on(const clock_plan_t * p) {
+    RCC->PLLCFGR = _VAL2FLD(RCC_PLLCFGR_PLLSRC, RCC_PLLCFGR_PLLSRC_MSI)
+                 | _VAL2FLD(RCC_PLLCFGR_PLLM, p->pllm - 1u)
+                 | _VAL2FLD(RCC_PLLCFGR_PLLN, p->plln)
+                 | _VAL2FLD(RCC_PLLCFGR_PLLR, p->pllr / 2u - 1u)
+                 | RCC_PLLCFGR_PLLREN;
+    RCC->CR |= RCC_CR_PLLON;
+    while (!(RCC->CR & RCC_CR_PLLRDY));
+}
+
+void clockApply(const clock_plan_t * p) {
+    for (int i = 0; i < n_hooks; i++) hooks[i](CLOCK_PRE);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (int i = 0; i < n_hooks; i++) hooks[i](CLOCK_HOLD);
+    RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
 
-  SystemCoreClockUpdate();
-}
\ No newline at end of file
+    // Going up: voltage and wait states first, for the faster of the two
+    if (p->vos == 1 && cur.vos != 1) set_vos(1);
+    if (p->latency > cur.latency) flashSetLatency(p->latency);
+
+    // Larger APB dividers go in before HCLK changes, smaller ones after
+    if (p->apb1_div > cur.apb1_div || p->apb2_div > cur.apb2_div) set_apb(p);
+
+    if (p->pll && cur.pll && p->plln == cur.plln && p->pllr == cur.pllr && p->pllm == cur.pllm) {
+        set_ahb(p->ahb_div);                        // same PLL: prescaler only
+    } else {
+        // Park on MSI (the PLL input, so 4 MHz when leaving the PLL)
+        if (cur.pll) {
+            set_sw(RCC_CFGR_SW_MSI, RCC_CFGR_SWS_MSI);
+            pll_off();
+        }
+        // Step MSI and the AHB prescaler in the order that never overshoots
+        uint32_t range = p->pll ? MSI_PLL_RANGE : p->msirange;
+        uint32_t from  = cur.pll ? MSI_PLL_RANGE : cur.msirange;
+        if (range > from) { set_ahb(p->ahb_div); set_msi(range); }
+        else              { set_msi(range); set_ahb(p->ahb_div); }
+        if (p->pll) {
+            pll_on(p);
+            set_sw(RCC_CFGR_SW_PLL, RCC_CFGR_SWS_PLL);
+        }
+    }
+
+    set_apb(p);
+
+    // Going down: wait states and voltage last
+    if (p->latency < cur.latency) flashSetLatency(p->latency);
+    if (p->vos == 2 && cur.vos != 2) set_vos(2);
+
+    cur = *p;
+    SystemCoreClock = p->hclk;
+    for (int i = 0; i < n_hooks; i++) hooks[i](CLOCK_POST);
+    __set_PRIMASK(primask);
+}
+
+uint32_t clockSetFreq(uint32_t hz) {
+    clock_plan_t p;
+    if (clockPlan(hz, &p)) return 0;
+    if (p.hclk != cur.hclk || p.sysclk != cur.sysclk || p.pll != cur.pll)
+        clockApply(&p);
+    return p.hclk;
+}
+
+const clock_plan_t * clockCurrent(void) { return &cur; }
+
+int clockOnChange(clock_hook_t hook) {
+    if (n_hooks == CLOCK_MAX_HOOKS) return -1;
+    hooks[n_hooks++] = hook;
+    return 0;
+}
+
+static void ref_init(void) {
+    RCC->CR |= RCC_CR_HSION;
+    while (!(RCC->CR & RCC_CR_HSIRDY));
+    RCC->APB1ENR1 |= RCC_APB1ENR1_LPTIM1EN;
+    RCC->CCIPR = (RCC->CCIPR & ~RCC_CCIPR_LPTIM1SEL) | (0b10 << RCC_CCIPR_LPTIM1SEL_Pos);
+    LPTIM1->CR = LPTIM_CR_ENABLE;
+    LPTIM1->ARR = 0xFFFF;                   // only writable while enabled
+    LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+}
+
+// CNT is in another clock domain: read until two reads agree. Below
+// 16 MHz HCLK it moves between any two reads, so agree means no further
+// apart than a read takes (a few HCLK cycles).
+uint16_t clockRef(void) {
+    uint32_t tol = 4u * (CLOCK_REF_HZ / SystemCoreClock) + 1u;
+    uint16_t a, b;
+    do { a = LPTIM1->CNT; b = LPTIM1->CNT; } while ((uint16_t)(b - a) > tol);
+    return a;
+}
+
+void configureClock(){
+  ref_init();
+  // 80 MHz: MSI 4 MHz / 1 * 40 / 2, range 1, 4 WS
+  clockSetFreq(CLOCK_MAX_HZ);
+}
@@ -7,11 +7,65 @@
 #include <stdint.h>
 #include <stm32l432xx.h>
 
+///////////////////////////////////////////////////////////////////////////////
+// Clock planner
+//   SYSCLK is MSI (PLL off) or the PLL fed by MSI at 4 MHz (range 6):
+//   PLLCLK = 4 MHz / M * N / R, VCO input 4..16 MHz, VCO 64..344 MHz.
+//   HCLK = SYSCLK / AHB prescaler = SystemCoreClock.
+//   Voltage range 2 (VOS=2) when SYSCLK <= 26 MHz and the VCO <= 128 MHz,
+//   flash wait states are the minimum for HCLK in that range (RM0394 3.3.3).
+///////////////////////////////////////////////////////////////////////////////
+
+#define CLOCK_MAX_HZ        80000000u
+#define CLOCK_PLL_IN_HZ     4000000u     // MSI range 6
+#define CLOCK_PCLK1_MAX_HZ  80000000u    // raise the APB prescalers above this
+#define CLOCK_PCLK2_MAX_HZ  80000000u
+#define CLOCK_MAX_HOOKS     8
+
+typedef struct {
+    uint32_t hclk;          // = SystemCoreClock after clockApply()
+    uint32_t sysclk;
+    uint32_t pclk1, pclk2;
+    uint32_t timclk1, timclk2;  // timer kernel clocks: x2 when the APB prescaler > 1
+    uint16_t ahb_div;       // 1, 2, 4, 8, 16, 64, 128, 256, 512
+    uint8_t  apb1_div, apb2_div;    // 1, 2, 4, 8, 16
+    uint8_t  pll;           // 1: SYSCLK = PLLCLK, 0: SYSCLK = MSI
+    uint8_t  msirange;      // 0..11 (100 kHz .. 48 MHz); 6 when pll
+    uint8_t  pllm, plln, pllr;
+    uint8_t  vos;           // voltage range 1 or 2
+    uint8_t  latency;       // flash wait states
+} clock_plan_t;
+
+// Hooks run around every switch, in registration order:
+//   CLOCK_PRE   interrupts enabled: finish or hold anything clocked from SYSCLK
+//   CLOCK_HOLD  interrupts masked, nothing switched yet: note where counters are
+//   CLOCK_POST  interrupts masked, SystemCoreClock already updated: reprogram
+#define CLOCK_PRE   0
+#define CLOCK_POST  1
+#define CLOCK_HOLD  2
+typedef void (*clock_hook_t)(int phase);
+
+// LPTIM1 on HSI16 (the USARTs' clock too), free running from
+// configureClock(): time that does not stop or change rate during a switch.
+// Wraps every 4.096 ms.
+#define CLOCK_REF_HZ 16000000u
+
 ///////////////////////////////////////////////////////////////////////////////
 // Function prototypes
 ///////////////////////////////////////////////////////////////////////////////
 
-void configurePLL();
 void configureClock();
 
-#endif
\ No newline at end of file
+// Fastest HCLK <= hz. Ties go to MSI (PLL off), then to the lower SYSCLK
+// and VCO. Returns 0, or -1 if nothing reachable is <= hz.
+int clockPlan(uint32_t hz, clock_plan_t * plan);
+// Switch to plan (thread code only). Raises VOS and wait states before
+// the clock goes up and lowers them after it comes down.
+void clockApply(const clock_plan_t * plan);
+// clockPlan() + clockApply(); returns the new HCLK, or 0 if hz is unreachable
+uint32_t clockSetFreq(uint32_t hz);
+const clock_plan_t * clockCurrent(void);
+int clockOnChange(clock_hook_t hook);
+uint16_t clockRef(void);
+
+#endif
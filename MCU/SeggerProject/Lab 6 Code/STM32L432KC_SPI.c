@@ -5,6 +5,9 @@
 #include "STM32L432KC_SPI.h"
 #include "STM32L432KC_RCC.h"
 
+#define SPI_DMA_RX  DMA1_Channel2
+#define SPI_DMA_TX  DMA1_Channel3
+
 // Helpers to decode PAx index quickly
 #define PIN_IDX(pin)      (gpioPinOffset(pin))
 #define IS_PA(pin)        (gpioPinToBase(pin) == GPIOA)
@@ -65,13 +68,41 @@ static void gpio_spi_init(void) {
                   | (3u << (2*PIN_IDX(SPI_MOSI))));
 }
 
+static void spi_dma_init(void) {
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+
+    // Request 1 on channels 2/3 is SPI1_RX/SPI1_TX
+    DMA1_CSELR->CSELR = (DMA1_CSELR->CSELR & ~(DMA_CSELR_C2S | DMA_CSELR_C3S))
+                      | (1u << DMA_CSELR_C2S_Pos) | (1u << DMA_CSELR_C3S_Pos);
+    SPI_DMA_RX->CCR  = 0;
+    SPI_DMA_TX->CCR  = 0;
+    SPI_DMA_RX->CPAR = (uint32_t)&SPI1->DR;
+    SPI_DMA_TX->CPAR = (uint32_t)&SPI1->DR;
+
+    // Completion = RX channel done (the last byte has been clocked in);
+    // the TX channel only interrupts on a transfer error
+    NVIC_SetPriority(DMA1_Channel2_IRQn, SPI_DMA_IRQ_PRIO);
+    NVIC_SetPriority(DMA1_Channel3_IRQn, SPI_DMA_IRQ_PRIO);
+    NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+    NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+}
+
+static int spi_wide = 0;                // frames wider than 8 bits: 16-bit DR/DMA
+
 void initSPI(int br, int cpol, int cpha) {
     gpio_spi_init();
 
     // Enable SPI1 clock
     RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
 
-    // Disable SPI before config
+    spiSetMode(br, cpol, cpha, 8);
+
+    spi_dma_init();
+}
+
+void spiSetMode(int br, int cpol, int cpha, int bits) {
+    // Let the last frame finish, then disable SPI before config
+    while (SPI1->SR & SPI_SR_BSY) {}
     SPI1->CR1 &= ~SPI_CR1_SPE;
 
     // Clean slate
@@ -92,8 +123,11 @@ void initSPI(int br, int cpol, int cpha) {
     // Software slave management (we drive CE via GPIO)
     SPI1->CR1 |= SPI_CR1_SSM | SPI_CR1_SSI;
 
-    // 8-bit frames + FRXTH (RXNE set per 8-bit)
-    SPI1->CR2 |= (7u << SPI_CR2_DS_Pos) | SPI_CR2_FRXTH;
+    // 4..16-bit frames; FRXTH (RXNE set per 8-bit) for 8 bits and below
+    if (bits < 4)  bits = 4;
+    if (bits > 16) bits = 16;
+    spi_wide = (bits > 8);
+    SPI1->CR2 |= ((uint32_t)(bits - 1) << SPI_CR2_DS_Pos) | (spi_wide ? 0 : SPI_CR2_FRXTH);
     // NSS output disabled
     SPI1->CR2 &= ~SPI_CR2_SSOE;
 
@@ -111,3 +145,90 @@ uint8_t spiSendReceive(uint8_t send) {
     // 8-bit read
     return *(volatile uint8_t *)&SPI1->DR;
 }
+
+// ---------- DMA transactions ----------
+
+static spi_txn_t * volatile spi_active = 0;
+static const uint16_t spi_zero = 0x00;  // TX source when t->tx is NULL
+static uint16_t spi_sink;               // RX target when t->rx is NULL
+
+int spiBusy(void) { return spi_active != 0; }
+
+int spiTransferAsync(spi_txn_t *t) {
+    if (t->len == 0) return -1;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (spi_active) { __set_PRIMASK(primask); return -1; }
+    spi_active = t;
+    __set_PRIMASK(primask);
+    t->busy   = 1;
+    t->status = 0;
+
+    // Drop anything left in the RX FIFO
+    while (SPI1->SR & SPI_SR_RXNE) {
+        if (spi_wide) (void)SPI1->DR;
+        else (void)*(volatile uint8_t *)&SPI1->DR;
+    }
+
+    if (t->cs != SPI_NO_CS) gpioWrite(t->cs, t->cs_low ? PIO_LOW : PIO_HIGH);
+
+    // Peripheral -> memory, 8- or 16-bit both sides per frame size
+    uint32_t size = spi_wide ? (1u << DMA_CCR_PSIZE_Pos) | (1u << DMA_CCR_MSIZE_Pos) : 0;
+    DMA1->IFCR = DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3;
+    SPI_DMA_RX->CMAR  = (uint32_t)(t->rx ? t->rx : (uint8_t *)&spi_sink);
+    SPI_DMA_RX->CNDTR = t->len;
+    SPI_DMA_RX->CCR   = size | (t->rx ? DMA_CCR_MINC : 0) | DMA_CCR_TCIE | DMA_CCR_TEIE;
+    // Memory -> peripheral
+    SPI_DMA_TX->CMAR  = (uint32_t)(t->tx ? t->tx : (const uint8_t *)&spi_zero);
+    SPI_DMA_TX->CNDTR = t->len;
+    SPI_DMA_TX->CCR   = size | DMA_CCR_DIR | (t->tx ? DMA_CCR_MINC : 0) | DMA_CCR_TEIE;
+
+    // RM0394 order: RX DMA request on, channels on, then TX DMA request on
+    SPI1->CR2 |= SPI_CR2_RXDMAEN;
+    SPI_DMA_RX->CCR |= DMA_CCR_EN;
+    SPI_DMA_TX->CCR |= DMA_CCR_EN;
+    SPI1->CR2 |= SPI_CR2_TXDMAEN;
+    return 0;
+}
+
+int spiWait(spi_txn_t *t) {
+    while (t->busy) {}
+    return t->status;
+}
+
+int spiTransfer(const uint8_t *tx, uint8_t *rx, uint16_t len, int cs) {
+    if (len < SPI_DMA_MIN_LEN) {
+        // Setup and IRQ cost more than the bytes themselves
+        if (cs != SPI_NO_CS) gpioWrite(cs, PIO_HIGH);
+        for (uint16_t i = 0; i < len; i++) {
+            uint8_t r = spiSendReceive(tx ? tx[i] : 0x00);
+            if (rx) rx[i] = r;
+        }
+        if (cs != SPI_NO_CS) gpioWrite(cs, PIO_LOW);
+        return 0;
+    }
+    spi_txn_t t = { tx, rx, len, cs, 0, 0, 0, 0, 0 };
+    while (spiTransferAsync(&t) != 0) {}
+    return spiWait(&t);
+}
+
+static void spi_dma_irq(void) {
+    uint32_t isr = DMA1->ISR;
+    if (!(isr & (DMA_ISR_TCIF2 | DMA_ISR_TEIF2 | DMA_ISR_TEIF3)) || !spi_active) return;
+    DMA1->IFCR = DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3;
+
+    SPI_DMA_RX->CCR = 0;
+    SPI_DMA_TX->CCR = 0;
+    SPI1->CR2 &= ~(SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN);
+    while (SPI1->SR & SPI_SR_BSY) {}   // last SCK edge done before CS drops
+
+    spi_txn_t *t = spi_active;
+    if (t->cs != SPI_NO_CS) gpioWrite(t->cs, t->cs_low ? PIO_HIGH : PIO_LOW);
+    t->status  = (isr & (DMA_ISR_TEIF2 | DMA_ISR_TEIF3)) ? -1 : 0;
+    spi_active = 0;
+    t->busy    = 0;
+    if (t->done) t->done(t);
+}
+
+void DMA1_Channel2_IRQHandler(void) { spi_dma_irq(); }
+void DMA1_Channel3_IRQHandler(void) { spi_dma_irq(); }
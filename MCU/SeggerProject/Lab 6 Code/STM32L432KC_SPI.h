@@ -26,11 +26,45 @@
 //  cpha = 0 or 1  (DS1722 REQUIRES cpha=1; pass 1)
 void initSPI(int br, int cpol, int cpha);
 
+// Reconfigure a running SPI1 (waits for the last frame): prescaler, mode and
+// frame size 4..16 bits. spiSendReceive() stays 8-bit; DMA transactions move
+// one uint16_t per frame when bits > 8. See spi_bus.h for per-device use.
+void spiSetMode(int br, int cpol, int cpha, int bits);
+
 // Blocking full-duplex transfer of one byte
 uint8_t spiSendReceive(uint8_t send);
 
+// ---------- DMA transactions (SPI1_RX = DMA1 ch2, SPI1_TX = DMA1 ch3) ----------
+// One transaction owns the bus from spiTransferAsync() until its completion.
+// Do not call spiSendReceive() while one is running.
+
+#define SPI_NO_CS        (-1)
+#define SPI_DMA_MIN_LEN  8      // spiTransfer(): shorter transfers are polled
+#define SPI_DMA_IRQ_PRIO 2
+
+typedef struct spi_txn spi_txn_t;
+struct spi_txn {
+    const uint8_t *tx;          // NULL: clock out 0x00
+    uint8_t       *rx;          // NULL: discard what comes in
+    uint16_t       len;         // frames (bytes for 8-bit frames), 1..65535
+    int            cs;          // GPIO pin asserted for the transfer, or SPI_NO_CS
+    void         (*done)(spi_txn_t *t);   // called from the DMA ISR, may be NULL
+    void          *arg;         // for the callback
+    volatile int   busy;        // 1 from start until completion (pollable handle)
+    volatile int   status;      // 0 ok, -1 DMA transfer error
+    uint8_t        cs_low;      // 0: cs is active-high (DS1722), 1: active-low
+};
+
+// Start t in the background. Returns 0, or -1 if the bus is busy or len is 0.
+int  spiTransferAsync(spi_txn_t *t);
+int  spiBusy(void);
+// Spin until t completes; returns t->status
+int  spiWait(spi_txn_t *t);
+// Blocking transfer under one CS window: polled below SPI_DMA_MIN_LEN, else DMA
+int  spiTransfer(const uint8_t *tx, uint8_t *rx, uint16_t len, int cs);
+
 // Manual CE control (ACTIVE-HIGH)
-static inline void spi_ce_high(void) { digitalWrite(SPI_CE, PIO_HIGH); }
-static inline void spi_ce_low(void)  { digitalWrite(SPI_CE, PIO_LOW);  }
+static inline void spi_ce_high(void) { gpioSet(SPI_CE);   }
+static inline void spi_ce_low(void)  { gpioClear(SPI_CE); }
 
 #endif // STM32L4_SPI_H
\ No newline at end of file
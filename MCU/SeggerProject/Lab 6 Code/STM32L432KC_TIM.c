@@ -4,12 +4,77 @@
 #include "STM32L432KC_TIM.h"
 #include "STM32L432KC_RCC.h"
 
+// 1 ms is ticks_per_ms counts: PSC is 16 bits, so above 65.5 MHz the
+// timer counts at 2 kHz (or faster) rather than 1 kHz
+static struct { TIM_TypeDef * tim; uint32_t ticks_per_ms; } ms_tims[TIM_MAX_MS_TIMERS];
+static int n_ms_tims = 0;
+
+uint32_t timClock(TIM_TypeDef * TIMx) {
+  const clock_plan_t * c = clockCurrent();
+  // TIM1/15/16 are on APB2, TIM2/6/7 on APB1
+  if (TIMx == TIM1 || TIMx == TIM15 || TIMx == TIM16) return c->timclk2;
+  return c->timclk1;
+}
+
+void timSetPrescaler(TIM_TypeDef * TIMx, uint32_t psc) {
+  uint32_t cnt = TIMx->CNT;
+  TIMx->PSC = psc;
+  TIMx->CR1 |= TIM_CR1_URS;   // UG reloads PSC but raises no interrupt
+  TIMx->EGR = TIM_EGR_UG;
+  TIMx->CNT = cnt;
+  TIMx->CR1 &= ~TIM_CR1_URS;
+}
+
+// UG clears the prescaler counter, so a reload alone loses the tick in
+// progress. timHold() notes a count edge against clockRef() before the
+// switch; timResume() reloads, reads clockRef() the same way right after the
+// UG and sets CNT from the time in between. The two reads lag their events
+// by the same few cycles, at the old clock and at the new one, so the bias
+// cancels over a switch and its way back.
+void timHold(TIM_TypeDef * TIMx, tim_hold_t * h) {
+  uint32_t c0 = TIMx->CNT;
+  while ((h->cnt = TIMx->CNT) == c0) { }
+  h->ref = clockRef();
+}
+
+void timResume(TIM_TypeDef * TIMx, tim_hold_t * h, uint32_t psc) {
+  TIMx->PSC = psc;
+  TIMx->CR1 |= TIM_CR1_URS;
+  TIMx->EGR = TIM_EGR_UG;                 // counts from 0, phase 0, from here
+  uint16_t ref = clockRef();
+  uint64_t tick_ps = (uint64_t)(psc + 1u) * 1000000000000ull / timClock(TIMx);
+  uint64_t ps = (uint64_t)(uint16_t)(ref - h->ref) * (1000000000000ull / CLOCK_REF_HZ)
+              + h->carry_ps;
+  h->carry_ps = (uint32_t)(ps % tick_ps);   // the counts run this late until the next switch
+  TIMx->CNT = h->cnt + (uint32_t)(ps / tick_ps) + TIMx->CNT;
+  TIMx->CR1 &= ~TIM_CR1_URS;
+}
+
+static uint32_t ms_base(TIM_TypeDef * TIMx, uint32_t * ticks_per_ms) {
+  uint32_t khz = timClock(TIMx) / 1000u;
+  uint32_t k = (khz + 65535u) / 65536u;   // smallest k with PSC + 1 <= 65536
+  *ticks_per_ms = k;
+  return khz / k - 1u;
+}
+
+static void tim_clock_hook(int phase) {
+  if (phase != CLOCK_POST) return;
+  for (int i = 0; i < n_ms_tims; i++)
+    timSetPrescaler(ms_tims[i].tim, ms_base(ms_tims[i].tim, &ms_tims[i].ticks_per_ms));
+}
+
 void initTIM(TIM_TypeDef * TIMx){
-  // Set prescaler to give 1 ms time base
-  uint32_t psc_div = (uint32_t) ((SystemCoreClock/1e3));
+  int i = 0;
+  while (i < n_ms_tims && ms_tims[i].tim != TIMx) i++;
+  if (i == n_ms_tims && n_ms_tims < TIM_MAX_MS_TIMERS) {
+    if (n_ms_tims == 0) clockOnChange(tim_clock_hook);
+    ms_tims[n_ms_tims++].tim = TIMx;
+  }
 
-  // Set prescaler division factor
-  TIMx->PSC = (psc_div - 1);
+  // Set prescaler to give 1 ms time base (integer only)
+  uint32_t ticks_per_ms;
+  TIMx->PSC = ms_base(TIMx, &ticks_per_ms);
+  if (i < n_ms_tims) ms_tims[i].ticks_per_ms = ticks_per_ms;
   // Generate an update event to update prescaler value
   TIMx->EGR |= 1;
   // Enable counter
@@ -17,10 +82,14 @@ void initTIM(TIM_TypeDef * TIMx){
 }
 
 void delay_millis(TIM_TypeDef * TIMx, uint32_t ms){
-  TIMx->ARR = ms;// Set timer max count
+  uint32_t k = 1;
+  for (int i = 0; i < n_ms_tims; i++)
+    if (ms_tims[i].tim == TIMx) k = ms_tims[i].ticks_per_ms;
+
+  TIMx->ARR = ms * k;// Set timer max count
   TIMx->EGR |= 1;     // Force update
   TIMx->SR &= ~(0x1); // Clear UIF
   TIMx->CNT = 0;      // Reset count
 
   while(!(TIMx->SR & 1)); // Wait for UIF to go high
-}
\ No newline at end of file
+}
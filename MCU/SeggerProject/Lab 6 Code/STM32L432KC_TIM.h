@@ -8,12 +8,36 @@
 #include <stm32l432xx.h>  // CMSIS device library include
 #include "STM32L432KC_GPIO.h"
 
+// Timers set up by initTIM() keep their 1 ms base across clockApply()
+// (a delay may run up to a tick long per switch)
+#define TIM_MAX_MS_TIMERS 4
 
 ///////////////////////////////////////////////////////////////////////////////
 // Function prototypes
 ///////////////////////////////////////////////////////////////////////////////
 
 void initTIM(TIM_TypeDef * TIMx);
+// Spins on TIMx: one delay at a time, CPU busy. swt_delay_ms() (swtimer.h)
+// sleeps instead and shares TIM2 with any number of timers.
 void delay_millis(TIM_TypeDef * TIMx, uint32_t ms);
+// Kernel clock of TIMx for the current clock plan
+uint32_t timClock(TIM_TypeDef * TIMx);
+// Load a new PSC now, keeping CNT and without an update interrupt. The
+// tick in progress is dropped (UG restarts the prescaler): up to one tick
+// late per call.
+void timSetPrescaler(TIM_TypeDef * TIMx, uint32_t psc);
 
-#endif
\ No newline at end of file
+// Same across a clock switch without dropping time: timHold() from a
+// CLOCK_HOLD hook (waits for the next count, up to one tick at the old
+// clock), timResume() from CLOCK_POST. Off by a few cycles per switch at
+// most; TIMx must be counting and must not reach ARR during the switch
+// (free-running timers).
+typedef struct {
+  uint32_t cnt;        // count at the edge timHold() saw
+  uint16_t ref;        // clockRef() there
+  uint32_t carry_ps;   // time past the last count the prescaler restarted from
+} tim_hold_t;
+void timHold(TIM_TypeDef * TIMx, tim_hold_t * h);
+void timResume(TIM_TypeDef * TIMx, tim_hold_t * h, uint32_t psc);
+
+#endif
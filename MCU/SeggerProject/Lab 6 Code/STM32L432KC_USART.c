@@ -5,6 +5,43 @@
 #include "STM32L432KC_USART.h"
 #include "STM32L432KC_GPIO.h"
 #include "STM32L432KC_RCC.h"
+#include <string.h>
+
+#define USART_TX_MASK (USART_TX_BUF_LEN - 1u)
+
+// Single producer (thread code) / single consumer (TXE interrupt).
+// head and tail run freely; head - tail is the fill level.
+typedef struct {
+    char              buf[USART_TX_BUF_LEN];
+    volatile uint16_t head;     // written by usartWrite()
+    volatile uint16_t tail;     // written by the TXE interrupt
+    int               queued;
+} usart_txq_t;
+
+#define USART_RX_MASK (USART_RX_BUF_LEN - 1u)
+
+// Single producer (RXNE interrupt) / single consumer (usartRead())
+typedef struct {
+    char              buf[USART_RX_BUF_LEN];
+    volatile uint16_t head;     // written by the RXNE interrupt
+    volatile uint16_t tail;     // written by usartRead()
+    uint32_t          dropped;
+    usart_rx_hook_t   rx_hook;
+    usart_tx_hook_t   tx_hook;
+} usart_rxq_t;
+
+static usart_txq_t txq[2];
+static usart_rxq_t rxq[2];
+
+static usart_txq_t * port2txq(USART_TypeDef * USART) {
+    if (USART == USART1) return &txq[0];
+    if (USART == USART2) return &txq[1];
+    return 0;
+}
+
+static usart_rxq_t * port2rxq(USART_TypeDef * USART) {
+    return (USART == USART1) ? &rxq[0] : &rxq[1];
+}
 
 USART_TypeDef * id2Port(int USART_ID) {
     USART_TypeDef * USART;
@@ -67,16 +104,102 @@ USART_TypeDef * initUSART(int USART_ID, int baud_rate) {
     USART->CR1 |= USART_CR1_UE;     // Enable USART
     USART->CR1 |= USART_CR1_TE | USART_CR1_RE; // Enable transmission and reception
 
+    // TX queue on; TXEIE is only set while there is something to send
+    usart_txq_t * q = port2txq(USART);
+    q->head = q->tail = 0;
+    q->queued = 1;
+    IRQn_Type irq = (USART_ID == USART1_ID) ? USART1_IRQn : USART2_IRQn;
+    NVIC_SetPriority(irq, USART_IRQ_PRIO);
+    NVIC_EnableIRQ(irq);
+
     return USART;
 }
 
+// Move one byte from the ring to TDR if TDR is free. Turns TXEIE off
+// once the ring is empty.
+static void usart_tx_next(USART_TypeDef * USART, usart_txq_t * q) {
+    if (!(USART->ISR & USART_ISR_TXE)) return;
+    uint16_t t = q->tail;
+    if (t == q->head) {
+        USART->CR1 &= ~USART_CR1_TXEIE;
+        return;
+    }
+    USART->TDR = q->buf[t & USART_TX_MASK];
+    q->tail = (uint16_t)(t + 1u);
+    uint16_t left = (uint16_t)(q->head - q->tail);
+    if (left == 0 || left == USART_TX_BUF_LEN / 2) {
+        usart_rxq_t * r = port2rxq(USART);
+        if (r->tx_hook) r->tx_hook();
+    }
+}
+
+// Wait for the ring to drain below `level` bytes. With interrupts masked
+// (or from an ISR) the TXE interrupt cannot run, so move bytes by hand.
+static void usart_tx_wait(USART_TypeDef * USART, usart_txq_t * q, uint16_t level) {
+    USART->CR1 |= USART_CR1_TXEIE;
+    while ((uint16_t)(q->head - q->tail) > level) {
+        if (__get_PRIMASK() || __get_IPSR()) {
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            usart_tx_next(USART, q);
+            __set_PRIMASK(primask);
+        }
+    }
+}
+
+uint32_t usartWrite(USART_TypeDef * USART, const char * data, uint32_t len) {
+    usart_txq_t * q = port2txq(USART);
+    uint32_t left = len;
+    if (!q->queued) {
+        while (left--) sendChar(USART, *data++);
+        return len;
+    }
+    while (left) {
+        uint16_t h = q->head;
+        uint32_t room = USART_TX_BUF_LEN - (uint16_t)(h - q->tail);
+        if (room == 0) {
+            usart_tx_wait(USART, q, USART_TX_BUF_LEN - 1u);
+            continue;
+        }
+        // Copy as much as fits before the end of the buffer
+        uint32_t n = USART_TX_BUF_LEN - (h & USART_TX_MASK);
+        if (n > room) n = room;
+        if (n > left) n = left;
+        memcpy(&q->buf[h & USART_TX_MASK], data, n);
+        __DMB();                        // bytes visible before head moves
+        q->head = (uint16_t)(h + n);
+        data += n;
+        left -= n;
+        USART->CR1 |= USART_CR1_TXEIE;
+    }
+    return len;
+}
+
+uint32_t usartTxPending(USART_TypeDef * USART) {
+    usart_txq_t * q = port2txq(USART);
+    return (uint16_t)(q->head - q->tail);
+}
+
+void usartFlush(USART_TypeDef * USART) {
+    usart_txq_t * q = port2txq(USART);
+    if ((uint16_t)(q->head - q->tail)) usart_tx_wait(USART, q, 0);
+    while(!(USART->ISR & USART_ISR_TC));
+}
+
+void usartTxQueue(USART_TypeDef * USART, int enable) {
+    usartFlush(USART);
+    port2txq(USART)->queued = enable;
+}
+
 void sendChar(USART_TypeDef * USART, char data){
+    usart_txq_t * q = port2txq(USART);
+    if ((uint16_t)(q->head - q->tail)) usartFlush(USART);   // keep byte order
     while(!(USART->ISR & USART_ISR_TXE));
     USART->TDR = data;
     while(!(USART->ISR & USART_ISR_TC));
 }
 
-void sendString(USART_TypeDef * USART, char * charArray){
+void sendStringBlocking(USART_TypeDef * USART, char * charArray){
 
     uint32_t i = 0;
     do{
@@ -86,6 +209,10 @@ void sendString(USART_TypeDef * USART, char * charArray){
     while(charArray[i] != 0);
 }
 
+void sendString(USART_TypeDef * USART, char * charArray){
+    usartWrite(USART, charArray, strlen(charArray));
+}
+
 char readChar(USART_TypeDef * USART) {
         char data = USART->RDR;
         return data;
@@ -98,4 +225,64 @@ void readString(USART_TypeDef * USART, char* charArray){
         i++;
     }
     while(USART->ISR & USART_ISR_RXNE);
-}
\ No newline at end of file
+}
+
+uint32_t usartTxFree(USART_TypeDef * USART) {
+    return USART_TX_BUF_LEN - usartTxPending(USART);
+}
+
+void usartOnRx(USART_TypeDef * USART, usart_rx_hook_t hook) {
+    usart_rxq_t * r = port2rxq(USART);
+    USART->CR1 &= ~USART_CR1_RXNEIE;
+    r->head = r->tail = 0;
+    r->rx_hook = hook;
+    if (hook) {
+        USART->ICR = USART_ICR_ORECF;
+        USART->CR1 |= USART_CR1_RXNEIE;
+    }
+}
+
+void usartOnTxSpace(USART_TypeDef * USART, usart_tx_hook_t hook) {
+    port2rxq(USART)->tx_hook = hook;
+}
+
+uint32_t usartRxAvail(USART_TypeDef * USART) {
+    usart_rxq_t * r = port2rxq(USART);
+    return (uint16_t)(r->head - r->tail);
+}
+
+uint32_t usartRead(USART_TypeDef * USART, char * data, uint32_t max) {
+    usart_rxq_t * r = port2rxq(USART);
+    uint16_t t = r->tail;
+    uint32_t n = 0;
+    while (n < max && t != r->head) data[n++] = r->buf[t++ & USART_RX_MASK];
+    r->tail = t;
+    return n;
+}
+
+uint32_t usartRxDropped(USART_TypeDef * USART) {
+    return port2rxq(USART)->dropped;
+}
+
+static void usart_irq(USART_TypeDef * USART, usart_txq_t * q, usart_rxq_t * r) {
+    uint32_t isr = USART->ISR;
+    if (isr & USART_ISR_ORE) {                      // also raises the RXNE interrupt
+        USART->ICR = USART_ICR_ORECF;
+        r->dropped++;
+    }
+    if ((isr & USART_ISR_RXNE) && r->rx_hook) {
+        char c = USART->RDR;
+        uint16_t h = r->head;
+        if ((uint16_t)(h - r->tail) < USART_RX_BUF_LEN) {
+            r->buf[h & USART_RX_MASK] = c;
+            r->head = (uint16_t)(h + 1u);
+        } else {
+            r->dropped++;
+        }
+        r->rx_hook(c);
+    }
+    if (USART->CR1 & USART_CR1_TXEIE) usart_tx_next(USART, q);
+}
+
+void USART1_IRQHandler(void) { usart_irq(USART1, &txq[0], &rxq[0]); }
+void USART2_IRQHandler(void) { usart_irq(USART2, &txq[1], &rxq[1]); }
@@ -11,6 +11,18 @@
 #define USART1_ID   1
 #define USART2_ID   2
 
+// Transmit queue: one ring per USART, drained by the TXE interrupt.
+// Length must be a power of two; 2 KB holds a whole Lab 6 page.
+#define USART_TX_BUF_LEN  2048
+#define USART_IRQ_PRIO    3
+// Receive queue, used once an RX hook is set (power of two)
+#define USART_RX_BUF_LEN  256
+
+// Called from the USART interrupt: each received byte (after it is queued),
+// and when the TX ring drains to half full and to empty
+typedef void (*usart_rx_hook_t)(char c);
+typedef void (*usart_tx_hook_t)(void);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Function prototypes
 ///////////////////////////////////////////////////////////////////////////////
@@ -22,4 +34,25 @@ char readChar(USART_TypeDef * USART);
 void sendString(USART_TypeDef * USART, char * charArray);
 void readString(USART_TypeDef * USART, char * charArray);
 
+// Queued transmit. usartWrite()/sendString() return once the bytes are in
+// the ring and only wait when it is full. sendChar() and
+// sendStringBlocking() drain the ring first, then wait for TC per byte.
+uint32_t usartWrite(USART_TypeDef * USART, const char * data, uint32_t len);
+void sendStringBlocking(USART_TypeDef * USART, char * charArray);
+// Wait until every queued byte has left the shift register
+void usartFlush(USART_TypeDef * USART);
+uint32_t usartTxPending(USART_TypeDef * USART);
+// 0: usartWrite()/sendString() wait for TC per byte like sendChar() (default 1)
+void usartTxQueue(USART_TypeDef * USART, int enable);
+uint32_t usartTxFree(USART_TypeDef * USART);
+
+// Interrupt-driven receive: setting a hook enables RXNEIE and the RX ring.
+// Read with usartRead() from then on, not readChar().
+void usartOnRx(USART_TypeDef * USART, usart_rx_hook_t hook);
+void usartOnTxSpace(USART_TypeDef * USART, usart_tx_hook_t hook);
+uint32_t usartRead(USART_TypeDef * USART, char * data, uint32_t max);
+uint32_t usartRxAvail(USART_TypeDef * USART);
+// Bytes lost: RX ring full, or an overrun in the peripheral
+uint32_t usartRxDropped(USART_TypeDef * USART);
+
 #endif
\ No newline at end of file
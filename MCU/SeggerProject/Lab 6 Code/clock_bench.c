@@ -0,0 +1,62 @@
+// clock_bench.c
+// Prints the plan for a range of targets, then times clockSetFreq() for
+// every pair of run/idle candidates. DWT counts at SYSCLK, which changes
+// halfway through, so the switch is timed with clockRef() (LPTIM1 on
+// HSI16, 62.5 ns per count) instead. Times include the registered driver
+// hooks (TIM15, TIM16, SPI bus), so run this after they are initialized.
+
+#include <stdio.h>
+#include "main.h"
+#include "clock_bench.h"
+
+#if CLOCK_BENCH
+
+static const uint32_t targets[] = {
+  80000000, 72000000, 64000000, 48000000, 40000000, 32000000, 26000000,
+  24000000, 16000000, 12000000, 8000000, 4000000, 2000000, 1000000, 100000
+};
+static const uint32_t pairs[] = { 80000000, 48000000, 24000000, 16000000, 4000000 };
+#define N_PAIRS (sizeof(pairs) / sizeof(pairs[0]))
+
+void clock_bench_run(void) {
+  char buf[112];
+  USART_TypeDef *U = initUSART(USART2_ID, 115200);   // HSI16: baud unaffected
+
+  sendString(U, "\r\nLab6 clock bench: plans\r\n"
+                "   target Hz      HCLK Hz  src  M  N  R  AHB  VOS  WS\r\n");
+  for (unsigned i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+    clock_plan_t p;
+    if (clockPlan(targets[i], &p)) continue;
+    snprintf(buf, sizeof(buf), "%12lu %12lu  %s %2u %2u %2u  %3u  %3u  %2u\r\n",
+             (unsigned long)targets[i], (unsigned long)p.hclk, p.pll ? "PLL" : "MSI",
+             p.pllm, p.plln, p.pllr, p.ahb_div, p.vos, p.latency);
+    sendString(U, buf);
+  }
+
+  sendString(U, "switch latency, us min/max over reps (from -> to)\r\n");
+  for (unsigned a = 0; a < N_PAIRS; a++) {
+    for (unsigned b = 0; b < N_PAIRS; b++) {
+      if (a == b) continue;
+      usartFlush(U);                      // no TXE interrupts inside the window
+      uint32_t lo = 0xFFFFFFFFu, hi = 0;
+      for (int r = 0; r < CLOCK_BENCH_REPS; r++) {
+        clockSetFreq(pairs[a]);
+        uint16_t t0 = clockRef();
+        clockSetFreq(pairs[b]);
+        uint16_t dt = (uint16_t)(clockRef() - t0);
+        if (dt < lo) lo = dt;
+        if (dt > hi) hi = dt;
+      }
+      clockSetFreq(CLOCK_MAX_HZ);
+      // 16 counts per us
+      snprintf(buf, sizeof(buf), "%9lu -> %9lu  %5lu.%u  %5lu.%u\r\n",
+               (unsigned long)pairs[a], (unsigned long)pairs[b],
+               (unsigned long)(lo / 16u), (unsigned)(lo % 16u * 10u / 16u),
+               (unsigned long)(hi / 16u), (unsigned)(hi % 16u * 10u / 16u));
+      sendString(U, buf);
+    }
+  }
+  usartFlush(U);
+}
+
+#endif // CLOCK_BENCH
@@ -0,0 +1,16 @@
+// clock_bench.h
+// Clock plans and switch latency between them (build with -DCLOCK_BENCH=1),
+// report on USART2 (ST-Link VCP)
+
+#ifndef CLOCK_BENCH_H
+#define CLOCK_BENCH_H
+
+#ifndef CLOCK_BENCH
+#define CLOCK_BENCH 0
+#endif
+
+#define CLOCK_BENCH_REPS 16
+
+void clock_bench_run(void);
+
+#endif // CLOCK_BENCH_H
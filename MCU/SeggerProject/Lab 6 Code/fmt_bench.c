@@ -0,0 +1,74 @@
+// fmt_bench.c
+// One "reading" = quantize, °C and °F at the resolution's decimals, and the
+// step: what send_page() formats per request. The float path is the code
+// main.c used before tfix (quantize_by_bits + "%.*f"); both are timed with
+// DWT over every 12-bit value from -55 to 125 °C and the strings compared.
+// Flash: link with and without this bench and compare arm-none-eabi-size;
+// the float path is what pulls soft-float and printf's %f into the image.
+
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+#include "tfix.h"
+#include "fmt_bench.h"
+
+#if FMT_BENCH
+
+static float quantize_by_bits(float tC, int bits){
+  int shift = (bits <= 8) ? 0 : (bits - 8);
+  float step = 1.0f / (float)(1u << shift);
+  float scaled = tC / step;
+  int32_t q = (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+  return q * step;
+}
+
+static void float_path(int16_t raw, int bits, char *c, char *f, char *st){
+  int dec = (bits <= 8) ? 0 : (bits - 8 > 4 ? 4 : bits - 8);
+  float tC = quantize_by_bits((float)raw / 256, bits);
+  float tF = (tC * 9.0f / 5.0f) + 32.0f;
+  snprintf(c, 16, "%.*f", dec, tC);
+  snprintf(f, 16, "%.*f", dec, tF);
+  snprintf(st, 16, "%.4f", 1.0f / (float)(1u << ((bits <= 8)? 0 : (bits - 8))));
+}
+
+static void tfix_path(int16_t raw, int bits, char *c, char *f, char *st){
+  int dec = tfix_decimals(bits);
+  int16_t q = tfix_quantize(raw, bits);
+  tfix_format(c, tfix_c_e4(q), dec);
+  tfix_format(f, tfix_f_e4(q), dec);
+  tfix_format(st, tfix_step_e4(bits), 4);
+}
+
+void fmt_bench_run(void) {
+  char buf[112];
+  char c0[16], f0[16], s0[16], c1[16], f1[16], s1[16];
+  uint32_t cyc_f = 0, cyc_t = 0, max_f = 0, max_t = 0, n = 0, bad = 0;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  USART_TypeDef *U = initUSART(USART2_ID, 115200);
+
+  for (int32_t raw = -55 * 256; raw <= 125 * 256; raw += 16, n++) {
+    uint32_t t0 = DWT->CYCCNT;
+    float_path((int16_t)raw, 12, c0, f0, s0);
+    uint32_t t1 = DWT->CYCCNT;
+    tfix_path((int16_t)raw, 12, c1, f1, s1);
+    uint32_t t2 = DWT->CYCCNT;
+    cyc_f += t1 - t0;
+    cyc_t += t2 - t1;
+    if (t1 - t0 > max_f) max_f = t1 - t0;
+    if (t2 - t1 > max_t) max_t = t2 - t1;
+    if (strcmp(c0, c1) || strcmp(f0, f1) || strcmp(s0, s1)) bad++;
+  }
+
+  snprintf(buf, sizeof(buf), "\r\nLab6 fmt bench: SYSCLK %lu Hz, %lu readings, %lu differ\r\n",
+           (unsigned long)SystemCoreClock, (unsigned long)n, (unsigned long)bad);
+  sendString(U, buf);
+  snprintf(buf, sizeof(buf), "float  mean %6lu  max %6lu cyc\r\ntfix   mean %6lu  max %6lu cyc\r\n",
+           (unsigned long)(cyc_f / n), (unsigned long)max_f,
+           (unsigned long)(cyc_t / n), (unsigned long)max_t);
+  sendString(U, buf);
+  usartFlush(U);
+}
+
+#endif // FMT_BENCH
@@ -0,0 +1,14 @@
+// fmt_bench.h
+// Temperature formatting, float snprintf vs tfix, in cycles per reading
+// (build with -DFMT_BENCH=1), report on USART2 (ST-Link VCP)
+
+#ifndef FMT_BENCH_H
+#define FMT_BENCH_H
+
+#ifndef FMT_BENCH
+#define FMT_BENCH 0
+#endif
+
+void fmt_bench_run(void);
+
+#endif // FMT_BENCH_H
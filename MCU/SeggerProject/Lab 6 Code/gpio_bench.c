@@ -0,0 +1,89 @@
+// gpio_bench.c
+// Mean DWT cycles per operation over GPIO_BENCH_OPS calls, empty-loop
+// cost subtracted. Single-pin ops on PA8, batch ops on PB0/PB1/PB5/PB6
+// (none of them used by Lab 6).
+//   legacy   the original digitalWrite()/togglePin(): switch + ODR RMW
+//   library  digitalWrite()/digitalRead()/togglePin() as they are now
+//   fast     gpioWrite()/gpioRead()/gpioToggle()/gpioPortWrite(), constant pins
+
+#include <stdio.h>
+#include "main.h"
+#include "gpio_bench.h"
+
+#if GPIO_BENCH
+
+#define BENCH_PIN  PA8
+#define BATCH_MASK ((1u << 0) | (1u << 1) | (1u << 5) | (1u << 6))
+
+// Original implementation, kept here for comparison only
+__attribute__((noinline)) static void legacy_write(int gpio_pin, int val) {
+  GPIO_TypeDef * GPIO_PORT_PTR = gpioPinToBase(gpio_pin);
+  int pin_offset = gpioPinOffset(gpio_pin);
+  if (val == 1) GPIO_PORT_PTR->ODR |= (1 << pin_offset);
+  else if (val == 0) GPIO_PORT_PTR->ODR &= ~(1 << pin_offset);
+}
+
+__attribute__((noinline)) static void legacy_toggle(int gpio_pin) {
+  GPIO_TypeDef * GPIO_PORT_PTR = gpioPinToBase(gpio_pin);
+  GPIO_PORT_PTR->ODR ^= (1 << gpioPinOffset(gpio_pin));
+}
+
+static volatile int sink;
+
+#define TIME(expr) ({                                   \
+  uint32_t t0_ = DWT->CYCCNT;                           \
+  for (int i_ = 0; i_ < GPIO_BENCH_OPS; i_++) { expr; } \
+  DWT->CYCCNT - t0_; })
+
+static void report(USART_TypeDef *U, const char *op, uint32_t loop,
+                   uint32_t legacy, uint32_t library, uint32_t fast) {
+  char buf[96];
+  uint32_t l = legacy ? (legacy - loop) * 100u / GPIO_BENCH_OPS : 0;
+  snprintf(buf, sizeof(buf), "%-12s  %4lu.%02lu  %4lu.%02lu  %4lu.%02lu\r\n", op,
+           (unsigned long)(l / 100u), (unsigned long)(l % 100u),
+           (unsigned long)((library - loop) / GPIO_BENCH_OPS),
+           (unsigned long)((library - loop) * 100u / GPIO_BENCH_OPS % 100u),
+           (unsigned long)((fast - loop) / GPIO_BENCH_OPS),
+           (unsigned long)((fast - loop) * 100u / GPIO_BENCH_OPS % 100u));
+  sendString(U, buf);
+}
+
+void gpio_bench_run(void) {
+  char buf[96];
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  USART_TypeDef *U = initUSART(USART2_ID, 115200);
+
+  pinMode(BENCH_PIN, GPIO_OUTPUT);
+  pinMode(PB0, GPIO_OUTPUT); pinMode(PB1, GPIO_OUTPUT);
+  pinMode(PB5, GPIO_OUTPUT); pinMode(PB6, GPIO_OUTPUT);
+
+  uint32_t loop = TIME(__asm volatile(""));
+
+  snprintf(buf, sizeof(buf), "\r\nLab6 GPIO bench: SYSCLK %lu Hz, cycles per op (loop %lu/%d)\r\n",
+           (unsigned long)SystemCoreClock, (unsigned long)loop, GPIO_BENCH_OPS);
+  sendString(U, buf);
+  sendString(U, "op              legacy   library      fast\r\n");
+
+  report(U, "write", loop,
+         TIME(legacy_write(BENCH_PIN, i_ & 1)),
+         TIME(digitalWrite(BENCH_PIN, i_ & 1)),
+         TIME(gpioWrite(BENCH_PIN, i_ & 1)));
+  report(U, "read", loop, 0,
+         TIME(sink = digitalRead(BENCH_PIN)),
+         TIME(sink = gpioRead(BENCH_PIN)));
+  report(U, "toggle", loop,
+         TIME(legacy_toggle(BENCH_PIN)),
+         TIME(togglePin(BENCH_PIN)),
+         TIME(gpioToggle(BENCH_PIN)));
+  // 4 pins on one port to a pattern: 4 calls vs one BSRR store
+  report(U, "batch write4", loop,
+         TIME(legacy_write(PB0, i_ & 1); legacy_write(PB1, ~i_ & 1);
+              legacy_write(PB5, i_ & 1); legacy_write(PB6, ~i_ & 1)),
+         TIME(digitalWrite(PB0, i_ & 1); digitalWrite(PB1, ~i_ & 1);
+              digitalWrite(PB5, i_ & 1); digitalWrite(PB6, ~i_ & 1)),
+         TIME(gpioPortWrite(GPIOB, BATCH_MASK, (i_ & 1) ? 0x21u : 0x42u)));
+  usartFlush(U);
+}
+
+#endif // GPIO_BENCH
@@ -0,0 +1,16 @@
+// gpio_bench.h
+// GPIO library calls vs the inline fast path, in cycles per operation
+// (build with -DGPIO_BENCH=1), report on USART2 (ST-Link VCP)
+
+#ifndef GPIO_BENCH_H
+#define GPIO_BENCH_H
+
+#ifndef GPIO_BENCH
+#define GPIO_BENCH 0
+#endif
+
+#define GPIO_BENCH_OPS 256
+
+void gpio_bench_run(void);
+
+#endif // GPIO_BENCH_H
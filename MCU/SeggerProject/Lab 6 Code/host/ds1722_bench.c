@@ -0,0 +1,233 @@
+/*********************************************************************
+*  ds1722_bench.c — E155 Lab 6: DS1722 driver on the device model
+*  - Runs DS1722.c, spi_bus.c and STM32L432KC_SPI.c on the register
+*    model (sim.c) with the DS1722 model (ds1722_sim.c) on PA6
+*  - Resolution check, 8..12 bits: setTempConfiguration(), CONFIG
+*    read back, then ds1722_read_raw() once per ms until it returns
+*    a conversion started after the write. Reports the time to that
+*    fresh value (datasheet: ds1722_conv_ms()) and checks its value
+*    and step
+*  - At 80 MHz and 16 MHz, each call back to back for -t s of
+*    simulated time: calls/s, bytes/s on SPI and us per call. Then
+*    each temperature read once per ms over two 12-bit conversions:
+*    age of the returned value (read - end of its conversion) and
+*    its error against the profile at the read
+*  - ds1722_read_burst() is file-static: readConfiguration() (1
+*    byte) and ds1722_read_raw() (2 bytes) are its two callers. The
+*    spi_bus_submit() row is temp_sampler.c's 4-byte DMA burst,
+*    waited for with WFI
+*  - As in lab6_sim, plain C between register accesses is free
+*  - Usage: ds1722_bench [-t s] [-T t:degC,t:degC,...]
+*********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stm32l432xx.h>
+#include "ds1722_sim.h"
+#include "../DS1722.h"
+#include "../STM32L432KC_FLASH.h"
+#include "../STM32L432KC_GPIO.h"
+#include "../STM32L432KC_RCC.h"
+#include "../swtimer.h"
+
+#define MS(x)  ((double)(x) / 1e9)
+#define US(x)  ((double)(x) / 1e6)
+
+static double window_s = 0.05;
+static char   profile_spec[256] = "0:20,10:30,20:-10,30:25";
+
+static spi_dev_t *const devs[] = { &ds1722_spi };
+
+/* ------------------------------------------------------------ calls */
+static int16_t last_raw;
+static float   last_c;
+
+static void call_config(void)  { (void)readConfiguration(); }
+static void call_raw(void)     { last_raw = ds1722_read_raw(); }
+static void call_celsius(void) { last_c = ds1722_read_celsius(); last_raw = (int16_t)(last_c * 256.0f); }
+static void call_set(void)     { setTempConfiguration(12); }
+static void call_dma(void) {
+  uint8_t tx[4] = { DS1722_ADDR_CONFIG_R }, rx[4];
+  spi_req_t r = { &ds1722_spi, tx, rx, 4, 0, 0, 0, 0, 0 };
+  if (spi_bus_submit(&r)) return;
+  __disable_irq();
+  while (r.busy) {
+    __WFI();
+    __enable_irq();
+    __disable_irq();
+  }
+  __enable_irq();
+  last_raw = (int16_t)(((uint16_t)rx[3] << 8) | rx[2]);
+}
+
+typedef struct {
+  const char *name;
+  void      (*fn)(void);
+  int         temp;               /* returns a temperature in last_raw */
+} call_t;
+
+static const call_t calls[] = {
+  { "readConfiguration",    call_config,  0 },
+  { "ds1722_read_raw",      call_raw,     1 },
+  { "ds1722_read_celsius",  call_celsius, 1 },
+  { "setTempConfiguration", call_set,     0 },
+  { "spi_bus_submit 4 B",   call_dma,     1 },
+};
+#define N_CALLS (sizeof calls / sizeof calls[0])
+
+static const uint32_t clocks[] = { 80000000u, 16000000u };
+#define N_CLOCKS (sizeof clocks / sizeof clocks[0])
+
+/* ------------------------------------------------------------ results */
+typedef struct {
+  unsigned   bits, stale, ok;
+  uint8_t    cfg;
+  sim_time_t fresh;
+} res_result_t;
+
+typedef struct {
+  uint32_t           sck_hz;
+  unsigned           n, n_temp, wrong;
+  unsigned long long bytes;
+  sim_time_t         span, age_sum, age_max;
+  double             err_sum, err_max;
+} row_t;
+
+static res_result_t res[5];
+static row_t        rows[N_CLOCKS][N_CALLS];
+static int          fw_done;
+
+static void run_row(row_t *row, const call_t *c) {
+  unsigned long long b0 = ds1722_sim_stats.bytes;
+  sim_time_t t0 = sim_now(), stop = t0 + (sim_time_t)(window_s * SIM_PS_PER_S);
+  row->sck_hz = clockCurrent()->pclk2 >> (ds1722_spi.br + 1);
+  while (sim_now() < stop) {
+    c->fn();
+    row->n++;
+  }
+  row->span  = sim_now() - t0;
+  row->bytes = ds1722_sim_stats.bytes - b0;
+  if (!c->temp) return;
+
+  stop = sim_now() + 2u * ds1722_conv_ms(12) * (SIM_PS_PER_S / 1000u);
+  while (sim_now() < stop) {
+    swt_delay_ms(1);
+    c->fn();
+    ds1722_read_t r;
+    if (ds1722_sim_last_read(&r) || !r.t_conv_end) continue;
+    if (last_raw != r.raw) row->wrong++;
+    sim_time_t age = r.t_read - r.t_conv_end;
+    double err = fabs(last_raw / 256.0 - r.true_c);
+    row->n_temp++;
+    row->age_sum += age;
+    if (age > row->age_max) row->age_max = age;
+    row->err_sum += err;
+    if (err > row->err_max) row->err_max = err;
+  }
+}
+
+static void check_resolution(res_result_t *rr, int bits) {
+  sim_time_t t0 = sim_now();
+  rr->bits = (unsigned)bits;
+  setTempConfiguration(bits);
+  rr->cfg = readConfiguration();
+  for (;;) {
+    swt_delay_ms(1);
+    int16_t raw = ds1722_read_raw();
+    ds1722_read_t r;
+    if (!ds1722_sim_last_read(&r) && r.t_conv_end && r.t_conv_start >= t0) {
+      int16_t step = (int16_t)(1 << (16 - bits));
+      rr->fresh = sim_now() - t0;
+      rr->ok = rr->cfg == ds1722_cfg_for_bits(bits) && raw == r.raw && r.bits == bits
+            && raw % step == 0 && raw == ds1722_sim_quantize(
+                 ds1722_sim_temp(r.t_conv_start + (r.t_conv_end - r.t_conv_start) / 2u), bits);
+      return;
+    }
+    rr->stale++;
+    if (sim_now() - t0 > 3ull * SIM_PS_PER_S) return;
+  }
+}
+
+static int fw(void) {
+  configureFlash();
+  configureClock();
+  gpioEnable(GPIO_PORT_A);
+  gpioEnable(GPIO_PORT_B);
+  gpioEnable(GPIO_PORT_C);
+  swt_init();
+  initSPI(5, 0, 1);
+  spi_bus_init(devs, 1);
+
+  for (int bits = 8; bits <= 12; ++bits) check_resolution(&res[bits - 8], bits);
+  for (unsigned k = 0; k < N_CLOCKS; ++k) {
+    clockSetFreq(clocks[k]);
+    for (unsigned i = 0; i < N_CALLS; ++i) run_row(&rows[k][i], &calls[i]);
+  }
+  fw_done = 1;
+  return 0;
+}
+
+/* ------------------------------------------------------------ report */
+static void usage(void) {
+  fprintf(stderr, "usage: ds1722_bench [-t s] [-T t:degC,t:degC,...]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    const char *a = argv[i], *v = (i + 1 < argc) ? argv[i + 1] : 0;
+    if (!v || a[0] != '-' || a[2]) usage();
+    switch (a[1]) {
+    case 't': window_s = atof(v); break;
+    case 'T': snprintf(profile_spec, sizeof profile_spec, "%s", v); break;
+    default:  usage();
+    }
+    ++i;
+  }
+  ds1722_point_t pts[DS1722_SIM_MAX_POINTS];
+  int n_pts = ds1722_sim_profile(profile_spec, pts, DS1722_SIM_MAX_POINTS);
+  if (window_s <= 0 || n_pts < 0) usage();
+
+  sim_init();
+  ds1722_sim_init(pts, n_pts);
+  sim_run(fw, 3600ull * SIM_PS_PER_S);
+  if (!fw_done) {
+    fprintf(stderr, "ds1722_bench: firmware did not finish\n");
+    return 1;
+  }
+
+  int fail = 0;
+  printf("ds1722_bench: profile %s\n", profile_spec);
+  printf("  resolution  CONFIG  stale reads  fresh after   datasheet  value/step\n");
+  for (int i = 0; i < 5; ++i) {
+    const res_result_t *rr = &res[i];
+    printf("  %6u bit    0x%02X  %11u  %8.1f ms  %7u ms  %s\n", rr->bits, rr->cfg, rr->stale,
+           MS(rr->fresh), ds1722_conv_ms((int)rr->bits), rr->ok ? "ok" : "FAIL");
+    fail |= !rr->ok;
+  }
+  for (unsigned k = 0; k < N_CLOCKS; ++k) {
+    printf("\n  HCLK %u MHz, SCK %.2f MHz, %.2f s each\n", clocks[k] / 1000000u,
+           rows[k][0].sck_hz / 1e6, window_s);
+    printf("  %-22s %9s %9s %8s %10s %10s %9s\n",
+           "call", "txn/s", "bytes/s", "us/call", "age avg ms", "age max ms", "err max C");
+    for (unsigned i = 0; i < N_CALLS; ++i) {
+      const row_t *r = &rows[k][i];
+      double s = (double)r->span / SIM_PS_PER_S;
+      printf("  %-22s %9.0f %9.0f %8.2f", calls[i].name, r->n / s, r->bytes / s,
+             r->n ? US(r->span) / r->n : 0.0);
+      if (calls[i].temp)
+        printf(" %10.1f %10.1f %9.4f%s", r->n_temp ? MS(r->age_sum) / r->n_temp : 0.0,
+               MS(r->age_max), r->err_max, r->wrong ? "  WRONG" : "");
+      printf("\n");
+      fail |= r->wrong != 0;
+    }
+  }
+  printf("\n  DS1722: %u transactions, %llu bytes, %u conversions, %u CONFIG writes, "
+         "%u mode errors, %u over 5 MHz\n",
+         ds1722_sim_stats.txns, ds1722_sim_stats.bytes, ds1722_sim_stats.conversions,
+         ds1722_sim_stats.config_writes, ds1722_sim_stats.mode_errors, ds1722_sim_stats.overspeed);
+  fail |= ds1722_sim_stats.mode_errors || ds1722_sim_stats.overspeed;
+  return fail;
+}
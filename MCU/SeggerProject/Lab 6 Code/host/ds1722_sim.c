@@ -0,0 +1,196 @@
+/*********************************************************************
+*  ds1722_sim.c — E155 Lab 6: DS1722 model (see ds1722_sim.h)
+*  - Conversions are brought up to date lazily, whenever the SPI
+*    side looks at the chip
+*********************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ds1722_sim.h"
+
+#define CE_PIN      6             /* PA6, SPI_CE */
+#define MAX_SCK_HZ  5000000u
+
+#define CFG_SD      0x01u
+#define CFG_1SHOT   0x10u
+
+ds1722_sim_stats_t ds1722_sim_stats;
+
+static ds1722_point_t profile[DS1722_SIM_MAX_POINTS];
+static int            n_points;
+
+static struct {
+  uint8_t    cfg;
+  int        converting;
+  uint8_t    conv_bits;
+  sim_time_t conv_start, conv_end;
+  /* last result */
+  int16_t    raw;
+  uint8_t    raw_bits;
+  sim_time_t raw_start, raw_end;
+  /* transaction */
+  int        selected, frames, write, temp_read;
+  uint8_t    addr, snap[3];
+  ds1722_read_t cur, last;
+  int        have_last;
+} chip;
+
+/* ------------------------------------------------------------ profile */
+int ds1722_sim_profile(const char *spec, ds1722_point_t *pts, int max) {
+  int n = 0;
+  const char *p = spec;
+  while (*p) {
+    char *end;
+    double t = strtod(p, &end);
+    if (end == p || *end != ':' || n == max) return -1;
+    p = end + 1;
+    double c = strtod(p, &end);
+    if (end == p || (n && t <= pts[n - 1].t_s)) return -1;
+    pts[n++] = (ds1722_point_t){ t, c };
+    p = end;
+    if (*p == ',') p++;
+    else if (*p) return -1;
+  }
+  return n ? n : -1;
+}
+
+double ds1722_sim_temp(sim_time_t t) {
+  double s = (double)t / SIM_PS_PER_S;
+  if (!n_points) return 25.0;
+  if (s <= profile[0].t_s) return profile[0].deg_c;
+  for (int i = 1; i < n_points; ++i)
+    if (s <= profile[i].t_s) {
+      const ds1722_point_t *a = &profile[i - 1], *b = &profile[i];
+      return a->deg_c + (b->deg_c - a->deg_c) * (s - a->t_s) / (b->t_s - a->t_s);
+    }
+  return profile[n_points - 1].deg_c;
+}
+
+/* Q8.8 with the bits below the resolution cleared (toward -inf) */
+int16_t ds1722_sim_quantize(double deg_c, int bits) {
+  if (deg_c < -55.0) deg_c = -55.0;
+  if (deg_c > 120.0) deg_c = 120.0;
+  int32_t step = 1 << (16 - bits);
+  int32_t q = (int32_t)floor(deg_c * 256.0 / step) * step;
+  return (int16_t)q;
+}
+
+/* ------------------------------------------------------------ converter */
+static int cfg_bits(uint8_t cfg) {
+  uint8_t r = (cfg >> 1) & 7u;
+  return r >= 4 ? 12 : 8 + r;
+}
+
+static sim_time_t conv_ps(int bits) {
+  return (75ull * SIM_PS_PER_S / 1000u) << (bits - 8);
+}
+
+static void conv_start(sim_time_t t) {
+  chip.converting = 1;
+  chip.conv_bits  = (uint8_t)cfg_bits(chip.cfg);
+  chip.conv_start = t;
+  chip.conv_end   = t + conv_ps(chip.conv_bits);
+}
+
+static void update(sim_time_t t) {
+  while (chip.converting && chip.conv_end <= t) {
+    sim_time_t mid = chip.conv_start + (chip.conv_end - chip.conv_start) / 2u;
+    chip.raw       = ds1722_sim_quantize(ds1722_sim_temp(mid), chip.conv_bits);
+    chip.raw_bits  = chip.conv_bits;
+    chip.raw_start = chip.conv_start;
+    chip.raw_end   = chip.conv_end;
+    ds1722_sim_stats.conversions++;
+    if (chip.cfg & CFG_SD) {
+      chip.cfg &= (uint8_t)~CFG_1SHOT;
+      chip.converting = 0;
+    } else {
+      conv_start(chip.conv_end);
+    }
+  }
+}
+
+static void write_config(uint8_t v, sim_time_t t) {
+  uint8_t old = chip.cfg;
+  update(t);
+  chip.cfg = (uint8_t)(0xE0u | (v & 0x1Fu));
+  ds1722_sim_stats.config_writes++;
+  if (!(chip.cfg & CFG_SD)) {
+    chip.cfg &= (uint8_t)~CFG_1SHOT;                  /* no one-shot in continuous mode */
+    if ((old & CFG_SD) || cfg_bits(old) != cfg_bits(chip.cfg) || !chip.converting) conv_start(t);
+  } else if ((chip.cfg & CFG_1SHOT) && !chip.converting) {
+    conv_start(t);
+  }
+}
+
+/* ------------------------------------------------------------ SPI */
+static void on_select(void *ctx, int on, sim_time_t t) {
+  (void)ctx;
+  if (on) {
+    chip.selected  = 1;
+    chip.frames    = 0;
+    chip.temp_read = 0;
+    return;
+  }
+  chip.selected = 0;
+  if (chip.frames) ds1722_sim_stats.txns++;
+  if (chip.temp_read) {
+    chip.last = chip.cur;
+    chip.have_last = 1;
+    ds1722_sim_stats.temp_reads++;
+  }
+  update(t);
+}
+
+static uint16_t on_frame(void *ctx, uint16_t mosi, const sim_spi_frame_t *f, sim_time_t t) {
+  (void)ctx;
+  if (!chip.selected) return 0xFFu;
+  ds1722_sim_stats.bytes++;
+  if (f->bits != 8 || !f->cpha) {
+    ds1722_sim_stats.mode_errors++;
+    return 0xFFu;
+  }
+  if (f->sck_hz > MAX_SCK_HZ) ds1722_sim_stats.overspeed++;
+
+  if (chip.frames++ == 0) {
+    chip.write = (mosi & 0x80u) != 0;
+    chip.addr  = (uint8_t)(mosi & 0x7Fu);
+    if (!chip.write) {
+      update(t);
+      chip.snap[0] = chip.cfg;
+      chip.snap[1] = (uint8_t)chip.raw;
+      chip.snap[2] = (uint8_t)((uint16_t)chip.raw >> 8);
+      chip.cur = (ds1722_read_t){ t, chip.raw_start, chip.raw_end, chip.raw_bits, chip.raw,
+                                  ds1722_sim_temp(t) };
+    }
+    return 0xFFu;                                     /* SDO not driven yet */
+  }
+  uint8_t a = chip.addr++;
+  if (chip.write) {
+    if (a == 0) write_config((uint8_t)mosi, t);
+    return 0xFFu;
+  }
+  if (a > 2) return 0xFFu;
+  if (a) chip.temp_read = 1;
+  return chip.snap[a];
+}
+
+static const sim_spi_dev_t dev = { 0, on_select, on_frame };
+
+void ds1722_sim_init(const ds1722_point_t *pts, int n) {
+  if (n > DS1722_SIM_MAX_POINTS) n = DS1722_SIM_MAX_POINTS;
+  memcpy(profile, pts, (size_t)n * sizeof *pts);
+  n_points = n;
+  memset(&chip, 0, sizeof chip);
+  chip.cfg = 0xE1u;
+  memset(&ds1722_sim_stats, 0, sizeof ds1722_sim_stats);
+  sim_spi_attach(CE_PIN, 0, &dev);
+}
+
+uint8_t ds1722_sim_config(void) { return chip.cfg; }
+
+int ds1722_sim_last_read(ds1722_read_t *r) {
+  if (!chip.have_last) return -1;
+  *r = chip.last;
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*********************************************************************
+*  ds1722_sim.h — E155 Lab 6: DS1722 model on the simulated SPI1
+*  - CONFIG (1 1 1 1SHOT R2 R1 R0 SD): only the low five bits take
+*    writes; powers up as 0xE1 (shut down, 8 bits)
+*  - Continuous mode (SD=0) converts back to back; a write that
+*    changes R2:R0 or clears SD restarts the conversion. With SD=1,
+*    writing 1SHOT runs one conversion, then 1SHOT reads 0 again;
+*    setting SD lets the running conversion finish
+*  - Conversion times are the datasheet maxima (75 ms at 8 bits,
+*    doubling to 1.2 s at 12). A result is the profile temperature
+*    at the middle of its conversion, Q8.8, truncated to the
+*    resolution (step 2^(8-bits) degC) and clamped to -55..+120
+*  - SPI: CE active high (SPI_CE), 8-bit frames, CPHA=1 (either
+*    CPOL), SCK up to 5 MHz. First byte is the address (bit 7 =
+*    write), then data with the address incrementing; reads past
+*    0x02 return 0xFF. A read burst sees the registers as they were
+*    at its address byte
+*  - Temperature profile: straight lines between (t, degC) points,
+*    held before the first and after the last
+*********************************************************************/
+#ifndef LAB6_DS1722_SIM_H
+#define LAB6_DS1722_SIM_H
+
+#include <stdint.h>
+#include "sim.h"
+
+#define DS1722_SIM_MAX_POINTS 32
+
+typedef struct {
+  double t_s, deg_c;
+} ds1722_point_t;
+
+/* One transaction that read TEMP_LSB or TEMP_MSB */
+typedef struct {
+  sim_time_t t_read;                  /* address byte */
+  sim_time_t t_conv_start, t_conv_end; /* conversion read (end 0: none yet) */
+  uint8_t    bits;                    /* its resolution */
+  int16_t    raw;                     /* Q8.8 in the registers */
+  double     true_c;                  /* profile at t_read */
+} ds1722_read_t;
+
+typedef struct {
+  unsigned           txns;            /* CE windows with at least one frame */
+  unsigned long long bytes;           /* frames, address included */
+  unsigned           temp_reads, config_writes, conversions;
+  unsigned           mode_errors;     /* CPHA=0 or not 8 bits: frame ignored */
+  unsigned           overspeed;       /* frames with SCK above 5 MHz */
+} ds1722_sim_stats_t;
+
+extern ds1722_sim_stats_t ds1722_sim_stats;
+
+/* Parse "t:degC,t:degC,..." (t in s, increasing); returns points or -1 */
+int     ds1722_sim_profile(const char *spec, ds1722_point_t *pts, int max);
+/* Reset the model and attach it to SPI1 on PA6 (after sim_init()) */
+void    ds1722_sim_init(const ds1722_point_t *pts, int n);
+double  ds1722_sim_temp(sim_time_t t);
+int16_t ds1722_sim_quantize(double deg_c, int bits);
+uint8_t ds1722_sim_config(void);
+/* Last temperature read; returns 0, or -1 if there was none */
+int     ds1722_sim_last_read(ds1722_read_t *r);
+
+#endif /* LAB6_DS1722_SIM_H */
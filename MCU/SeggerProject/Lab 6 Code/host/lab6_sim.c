@@ -0,0 +1,289 @@
+/*********************************************************************
+*  lab6_sim.c — E155 Lab 6: load test of the firmware on the host
+*  - Runs the real main.c (built as lab6_main) and drivers against
+*    the register model in sim.c, with an ESP8266 stand-in on
+*    USART1: requests arrive at a fixed rate or as a Poisson
+*    process, each is sent as "/REQ:<route>\n" once the previous
+*    response has ended ("</html>"), later ones wait in a queue
+*  - Reports completed requests/s, latency percentiles from arrival
+*    and from the end of the '\n' to the last response byte, USART1
+*    link utilization, RX overruns, interrupts, time in WFI and
+*    clock switches
+*  - Per route: response bytes and '\n' -> last byte latency, so the
+*    page and the status record can be compared poll for poll
+*  - A route ending in "?v" is sent as "<route>=<tag>" with the tag of
+*    the last status record seen: a conditional poll. "304" answers
+*    are counted as not modified
+*  - Checks the LED (PB3) after every response to a route naming
+*    ledon/ledoff (also "ledon/slots", the page script's fetch)
+*  - The DS1722 model (ds1722_sim.c) answers the sampler on SPI1,
+*    following the -T temperature profile
+*  - Only register accesses and interrupt entry/exit cost simulated
+*    time; the C between them is free, so latencies are a lower
+*    bound set by the links and the firmware's waits
+*  - Usage: lab6_sim [-r req/s] [-t s] [-p fixed|poisson]
+*                    [-m route,route,...] [-b remote baud] [-s seed]
+*                    [-T t:degC,...] [-q]
+*    Routes are main.c's ("page" asks for the main page), e.g.
+*    -m page, -m status, -m 'status?v', -m ledon/slots
+
+*********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "ds1722_sim.h"
+
+#define LED_PIN   19              /* PB3 */
+#define T_START   (10ull * SIM_PS_PER_S / 1000u)    /* let the firmware boot */
+#define MAX_ROUTES 16
+
+int lab6_main(void);
+
+static double   rate = 5.0, seconds = 5.0;
+static int      poisson = 1, quiet = 0;
+static uint32_t remote_baud = 125000u;
+static unsigned long long seed = 1;
+static char     mix_buf[256] = "page,ledon,ledoff,history";
+static char     profile_spec[256] = "0:20,60:30";
+static const char *mix[MAX_ROUTES];
+static int      n_mix;
+
+/* ------------------------------------------------------------ requests */
+typedef struct {
+  sim_time_t arrival, line_end;
+  int        route;
+  unsigned   bytes;                          /* response bytes so far */
+} req_t;
+
+static req_t   *queue;                       /* FIFO of arrived requests */
+static unsigned q_head, q_tail, q_cap;
+static int      busy;                        /* a request is on the MCU */
+static req_t    cur;
+static unsigned q_max;
+
+static double  *lat_ms, *svc_ms;             /* per completed request */
+static int     *done_route;
+static unsigned n_done, cap_done;
+static unsigned led_ok, led_bad;
+
+static unsigned long long route_bytes[MAX_ROUTES];
+static unsigned route_same[MAX_ROUTES];      /* "304" answers */
+static uint32_t status_tag = 0xFFFFFFFFu;    /* never a real tag */
+
+static double rnd(void) {                    /* (0, 1] */
+  seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+  return ((seed >> 11) + 1.0) / 9007199254740992.0;
+}
+
+static void send_next(void) {
+  char line[64];
+  if (busy || q_head == q_tail) return;
+  cur = queue[q_tail++ % q_cap];
+  const char *r = mix[cur.route];
+  size_t len = strlen(r);
+  int n = (len >= 2 && !strcmp(r + len - 2, "?v"))
+        ? snprintf(line, sizeof line, "/REQ:%s=%08X\n", r, status_tag)
+        : snprintf(line, sizeof line, "/REQ:%s\n", r);
+  /* The remote line is idle here: the last request was read long ago */
+  cur.line_end = sim_now() + (sim_time_t)n * 10u * SIM_PS_PER_S / remote_baud;
+  sim_uart_send(SIM_USART1, line, (unsigned)n);
+  busy = 1;
+}
+
+static void arrive(void *arg) {
+  (void)arg;
+  if (q_head - q_tail == q_cap) {
+    unsigned cap = q_cap ? 2u * q_cap : 64u;
+    req_t *q = malloc(cap * sizeof *q);
+    for (unsigned i = 0; q_tail + i != q_head; ++i) q[i] = queue[(q_tail + i) % q_cap];
+    q_head -= q_tail;
+    q_tail = 0;
+    free(queue);
+    queue = q;
+    q_cap = cap;
+  }
+  queue[q_head++ % q_cap] = (req_t){ sim_now(), 0, (int)(rnd() * n_mix) % n_mix, 0 };
+  if (q_head - q_tail > q_max) q_max = q_head - q_tail;
+  send_next();
+
+  double gap = poisson ? -log(rnd()) / rate : 1.0 / rate;
+  sim_at(sim_now() + (sim_time_t)(gap * SIM_PS_PER_S), arrive, 0);
+}
+
+/* Tag of a status record ending in tail: ...,"v":"XXXXXXXX"}</html> */
+static void parse_tag(const char *tail, unsigned n) {
+  static const char key[] = "\"v\":\"";
+  for (unsigned i = 0; i + sizeof key - 1 + 8 <= n; ++i)
+    if (!memcmp(tail + i, key, sizeof key - 1)) {
+      char hex[9];
+      memcpy(hex, tail + i + sizeof key - 1, 8);
+      hex[8] = 0;
+      status_tag = (uint32_t)strtoul(hex, 0, 16);
+      return;
+    }
+}
+
+/* Response bytes from the MCU; "</html>" ends one */
+static void on_tx(int port, uint8_t byte, sim_time_t t) {
+  static const char end[] = "</html>";
+  static unsigned match;
+  static char tail[96];                      /* last bytes of the response */
+  if (port != SIM_USART1 || !busy) return;
+
+  memmove(tail, tail + 1, sizeof tail - 1);
+  tail[sizeof tail - 1] = (char)byte;
+  cur.bytes++;
+  match = (byte == (uint8_t)end[match]) ? match + 1u : (byte == (uint8_t)end[0]);
+  if (match < sizeof end - 1) return;
+  match = 0;
+
+  if (n_done == cap_done) {
+    cap_done = cap_done ? 2u * cap_done : 256u;
+    lat_ms = realloc(lat_ms, cap_done * sizeof *lat_ms);
+    svc_ms = realloc(svc_ms, cap_done * sizeof *svc_ms);
+    done_route = realloc(done_route, cap_done * sizeof *done_route);
+  }
+  lat_ms[n_done] = (double)(t - cur.arrival) / 1e9;
+  svc_ms[n_done] = (double)(t - cur.line_end) / 1e9;
+  done_route[n_done] = cur.route;
+  n_done++;
+  route_bytes[cur.route] += cur.bytes;
+  if (cur.bytes == 10 && !memcmp(tail + sizeof tail - 10, "304</html>", 10))
+    route_same[cur.route]++;
+  else if (cur.bytes <= sizeof tail)
+    parse_tag(tail + sizeof tail - cur.bytes, cur.bytes);
+
+  const char *r = mix[cur.route];
+  int want = strstr(r, "ledoff") ? 0 : strstr(r, "ledon") ? 1 : -1;
+  if (want >= 0) {
+    if (sim_gpio_level(LED_PIN) == want) led_ok++;
+    else led_bad++;
+  }
+  busy = 0;
+  send_next();
+}
+
+/* ------------------------------------------------------------ report */
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double pct(const double *v, unsigned n, double p) {
+  if (!n) return 0.0;
+  unsigned i = (unsigned)(p / 100.0 * (n - 1) + 0.5);
+  return v[i];
+}
+
+static void print_lat(const char *label, double *v) {
+  qsort(v, n_done, sizeof *v, cmp_double);
+  printf("  %-22s p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f ms\n", label,
+         pct(v, n_done, 50), pct(v, n_done, 90), pct(v, n_done, 99), pct(v, n_done, 100));
+}
+
+/* '\n' -> last byte per route, and what the response costs on the link */
+static void print_routes(void) {
+  double *v = malloc((n_done ? n_done : 1u) * sizeof *v);
+  printf("  %-16s %6s %9s %9s %8s %8s %8s\n",
+         "route", "n", "bytes avg", "link ms", "p50 ms", "p99 ms", "304");
+  for (int r = 0; r < n_mix; ++r) {
+    unsigned n = 0;
+    for (int j = 0; j < r; ++j)
+      if (!strcmp(mix[j], mix[r])) n = ~0u;      /* listed twice: already shown */
+    if (n) continue;
+    unsigned long long bytes = 0, same = 0;
+    for (int j = r; j < n_mix; ++j)
+      if (!strcmp(mix[j], mix[r])) { bytes += route_bytes[j]; same += route_same[j]; }
+    for (unsigned i = 0; i < n_done; ++i)
+      if (!strcmp(mix[done_route[i]], mix[r])) v[n++] = svc_ms[i];
+    if (!n) continue;
+    qsort(v, n, sizeof *v, cmp_double);
+    double avg = (double)bytes / n;
+    printf("  %-16s %6u %9.1f %9.2f %8.2f %8.2f %7.1f%%\n", mix[r], n, avg,
+           avg * 10.0 * 1000.0 / sim_uart_baud(SIM_USART1), pct(v, n, 50), pct(v, n, 99),
+           100.0 * (double)same / n);
+  }
+  free(v);
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: lab6_sim [-r req/s] [-t s] [-p fixed|poisson] "
+                  "[-m route,route,...] [-b remote baud] [-s seed] [-T t:degC,...] [-q]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    const char *a = argv[i], *v = (i + 1 < argc) ? argv[i + 1] : 0;
+    if (!strcmp(a, "-q")) { quiet = 1; continue; }
+    if (!v || a[0] != '-' || a[2]) usage();
+    switch (a[1]) {
+    case 'r': rate = atof(v); break;
+    case 't': seconds = atof(v); break;
+    case 'p': poisson = !strcmp(v, "poisson"); if (!poisson && strcmp(v, "fixed")) usage(); break;
+    case 'm': snprintf(mix_buf, sizeof mix_buf, "%s", v); break;
+    case 'b': remote_baud = (uint32_t)atol(v); break;
+    case 's': seed = strtoull(v, 0, 0); if (!seed) seed = 1; break;
+    case 'T': snprintf(profile_spec, sizeof profile_spec, "%s", v); break;
+    default:  usage();
+    }
+    ++i;
+  }
+  if (rate <= 0 || seconds <= 0 || !remote_baud) usage();
+  for (char *tok = strtok(mix_buf, ","); tok && n_mix < MAX_ROUTES; tok = strtok(0, ","))
+    mix[n_mix++] = tok;
+  if (!n_mix) usage();
+  ds1722_point_t pts[DS1722_SIM_MAX_POINTS];
+  int n_pts = ds1722_sim_profile(profile_spec, pts, DS1722_SIM_MAX_POINTS);
+  if (n_pts < 0) usage();
+
+  sim_init();
+  ds1722_sim_init(pts, n_pts);
+  sim_uart_remote(SIM_USART1, remote_baud, on_tx);
+  sim_at(T_START, arrive, 0);
+  sim_time_t t_end = T_START + (sim_time_t)(seconds * SIM_PS_PER_S);
+  if (sim_run(lab6_main, t_end)) {
+    fprintf(stderr, "lab6_sim: firmware returned\n");
+    return 1;
+  }
+
+  double span = (double)(t_end - T_START) / SIM_PS_PER_S;
+  double total = (double)t_end / SIM_PS_PER_S;
+  const sim_line_t *tx = &sim_stats.tx[SIM_USART1], *rx = &sim_stats.rx[SIM_USART1];
+  double tx_util = 100.0 * (double)tx->busy / (double)t_end;
+  double rx_util = 100.0 * (double)rx->busy / (double)t_end;
+  unsigned backlog = q_head - q_tail + (unsigned)busy;
+
+  if (quiet) {
+    qsort(lat_ms, n_done, sizeof *lat_ms, cmp_double);
+    printf("lab6_sim %-8s %6.1f req/s offered %6.1f done  p50 %7.2f p99 %7.2f ms  "
+           "tx %5.1f%%  backlog %u  led %s\n",
+           poisson ? "poisson" : "fixed", rate, n_done / span,
+           pct(lat_ms, n_done, 50), pct(lat_ms, n_done, 99), tx_util, backlog,
+           led_bad ? "FAIL" : "ok");
+  } else {
+    printf("lab6_sim: %.1f req/s offered (%s), %.1f s, mix", rate,
+           poisson ? "poisson" : "fixed", span);
+    for (int i = 0; i < n_mix; ++i) printf("%c%s", i ? ',' : ' ', mix[i]);
+    printf("\n  completed %u (%.2f req/s), backlog %u, queue max %u\n",
+           n_done, n_done / span, backlog, q_max);
+    print_routes();                          /* before print_lat() sorts svc_ms */
+    print_lat("arrival -> last byte", lat_ms);
+    print_lat("'\\n' -> last byte", svc_ms);
+    printf("  USART1 %u baud (MCU), %u (remote): TX %.1f%% busy, %llu B; "
+           "RX %.1f%% busy, %llu B\n",
+           sim_uart_baud(SIM_USART1), remote_baud, tx_util, tx->bytes, rx_util, rx->bytes);
+    printf("  RX overruns %u, bytes with RX off %u\n",
+           sim_stats.rx_overruns[SIM_USART1], sim_stats.rx_off[SIM_USART1]);
+    printf("  interrupts %llu, WFI %.1f%%, clock switches %u, HCLK now %u Hz\n",
+           sim_stats.irqs, 100.0 * (double)sim_stats.sleep / SIM_PS_PER_S / total,
+           sim_stats.clock_switches, sim_hclk());
+    printf("  LED check: %u ok, %u wrong\n", led_ok, led_bad);
+    printf("  DS1722: %u transactions, %u conversions, %u mode errors\n",
+           ds1722_sim_stats.txns, ds1722_sim_stats.conversions, ds1722_sim_stats.mode_errors);
+  }
+  return (led_bad || !n_done) ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+/*********************************************************************
+*  router_bench.c — E155 Lab 6: host benchmark of request parsing
+*  - Feeds the same request lines through the streaming router
+*    (../router.c) and through the old main.c path: a BUFF_LEN 32
+*    buffer, strstr(request, "\n") after every byte, then up to 12
+*    inString() scans
+*  - Checks that both pick the same LED / resolution action on lines
+*    the old buffer could hold
+*  - Reports ns and TSC ticks (x86) per request and per byte
+*  - Usage: router_bench [-n reps]
+*********************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../router.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TICKS() __rdtsc()
+#else
+#define TICKS() 0ULL
+#endif
+
+/* ---------------------------------------------------------------- routes */
+enum { G_LED, G_RES };
+static int led = -1, res = -1;
+static void on_led(int on) { led = on; }
+static void on_res(int bits) { res = bits; }
+
+/* Same table as main.c */
+static const route_t routes[] = {
+  { "ledoff",    G_LED, on_led, 0  },
+  { "ledon",     G_LED, on_led, 1  },
+  { "ledtoggle", G_LED, on_led, -1 },
+  { "res8",      G_RES, on_res, 8  }, { "8bit",  G_RES, on_res, 8  },
+  { "res9",      G_RES, on_res, 9  }, { "9bit",  G_RES, on_res, 9  },
+  { "res10",     G_RES, on_res, 10 }, { "10bit", G_RES, on_res, 10 },
+  { "res11",     G_RES, on_res, 11 }, { "11bit", G_RES, on_res, 11 },
+  { "res12",     G_RES, on_res, 12 }, { "12bit", G_RES, on_res, 12 },
+};
+
+/* ------------------------------------------------------ old main.c path */
+#define BUFF_LEN 32
+
+static int inString(char request[], const char des[]) {
+  return (strstr(request, des) != NULL) ? 1 : -1;
+}
+
+static void legacy_dispatch(char request[]) {
+  if (inString(request, "ledoff")==1) led = 0;
+  else if (inString(request, "ledon")==1) led = 1;
+  if (inString(request, "res8")==1 || inString(request, "8bit")==1)       res = 8;
+  else if (inString(request, "res9")==1 || inString(request, "9bit")==1)  res = 9;
+  else if (inString(request, "res10")==1|| inString(request, "10bit")==1) res = 10;
+  else if (inString(request, "res11")==1|| inString(request, "11bit")==1) res = 11;
+  else if (inString(request, "res12")==1|| inString(request, "12bit")==1) res = 12;
+}
+
+/* Returns bytes consumed (one line). Lines of BUFF_LEN or more never end. */
+static size_t legacy_feed(const char *in) {
+  /* main.c had request[BUFF_LEN] with a 32-char initializer: no NUL */
+  char request[BUFF_LEN + 1] = "                                ";
+  int idx = 0;
+  size_t k = 0;
+  while (inString(request, "\n") == -1) {
+    char c = in[k++];
+    if (idx < (BUFF_LEN-1)) request[idx++] = c;
+  }
+  legacy_dispatch(request);
+  return k;
+}
+
+static size_t router_line(router_t *r, const char *in) {
+  size_t k = 0;
+  while (router_feed(r, in[k++]) < 0) {}
+  return k;
+}
+
+/* ---------------------------------------------------------------- lines */
+static const char *lines[] = {
+  "/REQ:ledon\n",
+  "/REQ:ledoff\n",
+  "/REQ:res12\n",
+  "/REQ:res9\n",
+  "/REQ:\n",
+  "GET /ledon HTTP/1.1\n",
+  "GET /res10?x=1 HTTP/1.1\n",
+  "GET /12bit HTTP/1.1 Host: 192.168.4.1\n",
+  "GET /ledoff HTTP/1.1 Host: 192.168.4.1 User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
+  "AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36 Accept: text/html\n",
+};
+#define N_LINES (sizeof lines / sizeof lines[0])
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long reps = 200000;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) reps = atol(argv[++i]);
+    else { fprintf(stderr, "usage: %s [-n reps]\n", argv[0]); return 1; }
+  }
+
+  static router_t r;
+  if (router_init(&r, routes, sizeof routes / sizeof routes[0])) {
+    fprintf(stderr, "route table does not fit\n");
+    return 1;
+  }
+  printf("router: %u routes, %u trie nodes, %zu bytes of state\n",
+         r.n_routes, r.n_nodes, sizeof r);
+
+  /* Same decision where the old buffer could see the whole line */
+  unsigned bad = 0;
+  for (unsigned i = 0; i < N_LINES; ++i) {
+    if (strlen(lines[i]) >= BUFF_LEN) continue;
+    int l0, r0;
+    led = res = -1; router_line(&r, lines[i]); l0 = led; r0 = res;
+    led = res = -1; legacy_feed(lines[i]);
+    if (l0 != led || r0 != res) {
+      printf("mismatch on %s", lines[i]);
+      bad++;
+    }
+  }
+  printf("agreement on short lines: %s\n\n", bad ? "FAIL" : "ok");
+
+  printf("%-6s  %5s  %10s  %10s  %9s  %9s\n", "path", "bytes", "ns/req", "tsc/req", "ns/byte", "tsc/byte");
+  for (unsigned i = 0; i < N_LINES; ++i) {
+    size_t len = strlen(lines[i]);
+    for (int path = 0; path < 2; ++path) {
+      if (path == 1 && len >= BUFF_LEN) {
+        printf("%-6s  %5zu  %10s  (line longer than BUFF_LEN: old loop spins forever)\n", "old", len, "-");
+        continue;
+      }
+      double t0 = now_ns();
+      unsigned long long c0 = TICKS();
+      for (long k = 0; k < reps; ++k) {
+        if (path == 0) router_line(&r, lines[i]);
+        else legacy_feed(lines[i]);
+      }
+      unsigned long long c = TICKS() - c0;
+      double ns = (now_ns() - t0) / reps;
+      printf("%-6s  %5zu  %10.1f  %10.1f  %9.2f  %9.2f\n", path ? "old" : "router", len,
+             ns, (double)c / reps, ns / len, (double)c / reps / len);
+    }
+  }
+  return bad != 0;
+}
@@ -0,0 +1,1010 @@
+/*********************************************************************
+*  sim.c — E155 Lab 6: host register model (LAB6_HOST_SIM builds)
+*  - Registers live at their real addresses (two fixed mappings).
+*    Every hook first applies what the firmware wrote since the last
+*    one (compared with what the model last published; write-only
+*    registers such as TDR, ICR, BSRR read back as a marker value),
+*    then advances time, runs peripheral events and interrupts in
+*    order, and publishes live values
+*  - The NVIC latches a pending bit while a peripheral line is up,
+*    like the hardware: a line still up when its handler returns
+*    pends it again
+*  - Events (timer updates and compares, USART and SPI frame ends,
+*    bench callbacks) are found by scanning: there are only a handful
+*  - Thread code spinning on a RAM flag (spiWait(), spi_bus's clock
+*    hook) makes no accesses, so time would stand still: a CPU-time
+*    tick that finds no access since the previous one runs the model
+*    until an interrupt is taken, as if the spin ran until then
+*********************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include "sim.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+sim_stats_t sim_stats;
+uint32_t SystemCoreClock = 4000000u;
+
+static inline volatile uint32_t *reg(uint32_t addr) { return (volatile uint32_t *)(uintptr_t)addr; }
+
+/* Addresses (host/stm32l432xx.h has the same layout) */
+#define RCC_CR        0x40021000u
+#define RCC_CFGR      0x40021008u
+#define RCC_PLLCFGR   0x4002100Cu
+#define RCC_CCIPR     0x40021088u
+#define RCC_CSR       0x40021094u
+#define SPI1_CR1      0x40013000u
+#define SPI1_CR2      0x40013004u
+#define SPI1_SR       0x40013008u
+#define SPI1_DR       0x4001300Cu
+#define DMA1_ISR      0x40020000u
+#define DMA1_IFCR     0x40020004u
+#define DMA_CH(n)     (0x40020008u + 0x14u * ((n) - 1u))   /* CCR; CNDTR +4, CMAR +12 */
+#define DWT_CYCCNT    0xE0001004u
+#define LPTIM1_CR     0x40007C10u
+#define LPTIM1_CNT    0x40007C1Cu
+#define LPTIM_TICK    (SIM_PS_PER_S / 16000000u)  /* HSI16 */
+
+#define TIM_CR1   0x00u
+#define TIM_DIER  0x0Cu
+#define TIM_SR    0x10u
+#define TIM_EGR   0x14u
+#define TIM_CNT   0x24u
+#define TIM_PSC   0x28u
+#define TIM_ARR   0x2Cu
+#define TIM_CCR1  0x34u
+
+#define US_CR1    0x00u
+#define US_CR2    0x04u
+#define US_BRR    0x0Cu
+#define US_ISR    0x1Cu
+#define US_ICR    0x20u
+#define US_RDR    0x24u
+#define US_TDR    0x28u
+
+#define GP_MODER  0x00u
+#define GP_PUPDR  0x0Cu
+#define GP_IDR    0x10u
+#define GP_ODR    0x14u
+#define GP_BSRR   0x18u
+#define GP_BRR    0x28u
+
+#define TDR_IDLE  0x5A5A0000u      /* no byte (char or uint8_t) stores this */
+#define DR_IDLE   0xA5C3A5C3u      /* SPI DR while a write may be under way */
+
+/* IRQ numbers (IRQn_Type) */
+#define IRQ_DMA1_CH2   12
+#define IRQ_DMA1_CH3   13
+#define IRQ_TIM15      24
+#define IRQ_TIM16      25
+#define IRQ_TIM2       28
+#define IRQ_USART1     37
+#define IRQ_USART2     38
+#define N_IRQS         96
+
+/* ------------------------------------------------------------- state */
+static sim_time_t now, t_end;
+static sigjmp_buf run_jmp;
+static volatile sig_atomic_t in_sim;            /* model code on the stack */
+static volatile unsigned long n_sync, spin_seen;
+
+static uint8_t  irq_en[N_IRQS], irq_pend[N_IRQS], irq_act[N_IRQS], irq_prio[N_IRQS];
+static uint32_t primask;
+static unsigned cur_prio = 16;                  /* 16 = thread mode */
+static int      cur_irq = -1;
+
+static uint32_t   sysclk, hclk, pclk1, pclk2;
+static sim_time_t cyc_ps;                       /* one HCLK cycle */
+static sim_time_t t_cyc;                        /* cycles counted up to here */
+static unsigned long long cyc_at;
+static uint32_t   cyc_pub, cyc_offset;
+
+/* Timers */
+typedef struct {
+  uint32_t           base;
+  int                irq, apb2;
+  unsigned long long span;                      /* 2^bits */
+  int                running;
+  sim_time_t         t_base, tick;              /* count was cnt_base at t_base */
+  uint32_t           cnt_base, psc_act, cnt_pub;
+  uint32_t           sr, sr_pub;                /* SR is rc_w0 */
+} tim_t;
+
+static tim_t tims[] = {
+  { .base = 0x40000000u, .irq = IRQ_TIM2,  .apb2 = 0, .span = 1ull << 32 },
+  { .base = 0x40014000u, .irq = IRQ_TIM15, .apb2 = 1, .span = 1ull << 16 },
+  { .base = 0x40014400u, .irq = IRQ_TIM16, .apb2 = 1, .span = 1ull << 16 },
+};
+#define N_TIMS (sizeof tims / sizeof tims[0])
+
+/* USARTs */
+typedef struct {
+  uint32_t    base;
+  int         irq, apb2, sel_pos;
+  uint32_t    isr;                              /* TXE TC RXNE ORE */
+  uint8_t     rdr;
+  /* transmitter */
+  int         tdr_full, shifting;
+  uint8_t     tdr, tx_byte;
+  sim_time_t  tx_start, tx_end;
+  sim_tx_fn_t on_tx;
+  /* remote transmitter -> our RX pin */
+  uint8_t    *q;
+  unsigned    q_head, q_tail, q_cap;
+  int         rx_active;
+  uint8_t     rx_byte;
+  sim_time_t  rx_start, rx_end, remote_byte_ps;
+} usart_t;
+
+static usart_t usarts[SIM_N_USARTS] = {
+  { .base = 0x40013800u, .irq = IRQ_USART1, .apb2 = 1, .sel_pos = 0 },
+  { .base = 0x40004400u, .irq = IRQ_USART2, .apb2 = 0, .sel_pos = 2 },
+};
+
+/* GPIO */
+static const uint32_t gpio_base[3] = { 0x48000000u, 0x48000400u, 0x48000800u };
+static uint32_t       odr_pub[3];
+static sim_pin_fn_t   pin_watch;
+
+/* SPI1: one-frame TX buffer, shifter, RX FIFO */
+#define SPI_RXQ 4
+static struct {
+  uint16_t   txbuf, shift;
+  int        tx_full, shifting, ovr, dr_write;
+  sim_time_t t_end;
+  uint16_t   rxq[SPI_RXQ];
+  unsigned   rx_n;
+} spi;
+
+typedef struct { int pin, active_low, selected; const sim_spi_dev_t *dev; } spi_slave_t;
+static spi_slave_t slaves[4];
+static unsigned    n_slaves;
+
+/* DMA1 channel 2 (SPI1_RX) and 3 (SPI1_TX): CNDTR at enable, for MINC */
+static uint32_t dma_en[8], dma_n0[8];
+
+/* LPTIM1: free running on HSI16 from CNTSTRT, ARR = 0xFFFF */
+static struct { int running; sim_time_t t0; } lptim;
+
+/* Bench events */
+typedef struct { sim_time_t t; sim_event_fn_t fn; void *arg; } event_t;
+static event_t *events;
+static unsigned n_events, cap_events;
+
+/* Handlers (weak: a build without one never takes that interrupt) */
+void DMA1_Channel2_IRQHandler(void) __attribute__((weak));
+void DMA1_Channel3_IRQHandler(void) __attribute__((weak));
+void TIM1_BRK_TIM15_IRQHandler(void) __attribute__((weak));
+void TIM1_UP_TIM16_IRQHandler(void) __attribute__((weak));
+void TIM2_IRQHandler(void) __attribute__((weak));
+void USART1_IRQHandler(void) __attribute__((weak));
+void USART2_IRQHandler(void) __attribute__((weak));
+
+static const struct { int irq; void (*handler)(void); } vectors[] = {   /* by IRQ number */
+  { IRQ_DMA1_CH2, DMA1_Channel2_IRQHandler },
+  { IRQ_DMA1_CH3, DMA1_Channel3_IRQHandler },
+  { IRQ_TIM15,    TIM1_BRK_TIM15_IRQHandler },
+  { IRQ_TIM16,    TIM1_UP_TIM16_IRQHandler },
+  { IRQ_TIM2,     TIM2_IRQHandler },
+  { IRQ_USART1,   USART1_IRQHandler },
+  { IRQ_USART2,   USART2_IRQHandler },
+};
+#define N_VECTORS (sizeof vectors / sizeof vectors[0])
+
+/* ------------------------------------------------------------- clocks */
+static const uint32_t msi_hz[12] = {
+  100000, 200000, 400000, 800000, 1000000, 2000000,
+  4000000, 8000000, 16000000, 24000000, 32000000, 48000000
+};
+
+static uint32_t msi_clock(void) {
+  uint32_t cr = *reg(RCC_CR);
+  uint32_t r = (cr & (1u << 3)) ? (cr >> 4) & 0xFu : (*reg(RCC_CSR) >> 8) & 0xFu;
+  return r < 12 ? msi_hz[r] : msi_hz[6];
+}
+
+static uint32_t ahb_div(uint32_t hpre) {
+  static const uint32_t d[8] = { 2, 4, 8, 16, 64, 128, 256, 512 };
+  return (hpre & 8u) ? d[hpre & 7u] : 1u;
+}
+
+static uint32_t apb_div(uint32_t ppre) { return (ppre & 4u) ? 2u << (ppre & 3u) : 1u; }
+
+static uint32_t tim_clock(const tim_t *t) {
+  uint32_t ppre = (*reg(RCC_CFGR) >> (t->apb2 ? 11 : 8)) & 7u;
+  uint32_t pclk = t->apb2 ? pclk2 : pclk1;
+  return apb_div(ppre) > 1 ? 2u * pclk : pclk;
+}
+
+static sim_time_t tim_tick(const tim_t *t) {
+  return (sim_time_t)(t->psc_act + 1ull) * SIM_PS_PER_S / tim_clock(t);
+}
+
+static uint32_t tim_cnt(const tim_t *t) {
+  if (!t->running) return t->cnt_base;
+  return t->cnt_base + (uint32_t)((now - t->t_base) / t->tick);
+}
+
+/* Move the base to the last whole tick, so the phase survives a rate change */
+static void tim_rebase(tim_t *t) {
+  if (!t->running) return;
+  sim_time_t k = (now - t->t_base) / t->tick;
+  t->cnt_base += (uint32_t)k;
+  t->t_base   += k * t->tick;
+}
+
+/* Sysclk from SW and the PLL/MSI settings; rebase everything timed by it */
+static void clock_update(void) {
+  uint32_t cfgr = *reg(RCC_CFGR), sys;
+  switch (cfgr & 3u) {
+  case 1:  sys = 16000000u; break;
+  case 3: {
+    uint32_t pll = *reg(RCC_PLLCFGR);
+    uint32_t in = ((pll & 3u) == 2u) ? 16000000u : msi_clock();
+    uint32_t m = ((pll >> 4) & 7u) + 1u, n = (pll >> 8) & 0x7Fu, r = (((pll >> 25) & 3u) + 1u) * 2u;
+    sys = (uint32_t)((unsigned long long)in / m * n / r);
+    break;
+  }
+  default: sys = msi_clock(); break;
+  }
+  uint32_t h = sys / ahb_div((cfgr >> 4) & 0xFu);
+  uint32_t p1 = h / apb_div((cfgr >> 8) & 7u), p2 = h / apb_div((cfgr >> 11) & 7u);
+  if (sys == sysclk && h == hclk && p1 == pclk1 && p2 == pclk2) return;
+
+  for (unsigned i = 0; i < N_TIMS; ++i) tim_rebase(&tims[i]);
+  if (cyc_ps) {
+    cyc_at += (now - t_cyc) / cyc_ps;
+    t_cyc = now;
+  }
+  if (hclk && h != hclk) sim_stats.clock_switches++;
+  sysclk = sys; hclk = h; pclk1 = p1; pclk2 = p2;
+  cyc_ps = (SIM_PS_PER_S + h / 2u) / h;
+  for (unsigned i = 0; i < N_TIMS; ++i) tims[i].tick = tim_tick(&tims[i]);
+}
+
+static uint32_t cycles(void) { return (uint32_t)(cyc_at + (now - t_cyc) / cyc_ps) + cyc_offset; }
+
+/* ------------------------------------------------------------- timers */
+static unsigned long long tim_arr(const tim_t *t) { return *reg(t->base + TIM_ARR) & (t->span - 1ull); }
+
+/* Next update (counter wraps past ARR) */
+static sim_time_t tim_next_update(const tim_t *t) {
+  unsigned long long arr = tim_arr(t), cnt = t->cnt_base;
+  unsigned long long steps = (cnt <= arr) ? arr - cnt + 1ull : t->span - cnt + arr + 1ull;
+  return t->t_base + steps * t->tick;
+}
+
+/* Next CC1 match before that update (a match on 0 happens at the update) */
+static sim_time_t tim_next_cc(const tim_t *t) {
+  unsigned long long ccr = *reg(t->base + TIM_CCR1) & (t->span - 1ull);
+  if (ccr <= t->cnt_base || ccr > tim_arr(t)) return ~0ull;
+  return t->t_base + (ccr - t->cnt_base) * t->tick;
+}
+
+static void tim_update(tim_t *t, sim_time_t when) {
+  volatile uint32_t *cr1 = reg(t->base + TIM_CR1);
+  t->sr |= 1u;                                                    /* UIF */
+  t->cnt_base = 0;
+  t->t_base   = when;
+  t->psc_act  = *reg(t->base + TIM_PSC) & 0xFFFFu;
+  t->tick     = tim_tick(t);
+  if ((*reg(t->base + TIM_CCR1) & (t->span - 1ull)) == 0) t->sr |= 2u;
+  if (*cr1 & 8u) {                                                /* OPM */
+    *cr1 &= ~1u;
+    t->running = 0;
+  }
+}
+
+static void tim_compare(tim_t *t, sim_time_t when) {
+  t->sr |= 2u;                                                    /* CC1IF */
+  t->cnt_base = *reg(t->base + TIM_CCR1) & (uint32_t)(t->span - 1ull);
+  t->t_base   = when;
+}
+
+static void tim_writes(tim_t *t) {
+  volatile uint32_t *cr1 = reg(t->base + TIM_CR1), *egr = reg(t->base + TIM_EGR);
+  uint32_t cnt = *reg(t->base + TIM_CNT), sr = *reg(t->base + TIM_SR);
+
+  if (sr != t->sr_pub) t->sr &= sr;                               /* writing 1 does nothing */
+  if (cnt != t->cnt_pub) {                                        /* CNT written: */
+    if (t->running) t->t_base = now - (now - t->t_base) % t->tick;  /* the prescaler */
+    else            t->t_base = now;                                /* runs on       */
+    t->cnt_base = cnt;
+  }
+  if (*egr & 1u) {                                                /* UG */
+    *egr = 0;
+    t->cnt_base = 0;
+    t->t_base   = now;
+    t->psc_act  = *reg(t->base + TIM_PSC) & 0xFFFFu;
+    t->tick     = tim_tick(t);
+    if (!(*cr1 & 4u)) t->sr |= 1u;                                /* URS clear */
+  }
+  if ((*cr1 & 1u) && !t->running) {
+    t->running = 1;
+    t->t_base  = now;
+  } else if (!(*cr1 & 1u) && t->running) {
+    t->cnt_base = tim_cnt(t);
+    t->running  = 0;
+  }
+}
+
+static int tim_line(const tim_t *t) {
+  return (t->sr & *reg(t->base + TIM_DIER) & 3u) != 0;
+}
+
+/* ------------------------------------------------------------- USARTs */
+static uint32_t usart_kernel_clock(const usart_t *u) {
+  switch ((*reg(RCC_CCIPR) >> u->sel_pos) & 3u) {
+  case 1:  return sysclk;
+  case 2:  return 16000000u;
+  case 3:  return 32768u;
+  default: return u->apb2 ? pclk2 : pclk1;
+  }
+}
+
+/* Start bit + data + stop bits, at BRR (16x oversampling) */
+static sim_time_t usart_frame_ps(const usart_t *u) {
+  uint32_t cr1 = *reg(u->base + US_CR1), brr = *reg(u->base + US_BRR) & 0xFFFFu;
+  uint32_t data = (cr1 & (1u << 28)) ? 7u : (cr1 & (1u << 12)) ? 9u : 8u;
+  uint32_t stop = (((*reg(u->base + US_CR2) >> 12) & 3u) == 2u) ? 2u : 1u;
+  if (!brr) brr = 1;
+  return (sim_time_t)(1u + data + stop) * brr * SIM_PS_PER_S / usart_kernel_clock(u);
+}
+
+static int usart_on(const usart_t *u, uint32_t bit) {
+  uint32_t cr1 = *reg(u->base + US_CR1);
+  return (cr1 & 1u) && (cr1 & bit);
+}
+
+static void usart_shift(usart_t *u, uint8_t b) {
+  u->shifting = 1;
+  u->tx_byte  = b;
+  u->tx_start = now;
+  u->tx_end   = now + usart_frame_ps(u);
+  u->isr &= ~(1u << 6);                                           /* TC */
+}
+
+static void usart_tx_done(usart_t *u, int port) {
+  sim_time_t t = u->tx_end;
+  sim_stats.tx[port].bytes++;
+  sim_stats.tx[port].busy += t - u->tx_start;
+  uint8_t b = u->tx_byte;
+  u->shifting = 0;
+  if (u->tdr_full) {
+    u->tdr_full = 0;
+    u->isr |= 1u << 7;                                            /* TXE */
+    usart_shift(u, u->tdr);
+  } else {
+    u->isr |= 1u << 6;                                            /* TC */
+  }
+  if (u->on_tx) u->on_tx(port, b, t);
+}
+
+static void usart_rx_start(usart_t *u) {
+  if (u->rx_active || u->q_head == u->q_tail) return;
+  u->rx_active = 1;
+  u->rx_byte   = u->q[u->q_tail++ % u->q_cap];
+  u->rx_start  = now;
+  u->rx_end    = now + u->remote_byte_ps;
+}
+
+static void usart_rx_done(usart_t *u, int port) {
+  sim_stats.rx[port].bytes++;
+  sim_stats.rx[port].busy += u->rx_end - u->rx_start;
+  u->rx_active = 0;
+  if (!usart_on(u, 1u << 2)) {
+    sim_stats.rx_off[port]++;
+  } else if (u->isr & (1u << 5)) {
+    u->isr |= 1u << 3;                                            /* ORE: byte lost */
+    sim_stats.rx_overruns[port]++;
+  } else {
+    u->rdr = u->rx_byte;
+    u->isr |= 1u << 5;                                            /* RXNE */
+  }
+  usart_rx_start(u);                                              /* back to back */
+}
+
+static void usart_writes(usart_t *u) {
+  volatile uint32_t *tdr = reg(u->base + US_TDR), *icr = reg(u->base + US_ICR);
+  if (*tdr != TDR_IDLE) {
+    uint8_t b = (uint8_t)*tdr;
+    *tdr = TDR_IDLE;
+    if (usart_on(u, 1u << 3)) {
+      if (!u->shifting) usart_shift(u, b);
+      else {
+        u->tdr = b;                                               /* overwrites if full */
+        u->tdr_full = 1;
+        u->isr &= ~(1u << 7);
+      }
+    }
+  }
+  if (*icr) {
+    if (*icr & (1u << 3)) u->isr &= ~(1u << 3);
+    if (*icr & (1u << 6)) u->isr &= ~(1u << 6);
+    *icr = 0;
+  }
+}
+
+static int usart_line(const usart_t *u) {
+  uint32_t cr1 = *reg(u->base + US_CR1);
+  return ((u->isr & (1u << 7)) && (cr1 & (1u << 7)))
+      || ((u->isr & (1u << 6)) && (cr1 & (1u << 6)))
+      || ((u->isr & ((1u << 5) | (1u << 3))) && (cr1 & (1u << 5)));
+}
+
+/* ------------------------------------------------------------- GPIO */
+static void spi_cs_update(void);
+
+static void gpio_writes(void) {
+  for (unsigned p = 0; p < 3; ++p) {
+    volatile uint32_t *odr = reg(gpio_base[p] + GP_ODR);
+    volatile uint32_t *bsrr = reg(gpio_base[p] + GP_BSRR), *brr = reg(gpio_base[p] + GP_BRR);
+    if (*bsrr) {
+      uint32_t v = *bsrr;
+      *odr = (*odr & ~(v >> 16)) | (v & 0xFFFFu);
+      *bsrr = 0;
+    }
+    if (*brr) {
+      *odr &= ~(*brr & 0xFFFFu);
+      *brr = 0;
+    }
+    uint32_t moder = *reg(gpio_base[p] + GP_MODER), changed = (*odr ^ odr_pub[p]) & 0xFFFFu;
+    odr_pub[p] = *odr;
+    for (unsigned b = 0; changed && b < 16; ++b)
+      if ((changed >> b) & 1u) {
+        changed &= ~(1u << b);
+        if (pin_watch && ((moder >> (2u * b)) & 3u) == 1u)
+          pin_watch((int)(16u * p + b), (int)((*odr >> b) & 1u), now);
+      }
+  }
+  spi_cs_update();
+}
+
+/* Outputs read back their ODR bit, inputs their pull (floating reads 0) */
+static void gpio_publish(void) {
+  for (unsigned p = 0; p < 3; ++p) {
+    uint32_t moder = *reg(gpio_base[p] + GP_MODER), pupdr = *reg(gpio_base[p] + GP_PUPDR);
+    uint32_t idr = 0;
+    for (unsigned b = 0; b < 16; ++b) {
+      uint32_t mode = (moder >> (2u * b)) & 3u, pull = (pupdr >> (2u * b)) & 3u;
+      uint32_t level = (mode == 1u || mode == 2u) ? (odr_pub[p] >> b) & 1u : (pull == 1u);
+      idr |= level << b;
+    }
+    *reg(gpio_base[p] + GP_IDR) = idr;
+  }
+}
+
+/* ------------------------------------------------------ SPI1 + DMA */
+static unsigned spi_bits(void) { return ((*reg(SPI1_CR2) >> 8) & 0xFu) + 1u; }
+
+static sim_spi_frame_t spi_frame(void) {
+  uint32_t cr1 = *reg(SPI1_CR1);
+  sim_spi_frame_t f = { (uint8_t)spi_bits(), (uint8_t)((cr1 >> 1) & 1u), (uint8_t)(cr1 & 1u),
+                        pclk2 >> (((cr1 >> 3) & 7u) + 1u) };
+  return f;
+}
+
+static void spi_start(void) {
+  uint32_t cr1 = *reg(SPI1_CR1);
+  if (spi.shifting || !spi.tx_full || !(cr1 & (1u << 6)) || !(cr1 & (1u << 2))) return;
+  sim_spi_frame_t f = spi_frame();
+  spi.shift    = spi.txbuf;
+  spi.tx_full  = 0;
+  spi.shifting = 1;
+  spi.t_end    = now + (sim_time_t)f.bits * SIM_PS_PER_S / f.sck_hz;
+}
+
+/* DMA moves a frame as soon as the SPI asks (TXE / RXNE) */
+static void dma_pump(void) {
+  uint32_t cr2 = *reg(SPI1_CR2);
+  volatile uint32_t *rx = reg(DMA_CH(2)), *tx = reg(DMA_CH(3));
+  for (;;) {
+    int moved = 0;
+    if ((cr2 & 2u) && (*tx & 1u) && tx[1] && !spi.tx_full) {
+      uint32_t msize = (*tx >> 10) & 3u, i = (*tx & (1u << 7)) ? dma_n0[3] - tx[1] : 0u;
+      uintptr_t a = (uintptr_t)tx[3] + ((uintptr_t)i << msize);
+      spi.txbuf   = msize ? *(const uint16_t *)a : *(const uint8_t *)a;
+      spi.tx_full = 1;
+      if (!--tx[1]) *reg(DMA1_ISR) |= 3u << 8;                    /* GIF3, TCIF3 */
+      spi_start();
+      moved = 1;
+    }
+    if ((cr2 & 1u) && (*rx & 1u) && rx[1] && spi.rx_n) {
+      uint32_t msize = (*rx >> 10) & 3u, i = (*rx & (1u << 7)) ? dma_n0[2] - rx[1] : 0u;
+      uintptr_t a = (uintptr_t)rx[3] + ((uintptr_t)i << msize);
+      if (msize) *(uint16_t *)a = spi.rxq[0];
+      else *(uint8_t *)a = (uint8_t)spi.rxq[0];
+      memmove(spi.rxq, spi.rxq + 1, --spi.rx_n * sizeof spi.rxq[0]);
+      if (!--rx[1]) *reg(DMA1_ISR) |= 3u << 4;                    /* GIF2, TCIF2 */
+      moved = 1;
+    }
+    if (!moved) return;
+  }
+}
+
+/* Last SCK edge: the selected device takes MOSI and gives MISO */
+static void spi_done(void) {
+  sim_spi_frame_t f = spi_frame();
+  uint16_t mask = (uint16_t)((1u << f.bits) - 1u), miso = mask;   /* idle MISO reads 1s */
+  for (unsigned i = 0; i < n_slaves; ++i)
+    if (slaves[i].selected) miso = slaves[i].dev->frame(slaves[i].dev->ctx, spi.shift & mask, &f, now) & mask;
+  spi.shifting = 0;
+  sim_stats.spi_frames++;
+  if (spi.rx_n == ((f.bits > 8) ? SPI_RXQ / 2 : SPI_RXQ)) spi.ovr = 1;
+  else spi.rxq[spi.rx_n++] = miso;
+  spi_start();
+  dma_pump();
+}
+
+static void spi_cs_update(void) {
+  for (unsigned i = 0; i < n_slaves; ++i) {
+    spi_slave_t *sl = &slaves[i];
+    int on = sim_gpio_level(sl->pin) != sl->active_low;
+    if (on != sl->selected) {
+      sl->selected = on;
+      if (sl->dev->select) sl->dev->select(sl->dev->ctx, on, now);
+    }
+  }
+}
+
+static void spi_writes(void) {
+  if (spi.dr_write) {
+    uint32_t v = *reg(SPI1_DR);
+    spi.dr_write = 0;
+    if (v != DR_IDLE) {
+      spi.txbuf   = (uint16_t)(v & ((1u << spi_bits()) - 1u));
+      spi.tx_full = 1;
+    }
+  }
+  for (unsigned ch = 2; ch <= 3; ++ch) {
+    uint32_t en = *reg(DMA_CH(ch)) & 1u;
+    if (en && !dma_en[ch]) dma_n0[ch] = reg(DMA_CH(ch))[1];
+    dma_en[ch] = en;
+  }
+  volatile uint32_t *ifcr = reg(DMA1_IFCR);
+  if (*ifcr) {
+    *reg(DMA1_ISR) &= ~*ifcr;
+    for (unsigned ch = 0; ch < 7; ++ch)                           /* CGIFx clears the channel */
+      if (*ifcr & (1u << (4u * ch))) *reg(DMA1_ISR) &= ~(0xFu << (4u * ch));
+    *ifcr = 0;
+  }
+  spi_start();
+  dma_pump();
+}
+
+static void spi_publish(void) {
+  *reg(SPI1_SR) = (spi.rx_n ? 1u : 0u) | (spi.tx_full ? 0u : 2u) | (spi.ovr ? 1u << 6 : 0u)
+                | ((spi.shifting || spi.tx_full) ? 1u << 7 : 0u) | ((spi.rx_n < 3 ? spi.rx_n : 3u) << 9);
+  if (!spi.dr_write) *reg(SPI1_DR) = spi.rx_n ? spi.rxq[0] : 0u;
+}
+
+static int dma_line(int ch) {
+  uint32_t isr = *reg(DMA1_ISR) >> (4u * (ch - 1)), ccr = *reg(DMA_CH(ch));
+  return ((isr & 2u) && (ccr & 2u)) || ((isr & 8u) && (ccr & 8u));
+}
+
+/* ------------------------------------------------------------- sync */
+static void apply_writes(void) {
+  volatile uint32_t *cr = reg(RCC_CR), *cfgr = reg(RCC_CFGR);
+  *cr   = (*cr & ~((1u << 25) | (1u << 10))) | 2u                 /* MSIRDY */
+        | ((*cr & (1u << 24)) ? 1u << 25 : 0u) | ((*cr & (1u << 8)) ? 1u << 10 : 0u);
+  *cfgr = (*cfgr & ~(3u << 2)) | ((*cfgr & 3u) << 2);             /* SWS = SW */
+  clock_update();
+
+  for (unsigned i = 0; i < N_TIMS; ++i) tim_writes(&tims[i]);
+  for (unsigned i = 0; i < SIM_N_USARTS; ++i) usart_writes(&usarts[i]);
+  gpio_writes();
+  spi_writes();
+
+  uint32_t lcr = *reg(LPTIM1_CR);
+  if ((lcr & 5u) == 5u && !lptim.running) {
+    lptim.running = 1;
+    lptim.t0 = now;
+  } else if (!(lcr & 1u)) {
+    lptim.running = 0;
+  }
+
+  uint32_t cyc = *reg(DWT_CYCCNT);
+  if (cyc != cyc_pub) cyc_offset += cyc - cyc_pub;
+}
+
+static void publish(void) {
+  for (unsigned i = 0; i < N_TIMS; ++i) {
+    tims[i].cnt_pub = tim_cnt(&tims[i]);
+    *reg(tims[i].base + TIM_CNT) = tims[i].cnt_pub;
+    tims[i].sr_pub = tims[i].sr;
+    *reg(tims[i].base + TIM_SR) = tims[i].sr;
+  }
+  for (unsigned i = 0; i < SIM_N_USARTS; ++i) {
+    usart_t *u = &usarts[i];
+    uint32_t cr1 = *reg(u->base + US_CR1);
+    *reg(u->base + US_ISR) = u->isr | ((cr1 & 8u) ? 1u << 21 : 0u) | ((cr1 & 4u) ? 1u << 22 : 0u);
+    *reg(u->base + US_RDR) = u->rdr;
+  }
+  gpio_publish();
+  spi_publish();
+  *reg(LPTIM1_CNT) = lptim.running ? (uint32_t)((now - lptim.t0) / LPTIM_TICK) & 0xFFFFu : 0u;
+  cyc_pub = cycles();
+  *reg(DWT_CYCCNT) = cyc_pub;
+}
+
+static int irq_line(int irq) {
+  switch (irq) {
+  case IRQ_DMA1_CH2: return dma_line(2);
+  case IRQ_DMA1_CH3: return dma_line(3);
+  case IRQ_TIM2:     return tim_line(&tims[0]);
+  case IRQ_TIM15:    return tim_line(&tims[1]);
+  case IRQ_TIM16:    return tim_line(&tims[2]);
+  case IRQ_USART1:   return usart_line(&usarts[SIM_USART1]);
+  case IRQ_USART2:   return usart_line(&usarts[SIM_USART2]);
+  default:           return 0;
+  }
+}
+
+static void sample_lines(void) {
+  for (unsigned v = 0; v < N_VECTORS; ++v) {
+    int irq = vectors[v].irq;
+    if (!irq_act[irq] && irq_line(irq)) irq_pend[irq] = 1;
+  }
+}
+
+static int irq_ready(int irq) { return irq_pend[irq] && irq_en[irq]; }
+
+static void step(unsigned cost);
+
+static void dispatch(void) {
+  while (!primask) {
+    int best = -1;
+    unsigned best_prio = cur_prio;
+    for (unsigned v = 0; v < N_VECTORS; ++v) {
+      int irq = vectors[v].irq;
+      if (vectors[v].handler && irq_ready(irq) && irq_prio[irq] < best_prio) {
+        best = (int)v;
+        best_prio = irq_prio[irq];
+      }
+    }
+    if (best < 0) return;
+
+    int irq = vectors[best].irq, saved_irq = cur_irq;
+    unsigned saved_prio = cur_prio;
+    irq_pend[irq] = 0;
+    irq_act[irq]  = 1;
+    sim_stats.irqs++;
+    cur_prio = best_prio;
+    cur_irq  = irq;
+    step(SIM_IRQ_ENTRY);
+    sig_atomic_t saved_in = in_sim;
+    in_sim = 0;
+    vectors[best].handler();
+    in_sim = saved_in;
+    step(SIM_IRQ_EXIT);
+    irq_act[irq] = 0;
+    cur_prio = saved_prio;
+    cur_irq  = saved_irq;
+    sample_lines();
+  }
+}
+
+/* Earliest peripheral or bench event, and which one it is */
+enum { EV_NONE, EV_TIM_UPD, EV_TIM_CC, EV_TX, EV_RX, EV_SPI, EV_BENCH };
+
+static sim_time_t next_event(int *kind, unsigned *idx) {
+  sim_time_t best = ~0ull;
+  *kind = EV_NONE;
+  for (unsigned i = 0; i < N_TIMS; ++i) {
+    if (!tims[i].running) continue;
+    sim_time_t u = tim_next_update(&tims[i]), c = tim_next_cc(&tims[i]);
+    if (u < best) { best = u; *kind = EV_TIM_UPD; *idx = i; }
+    if (c < best) { best = c; *kind = EV_TIM_CC;  *idx = i; }
+  }
+  for (unsigned i = 0; i < SIM_N_USARTS; ++i) {
+    if (usarts[i].shifting && usarts[i].tx_end < best)  { best = usarts[i].tx_end; *kind = EV_TX; *idx = i; }
+    if (usarts[i].rx_active && usarts[i].rx_end < best) { best = usarts[i].rx_end; *kind = EV_RX; *idx = i; }
+  }
+  if (spi.shifting && spi.t_end < best) { best = spi.t_end; *kind = EV_SPI; }
+  for (unsigned i = 0; i < n_events; ++i)
+    if (events[i].t < best) { best = events[i].t; *kind = EV_BENCH; *idx = i; }
+  return best;
+}
+
+static void run_event(int kind, unsigned idx, sim_time_t t) {
+  switch (kind) {
+  case EV_TIM_UPD: tim_update(&tims[idx], t); break;
+  case EV_TIM_CC:  tim_compare(&tims[idx], t); break;
+  case EV_TX:      usart_tx_done(&usarts[idx], (int)idx); break;
+  case EV_RX:      usart_rx_done(&usarts[idx], (int)idx); break;
+  case EV_SPI:     spi_done(); break;
+  case EV_BENCH: {
+    event_t e = events[idx];
+    events[idx] = events[--n_events];
+    e.fn(e.arg);
+    break;
+  }
+  }
+}
+
+/* Run events up to `target`, taking interrupts as they fire */
+static void advance(sim_time_t target) {
+  for (;;) {
+    int kind;
+    unsigned idx = 0;
+    sim_time_t t = next_event(&kind, &idx);
+    if (t_end <= target && t_end <= t) {
+      if (t_end > now) now = t_end;
+      siglongjmp(run_jmp, 1);
+    }
+    if (kind == EV_NONE || t > target) {
+      if (target > now) now = target;
+      return;
+    }
+    if (t > now) now = t;
+    run_event(kind, idx, t);
+    sample_lines();
+    dispatch();
+  }
+}
+
+static void step(unsigned cost) {
+  in_sim++;
+  n_sync++;
+  apply_writes();
+  advance(now + cost * cyc_ps);
+  sample_lines();
+  dispatch();
+  publish();
+  in_sim--;
+}
+
+/* Run the next event (or stop at t_end), account the gap to *acc */
+static void skip_to_event(sim_time_t *acc) {
+  int kind;
+  unsigned idx;
+  sim_time_t t = next_event(&kind, &idx), t0 = now;
+  if (kind == EV_NONE || t > t_end) t = t_end;
+  advance(t);
+  *acc += now - t0;
+  sample_lines();
+  dispatch();
+  publish();
+}
+
+/* CPU-time tick: no register access since the last one means the
+ * firmware spins on memory that only an interrupt can change, so it
+ * spins until the next one is taken */
+static void on_spin_tick(int sig) {
+  (void)sig;
+  if (in_sim || n_sync != spin_seen) {
+    spin_seen = n_sync;
+    return;
+  }
+  int e = errno;
+  unsigned long long taken = sim_stats.irqs;
+  in_sim++;
+  while (sim_stats.irqs == taken) skip_to_event(&sim_stats.spin);
+  in_sim--;
+  spin_seen = n_sync;
+  errno = e;
+}
+
+/* ------------------------------------------------------ firmware side */
+int sim_access(void) {
+  step(SIM_ACCESS_CYCLES);
+  return 0;
+}
+
+/* DR has one hook for both directions: with frames in the RX FIFO the
+ * access is taken as a read (it pops; DR keeps the popped frame until
+ * the next access publishes). Otherwise DR is set to DR_IDLE and the
+ * next access takes a changed value as a write; a write that leaves
+ * DR_IDLE's low bits as they were (0xC3 / 0xA5C3), or &SPI1->DR, is
+ * not a frame */
+int sim_access_dr(void) {
+  step(SIM_ACCESS_CYCLES);
+  if (spi.rx_n) {
+    memmove(spi.rxq, spi.rxq + 1, --spi.rx_n * sizeof spi.rxq[0]);
+  } else {
+    *reg(SPI1_DR) = DR_IDLE;
+    spi.dr_write = 1;
+  }
+  return 0;
+}
+
+/* RDR has no address in the hook: inside a USART handler it is that
+ * USART's, elsewhere every USART holding a byte gives it up (only
+ * USART1 receives in these benches) */
+int sim_read_rdr(void) {
+  step(SIM_ACCESS_CYCLES);
+  for (unsigned i = 0; i < SIM_N_USARTS; ++i)
+    if (cur_irq < 0 || cur_irq == usarts[i].irq
+        || (cur_irq != IRQ_USART1 && cur_irq != IRQ_USART2))
+      usarts[i].isr &= ~(1u << 5);
+  publish();
+  return 0;
+}
+
+uint32_t sim_get_primask(void) {
+  step(1);
+  return primask;
+}
+
+void sim_set_primask(uint32_t pm) {
+  primask = pm & 1u;
+  step(1);
+}
+
+uint32_t sim_ipsr(void) {
+  step(1);
+  return cur_irq >= 0 ? (uint32_t)cur_irq + 16u : 0u;
+}
+
+void sim_nvic_enable(int irq, int on) {
+  if (irq >= 0 && irq < N_IRQS) irq_en[irq] = (uint8_t)(on != 0);
+  step(SIM_ACCESS_CYCLES);
+}
+
+void sim_nvic_priority(int irq, uint32_t prio) {
+  if (irq >= 0 && irq < N_IRQS) irq_prio[irq] = (uint8_t)(prio & 0xFu);
+  step(SIM_ACCESS_CYCLES);
+}
+
+void sim_nvic_pend(int irq, int on) {
+  if (irq >= 0 && irq < N_IRQS) irq_pend[irq] = (uint8_t)(on != 0);
+  step(SIM_ACCESS_CYCLES);
+}
+
+/* Sleep until an interrupt is pending (taken at once if PRIMASK is clear) */
+void sim_wfi(void) {
+  unsigned long long taken = sim_stats.irqs;
+  step(1);
+  in_sim++;
+  for (;;) {
+    int wake = (sim_stats.irqs != taken);
+    for (unsigned v = 0; v < N_VECTORS && !wake; ++v)
+      wake = irq_ready(vectors[v].irq) && irq_prio[vectors[v].irq] < cur_prio;
+    if (wake) break;
+    skip_to_event(&sim_stats.sleep);
+  }
+  in_sim--;
+}
+
+/* ------------------------------------------------------- bench side */
+sim_time_t sim_now(void) { return now; }
+uint32_t   sim_hclk(void) { return hclk; }
+
+void sim_at(sim_time_t t, sim_event_fn_t fn, void *arg) {
+  if (n_events == cap_events) {
+    cap_events = cap_events ? 2u * cap_events : 16u;
+    events = realloc(events, cap_events * sizeof *events);
+  }
+  events[n_events++] = (event_t){ t < now ? now : t, fn, arg };
+}
+
+void sim_uart_remote(int port, uint32_t baud, sim_tx_fn_t on_tx) {
+  usart_t *u = &usarts[port];
+  u->remote_byte_ps = 10ull * SIM_PS_PER_S / baud;               /* 8N1 */
+  u->on_tx = on_tx;
+}
+
+void sim_uart_send(int port, const void *data, unsigned n) {
+  usart_t *u = &usarts[port];
+  if (u->q_head - u->q_tail + n > u->q_cap) {
+    unsigned cap = u->q_cap ? u->q_cap : 256u;
+    while (cap < u->q_head - u->q_tail + n) cap *= 2u;
+    uint8_t *q = malloc(cap);
+    for (unsigned i = 0; u->q_tail + i != u->q_head; ++i) q[i] = u->q[(u->q_tail + i) % u->q_cap];
+    u->q_head -= u->q_tail;
+    u->q_tail = 0;
+    free(u->q);
+    u->q = q;
+    u->q_cap = cap;
+  }
+  for (unsigned i = 0; i < n; ++i) u->q[u->q_head++ % u->q_cap] = ((const uint8_t *)data)[i];
+  usart_rx_start(u);
+}
+
+unsigned sim_uart_queued(int port) {
+  const usart_t *u = &usarts[port];
+  return u->q_head - u->q_tail + (unsigned)u->rx_active;
+}
+
+uint32_t sim_uart_baud(int port) {
+  const usart_t *u = &usarts[port];
+  uint32_t brr = *reg(u->base + US_BRR) & 0xFFFFu;
+  return brr ? usart_kernel_clock(u) / brr : 0u;
+}
+
+void sim_gpio_watch(sim_pin_fn_t fn) { pin_watch = fn; }
+
+void sim_spi_attach(int cs_pin, int active_low, const sim_spi_dev_t *dev) {
+  if (n_slaves == sizeof slaves / sizeof slaves[0]) return;
+  slaves[n_slaves++] = (spi_slave_t){ cs_pin, active_low != 0, 0, dev };
+}
+
+int sim_gpio_level(int pin) { return (int)((odr_pub[pin / 16] >> (pin % 16)) & 1u); }
+
+static void map_fixed(uintptr_t base, size_t len) {
+  void *p = mmap((void *)base, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE, -1, 0);
+  if (p != (void *)base) {
+    fprintf(stderr, "sim: cannot map registers at 0x%08lx\n", (unsigned long)base);
+    exit(2);
+  }
+}
+
+void sim_init(void) {
+  map_fixed(0x40000000u, 0x08001000u);          /* APB1 .. AHB2 (GPIO) */
+  map_fixed(0xE0000000u, 0x00100000u);          /* core peripherals    */
+
+  /* Reset values the firmware polls or builds on */
+  *reg(RCC_CR)      = 0x00000063u;              /* MSI on, ready, 4 MHz */
+  *reg(RCC_CSR)     = 6u << 8;
+  *reg(RCC_PLLCFGR) = 0x00001000u;
+  *reg(gpio_base[0] + GP_MODER) = 0xABFFFFFFu;
+  *reg(gpio_base[1] + GP_MODER) = 0xFFFFFEBFu;
+  *reg(gpio_base[2] + GP_MODER) = 0xFFFFFFFFu;
+  for (unsigned i = 0; i < N_TIMS; ++i) *reg(tims[i].base + TIM_ARR) = (uint32_t)(tims[i].span - 1ull);
+  for (unsigned i = 0; i < SIM_N_USARTS; ++i) {
+    usarts[i].isr = (1u << 7) | (1u << 6);      /* TXE, TC */
+    *reg(usarts[i].base + US_TDR) = TDR_IDLE;
+    sim_uart_remote((int)i, 115200u, 0);
+  }
+  clock_update();
+  publish();
+}
+
+static void spin_timer(int on) {
+  struct itimerval it = { { 0, on ? 1000 : 0 }, { 0, on ? 1000 : 0 } };
+  setitimer(ITIMER_VIRTUAL, &it, 0);
+}
+
+/* The firmware gets a stack below 2 GB: buffers on it go to DMA (CMAR) */
+#define FW_STACK (1u << 20)
+static ucontext_t fw_ctx, run_ctx;
+static int      (*fw_main)(void);
+static void      *fw_stack;
+
+static void fw_entry(void) { fw_main(); }     /* returns to run_ctx */
+
+int sim_run(int (*fw)(void), sim_time_t end) {
+  if (!fw_stack) {
+    fw_stack = mmap(0, FW_STACK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (fw_stack == MAP_FAILED) {
+      fprintf(stderr, "sim: cannot map the firmware stack\n");
+      exit(2);
+    }
+  }
+  fw_main = fw;
+  getcontext(&fw_ctx);
+  fw_ctx.uc_stack.ss_sp   = fw_stack;
+  fw_ctx.uc_stack.ss_size = FW_STACK;
+  fw_ctx.uc_link          = &run_ctx;
+  makecontext(&fw_ctx, fw_entry, 0);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof sa);
+  sa.sa_handler = on_spin_tick;
+  sa.sa_flags   = SA_NODEFER | SA_RESTART;    /* handlers may spin too */
+  sigaction(SIGVTALRM, &sa, 0);
+
+  t_end = end;
+  if (sigsetjmp(run_jmp, 1)) {
+    spin_timer(0);
+    in_sim = 0;
+    return 0;
+  }
+  spin_timer(1);
+  swapcontext(&run_ctx, &fw_ctx);
+  spin_timer(0);
+  return -1;
+}
@@ -0,0 +1,117 @@
+/*********************************************************************
+*  sim.h — E155 Lab 6: host register model (LAB6_HOST_SIM builds)
+*  - host/stm32l432xx.h turns every register access into
+*    sim_access(), which applies the firmware's previous writes,
+*    advances simulated time, takes interrupts in priority order
+*    and publishes live values (flags, CNT, CYCCNT, ...)
+*  - Modeled: RCC clock tree (MSI/HSI16/PLL, AHB/APB prescalers,
+*    ready bits), USART1/USART2 (BRR and kernel clock set the bit
+*    time; TXE/TC/RXNE/ORE, TDR -> shifter, RXNEIE/TXEIE/TCIE),
+*    GPIOA..C (MODER/ODR/BSRR/BRR/IDR), TIM2/TIM15/TIM16 (PSC
+*    preload, ARR, CNT, UG, URS, OPM, UIF and CC1IF interrupts),
+*    NVIC priorities, PRIMASK, IPSR, WFI, DWT_CYCCNT, SPI1 (frames
+*    of DS bits at PCLK2 / 2^(BR+1), one-frame TX buffer, 4-frame RX
+*    FIFO, TXE/RXNE/BSY/OVR) and its DMA channels (2 RX, 3 TX, one
+*    frame per request, TCIF at CNDTR = 0), LPTIM1 (CNT free
+*    running at 16 MHz from CNTSTRT)
+*  - Devices on SPI1 are bench models attached to a chip-select
+*    pin; they see each frame at its last SCK edge
+*  - Time is in picoseconds. Register accesses cost
+*    SIM_ACCESS_CYCLES of HCLK, interrupt entry/exit SIM_IRQ_ENTRY/
+*    EXIT; plain C between accesses is free
+*  - sim_run() runs the firmware on its own stack below 2 GB, so
+*    stack buffers handed to DMA fit CMAR; build with -no-pie for
+*    static ones
+*  - The far end of each USART is driven by the bench: bytes sent
+*    with sim_uart_send() arrive back to back at the remote baud,
+*    bytes the firmware transmits are handed to an on_tx callback
+*********************************************************************/
+#ifndef LAB6_SIM_H
+#define LAB6_SIM_H
+
+#include <stdint.h>
+
+#define SIM_ACCESS_CYCLES  2u
+#define SIM_IRQ_ENTRY     12u
+#define SIM_IRQ_EXIT      10u
+
+typedef unsigned long long sim_time_t;          /* ps */
+#define SIM_PS_PER_S  1000000000000ull
+#define SIM_PS_PER_US 1000000ull
+
+/* Firmware side (called through host/stm32l432xx.h) */
+int      sim_access(void);
+int      sim_access_dr(void);                   /* SPI1 DR */
+int      sim_read_rdr(void);                    /* USART RDR: clears RXNE */
+uint32_t sim_get_primask(void);
+void     sim_set_primask(uint32_t pm);
+uint32_t sim_ipsr(void);
+void     sim_wfi(void);
+void     sim_nvic_enable(int irq, int on);
+void     sim_nvic_priority(int irq, uint32_t prio);
+void     sim_nvic_pend(int irq, int on);
+
+/* Test-bench side */
+enum { SIM_USART1, SIM_USART2, SIM_N_USARTS };
+
+typedef void (*sim_event_fn_t)(void *arg);
+typedef void (*sim_tx_fn_t)(int port, uint8_t byte, sim_time_t t_end);
+typedef void (*sim_pin_fn_t)(int pin, int level, sim_time_t t);
+
+typedef struct {
+  unsigned long long bytes;                     /* completed on the wire */
+  sim_time_t         busy;                      /* line not idle         */
+} sim_line_t;
+
+typedef struct {
+  sim_line_t    tx[SIM_N_USARTS];               /* MCU -> remote         */
+  sim_line_t    rx[SIM_N_USARTS];               /* remote -> MCU         */
+  unsigned      rx_overruns[SIM_N_USARTS];      /* lost: RXNE still set  */
+  unsigned      rx_off[SIM_N_USARTS];           /* lost: UE/RE off       */
+  unsigned long long irqs;
+  sim_time_t    sleep;                          /* in WFI                */
+  unsigned      clock_switches;                 /* HCLK changes          */
+  sim_time_t    spin;                           /* thread spinning on RAM */
+  unsigned      spi_frames;
+} sim_stats_t;
+
+extern sim_stats_t sim_stats;
+
+/* Map the register space and reset the model. Call once. */
+void       sim_init(void);
+/* Run fw (the firmware's main) until t_end, then return 0; returns -1
+ * if fw returns first */
+int        sim_run(int (*fw)(void), sim_time_t t_end);
+sim_time_t sim_now(void);
+/* Call fn(arg) at t (not before now); ordered with the peripheral events */
+void       sim_at(sim_time_t t, sim_event_fn_t fn, void *arg);
+
+/* Remote end of a USART: send bytes to the MCU at `baud` (8N1), back to
+ * back after whatever is still queued; get each byte the MCU sends */
+void       sim_uart_remote(int port, uint32_t baud, sim_tx_fn_t on_tx);
+void       sim_uart_send(int port, const void *data, unsigned n);
+unsigned   sim_uart_queued(int port);            /* not yet on the wire */
+uint32_t   sim_uart_baud(int port);              /* MCU side, from BRR  */
+
+/* Output pin changes (pin numbers as in STM32L432KC_GPIO.h) */
+void       sim_gpio_watch(sim_pin_fn_t fn);
+int        sim_gpio_level(int pin);
+
+/* SPI1 device: select() on chip-select edges, frame() once per frame
+ * with what the master sent; returns what the device drove on MISO */
+typedef struct {
+  uint8_t  bits, cpol, cpha;
+  uint32_t sck_hz;
+} sim_spi_frame_t;
+
+typedef struct {
+  void      *ctx;
+  void     (*select)(void *ctx, int on, sim_time_t t);
+  uint16_t (*frame)(void *ctx, uint16_t mosi, const sim_spi_frame_t *f, sim_time_t t);
+} sim_spi_dev_t;
+
+void       sim_spi_attach(int cs_pin, int active_low, const sim_spi_dev_t *dev);
+
+uint32_t   sim_hclk(void);
+
+#endif /* LAB6_SIM_H */
@@ -0,0 +1,336 @@
+/*********************************************************************
+*  stm32l432xx.h — E155 Lab 6: host stand-in for the CMSIS device
+*  header (LAB6_HOST_SIM builds, see sim.h)
+*  - Same register layout at the same addresses; sim.c maps the
+*    peripheral and core address ranges, so pointers such as
+*    (uint32_t)&SPI1->DR mean what they mean on the part
+*  - Every register field is a one-element array and its name is a
+*    macro that indexes it through sim_access(): each access first
+*    runs the model (time, interrupts), like lab4_regs.h does with
+*    sim_addr(). USART RDR and SPI DR have their own hooks because
+*    reading them has a side effect
+*  - Core intrinsics (PRIMASK, WFI, NVIC) call into the model
+*  - Only what the Lab 6 sources use is defined
+*********************************************************************/
+#ifndef LAB6_HOST_STM32L432XX_H
+#define LAB6_HOST_STM32L432XX_H
+
+#include <stdint.h>
+#include "sim.h"
+
+#define __IO volatile
+#define REG_(name)    __IO uint32_t name[1]
+
+typedef enum {
+  DMA1_Channel2_IRQn  = 12, DMA1_Channel3_IRQn  = 13,
+  TIM1_BRK_TIM15_IRQn = 24, TIM1_UP_TIM16_IRQn  = 25, TIM2_IRQn = 28,
+  SPI1_IRQn           = 35, USART1_IRQn         = 37, USART2_IRQn = 38,
+} IRQn_Type;
+
+/* ---------------------------------------------------------- registers */
+typedef struct {
+  REG_(CR1); REG_(CR2); REG_(SMCR); REG_(DIER); REG_(SR); REG_(EGR);
+  REG_(CCMR1); REG_(CCMR2); REG_(CCER); REG_(CNT); REG_(PSC); REG_(ARR);
+  REG_(RCR); REG_(CCR1); REG_(CCR2); REG_(CCR3); REG_(CCR4);
+} TIM_TypeDef;
+
+typedef struct {
+  REG_(MODER); REG_(OTYPER); REG_(OSPEEDR); REG_(PUPDR); REG_(IDR); REG_(ODR);
+  REG_(BSRR); REG_(LCKR); __IO uint32_t AFR[1][2]; REG_(BRR);
+} GPIO_TypeDef;
+
+typedef struct {
+  REG_(CR); REG_(ICSCR); REG_(CFGR); REG_(PLLCFGR); REG_(PLLSAI1CFGR);
+  uint32_t RESERVED0; REG_(CIER); REG_(CIFR); REG_(CICR); uint32_t RESERVED1;
+  REG_(AHB1RSTR); REG_(AHB2RSTR); REG_(AHB3RSTR); uint32_t RESERVED2;
+  REG_(APB1RSTR1); REG_(APB1RSTR2); REG_(APB2RSTR); uint32_t RESERVED3;
+  REG_(AHB1ENR); REG_(AHB2ENR); REG_(AHB3ENR); uint32_t RESERVED4;
+  REG_(APB1ENR1); REG_(APB1ENR2); REG_(APB2ENR); uint32_t RESERVED5[9];
+  REG_(CCIPR); uint32_t RESERVED6; REG_(BDCR); REG_(CSR);
+} RCC_TypeDef;
+
+typedef struct { REG_(ACR); } FLASH_TypeDef;
+typedef struct { REG_(CR1); REG_(CR2); REG_(CR3); REG_(CR4); REG_(SR1); REG_(SR2); } PWR_TypeDef;
+
+typedef struct {
+  REG_(CR1); REG_(CR2); REG_(SR); __IO uint32_t DR[1];
+} SPI_TypeDef;
+
+typedef struct {
+  REG_(CR1); REG_(CR2); REG_(CR3); REG_(BRR); REG_(GTPR); REG_(RTOR); REG_(RQR);
+  REG_(ISR); REG_(ICR); __IO uint32_t RDR[1]; REG_(TDR);
+} USART_TypeDef;
+
+typedef struct { REG_(CCR); REG_(CNDTR); REG_(CPAR); REG_(CMAR); } DMA_Channel_TypeDef;
+typedef struct { REG_(ISR); REG_(IFCR); } DMA_TypeDef;
+typedef struct { REG_(CSELR); } DMA_Request_TypeDef;
+
+typedef struct {
+  REG_(ISR); REG_(ICR); REG_(IER); REG_(CFGR); REG_(CR); REG_(CMP); REG_(ARR); REG_(CNT);
+} LPTIM_TypeDef;
+
+typedef struct { REG_(CTRL); REG_(CYCCNT); } DWT_Type;
+typedef struct { REG_(DHCSR); REG_(DCRSR); REG_(DCRDR); REG_(DEMCR); } CoreDebug_Type;
+
+/* Field names route through the model (a macro is not re-expanded
+ * inside its own body, so the struct member keeps its name) */
+#define CR1      CR1[sim_access()]
+#define CR2      CR2[sim_access()]
+#define CR3      CR3[sim_access()]
+#define CR4      CR4[sim_access()]
+#define SMCR     SMCR[sim_access()]
+#define DIER     DIER[sim_access()]
+#define SR       SR[sim_access()]
+#define SR1      SR1[sim_access()]
+#define SR2      SR2[sim_access()]
+#define EGR      EGR[sim_access()]
+#define CCMR1    CCMR1[sim_access()]
+#define CCMR2    CCMR2[sim_access()]
+#define CCER     CCER[sim_access()]
+#define CNT      CNT[sim_access()]
+#define PSC      PSC[sim_access()]
+#define ARR      ARR[sim_access()]
+#define CCR1     CCR1[sim_access()]
+#define CCR2     CCR2[sim_access()]
+#define MODER    MODER[sim_access()]
+#define OTYPER   OTYPER[sim_access()]
+#define OSPEEDR  OSPEEDR[sim_access()]
+#define PUPDR    PUPDR[sim_access()]
+#define IDR      IDR[sim_access()]
+#define ODR      ODR[sim_access()]
+#define BSRR     BSRR[sim_access()]
+#define AFR      AFR[sim_access()]
+#define BRR      BRR[sim_access()]
+#define CR       CR[sim_access()]
+#define CFGR     CFGR[sim_access()]
+#define PLLCFGR  PLLCFGR[sim_access()]
+#define AHB1ENR  AHB1ENR[sim_access()]
+#define AHB2ENR  AHB2ENR[sim_access()]
+#define APB1ENR1 APB1ENR1[sim_access()]
+#define APB2ENR  APB2ENR[sim_access()]
+#define CCIPR    CCIPR[sim_access()]
+#define CSR      CSR[sim_access()]
+#define ACR      ACR[sim_access()]
+#define DR       DR[sim_access_dr()]
+#define ISR      ISR[sim_access()]
+#define ICR      ICR[sim_access()]
+#define RDR      RDR[sim_read_rdr()]
+#define TDR      TDR[sim_access()]
+#define CCR      CCR[sim_access()]
+#define CNDTR    CNDTR[sim_access()]
+#define CPAR     CPAR[sim_access()]
+#define CMAR     CMAR[sim_access()]
+#define IFCR     IFCR[sim_access()]
+#define CSELR    CSELR[sim_access()]
+#define CTRL     CTRL[sim_access()]
+#define CYCCNT   CYCCNT[sim_access()]
+#define DEMCR    DEMCR[sim_access()]
+
+#define TIM2_BASE     0x40000000u
+#define PWR_BASE      0x40007000u
+#define LPTIM1_BASE   0x40007C00u
+#define USART2_BASE   0x40004400u
+#define SPI1_BASE     0x40013000u
+#define USART1_BASE   0x40013800u
+#define TIM15_BASE    0x40014000u
+#define TIM16_BASE    0x40014400u
+#define DMA1_BASE     0x40020000u
+#define RCC_BASE      0x40021000u
+#define FLASH_R_BASE  0x40022000u
+#define GPIOA_BASE    0x48000000u
+#define GPIOB_BASE    0x48000400u
+#define GPIOC_BASE    0x48000800u
+#define DWT_BASE      0xE0001000u
+#define CoreDebug_BASE 0xE000EDF0u
+
+#define TIM1          ((TIM_TypeDef *)0x40012C00u)   /* compared against, not modeled */
+#define TIM2          ((TIM_TypeDef *)TIM2_BASE)
+#define TIM15         ((TIM_TypeDef *)TIM15_BASE)
+#define TIM16         ((TIM_TypeDef *)TIM16_BASE)
+#define GPIOA         ((GPIO_TypeDef *)GPIOA_BASE)
+#define GPIOB         ((GPIO_TypeDef *)GPIOB_BASE)
+#define GPIOC         ((GPIO_TypeDef *)GPIOC_BASE)
+#define RCC           ((RCC_TypeDef *)RCC_BASE)
+#define FLASH         ((FLASH_TypeDef *)FLASH_R_BASE)
+#define PWR           ((PWR_TypeDef *)PWR_BASE)
+#define LPTIM1        ((LPTIM_TypeDef *)LPTIM1_BASE)
+#define SPI1          ((SPI_TypeDef *)SPI1_BASE)
+#define USART1        ((USART_TypeDef *)USART1_BASE)
+#define USART2        ((USART_TypeDef *)USART2_BASE)
+#define DMA1          ((DMA_TypeDef *)DMA1_BASE)
+#define DMA1_Channel2 ((DMA_Channel_TypeDef *)(DMA1_BASE + 0x1Cu))
+#define DMA1_Channel3 ((DMA_Channel_TypeDef *)(DMA1_BASE + 0x30u))
+#define DMA1_CSELR    ((DMA_Request_TypeDef *)(DMA1_BASE + 0xA8u))
+#define DWT           ((DWT_Type *)DWT_BASE)
+#define CoreDebug     ((CoreDebug_Type *)CoreDebug_BASE)
+
+extern uint32_t SystemCoreClock;
+
+/* ------------------------------------------------------------- core */
+static inline uint32_t __get_PRIMASK(void)       { return sim_get_primask(); }
+static inline void     __set_PRIMASK(uint32_t pm) { sim_set_primask(pm); }
+static inline void     __disable_irq(void)        { sim_set_primask(1); }
+static inline void     __enable_irq(void)         { sim_set_primask(0); }
+static inline uint32_t __get_IPSR(void)           { return sim_ipsr(); }
+static inline void     __WFI(void)                { sim_wfi(); }
+static inline void     __DMB(void)                { __sync_synchronize(); }
+static inline void     __DSB(void)                { __sync_synchronize(); }
+static inline void     __ISB(void)                { }
+static inline void     __NOP(void)                { }
+
+static inline void NVIC_EnableIRQ(IRQn_Type irq)                { sim_nvic_enable((int)irq, 1); }
+static inline void NVIC_DisableIRQ(IRQn_Type irq)               { sim_nvic_enable((int)irq, 0); }
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t p)  { sim_nvic_priority((int)irq, p); }
+static inline void NVIC_SetPendingIRQ(IRQn_Type irq)            { sim_nvic_pend((int)irq, 1); }
+static inline void NVIC_ClearPendingIRQ(IRQn_Type irq)          { sim_nvic_pend((int)irq, 0); }
+
+#define _VAL2FLD(field, value) (((uint32_t)(value) << field ## _Pos) & field ## _Msk)
+#define _FLD2VAL(field, value) (((uint32_t)(value) & field ## _Msk) >> field ## _Pos)
+
+/* ------------------------------------------------------------- bits */
+#define TIM_CR1_CEN            (1u << 0)
+#define TIM_CR1_UDIS           (1u << 1)
+#define TIM_CR1_URS            (1u << 2)
+#define TIM_CR1_OPM            (1u << 3)
+#define TIM_CR1_ARPE           (1u << 7)
+#define TIM_DIER_UIE           (1u << 0)
+#define TIM_DIER_CC1IE         (1u << 1)
+#define TIM_SR_UIF             (1u << 0)
+#define TIM_SR_CC1IF           (1u << 1)
+#define TIM_EGR_UG             (1u << 0)
+
+#define RCC_CR_MSION           (1u << 0)
+#define RCC_CR_MSIRDY          (1u << 1)
+#define RCC_CR_MSIRGSEL        (1u << 3)
+#define RCC_CR_MSIRANGE_Pos    4
+#define RCC_CR_MSIRANGE        (0xFu << 4)
+#define RCC_CR_HSION           (1u << 8)
+#define RCC_CR_HSIRDY          (1u << 10)
+#define RCC_CR_PLLON           (1u << 24)
+#define RCC_CR_PLLRDY          (1u << 25)
+#define RCC_CFGR_SW            (3u << 0)
+#define RCC_CFGR_SW_MSI        0u
+#define RCC_CFGR_SW_HSI        1u
+#define RCC_CFGR_SW_PLL        3u
+#define RCC_CFGR_SWS           (3u << 2)
+#define RCC_CFGR_SWS_MSI       (0u << 2)
+#define RCC_CFGR_SWS_HSI       (1u << 2)
+#define RCC_CFGR_SWS_PLL       (3u << 2)
+#define RCC_CFGR_HPRE_Pos      4
+#define RCC_CFGR_HPRE          (0xFu << 4)
+#define RCC_CFGR_PPRE1_Pos     8
+#define RCC_CFGR_PPRE1         (7u << 8)
+#define RCC_CFGR_PPRE2_Pos     11
+#define RCC_CFGR_PPRE2         (7u << 11)
+#define RCC_PLLCFGR_PLLSRC_Pos 0
+#define RCC_PLLCFGR_PLLSRC_Msk (3u << 0)
+#define RCC_PLLCFGR_PLLSRC_MSI 1u
+#define RCC_PLLCFGR_PLLSRC_HSI 2u
+#define RCC_PLLCFGR_PLLM_Pos   4
+#define RCC_PLLCFGR_PLLM_Msk   (7u << 4)
+#define RCC_PLLCFGR_PLLN_Pos   8
+#define RCC_PLLCFGR_PLLN_Msk   (0x7Fu << 8)
+#define RCC_PLLCFGR_PLLREN     (1u << 24)
+#define RCC_PLLCFGR_PLLR_Pos   25
+#define RCC_PLLCFGR_PLLR_Msk   (3u << 25)
+#define RCC_AHB1ENR_DMA1EN     (1u << 0)
+#define RCC_AHB2ENR_GPIOAEN    (1u << 0)
+#define RCC_AHB2ENR_GPIOBEN    (1u << 1)
+#define RCC_AHB2ENR_GPIOCEN    (1u << 2)
+#define RCC_APB1ENR1_TIM2EN    (1u << 0)
+#define RCC_APB1ENR1_USART2EN  (1u << 17)
+#define RCC_APB1ENR1_PWREN     (1u << 28)
+#define RCC_APB1ENR1_LPTIM1EN  (1u << 31)
+#define RCC_APB2ENR_SPI1EN     (1u << 12)
+#define RCC_APB2ENR_USART1EN   (1u << 14)
+#define RCC_APB2ENR_TIM15EN    (1u << 16)
+#define RCC_APB2ENR_TIM16EN    (1u << 17)
+#define RCC_CCIPR_USART1SEL_Pos 0
+#define RCC_CCIPR_USART2SEL_Pos 2
+#define RCC_CCIPR_LPTIM1SEL_Pos 18
+#define RCC_CCIPR_LPTIM1SEL    (3u << 18)
+
+#define LPTIM_CR_ENABLE        (1u << 0)
+#define LPTIM_CR_CNTSTRT       (1u << 2)
+
+#define FLASH_ACR_LATENCY_Pos  0
+#define FLASH_ACR_LATENCY      (7u << 0)
+#define FLASH_ACR_PRFTEN       (1u << 8)
+#define FLASH_ACR_ICEN         (1u << 9)
+#define FLASH_ACR_DCEN         (1u << 10)
+
+#define PWR_CR1_VOS_Pos        9
+#define PWR_CR1_VOS            (3u << 9)
+#define PWR_SR2_VOSF           (1u << 10)
+
+#define GPIO_AFRL_AFSEL2_Pos   8
+#define GPIO_AFRL_AFSEL5_Pos   20
+#define GPIO_AFRL_AFSEL6_Pos   24
+#define GPIO_AFRL_AFSEL7_Pos   28
+#define GPIO_AFRH_AFSEL9_Pos   4
+#define GPIO_AFRH_AFSEL10_Pos  8
+#define GPIO_AFRH_AFSEL15_Pos  28
+
+#define SPI_CR1_CPHA           (1u << 0)
+#define SPI_CR1_CPOL           (1u << 1)
+#define SPI_CR1_MSTR           (1u << 2)
+#define SPI_CR1_BR_Pos         3
+#define SPI_CR1_BR             (7u << 3)
+#define SPI_CR1_SPE            (1u << 6)
+#define SPI_CR1_SSI            (1u << 8)
+#define SPI_CR1_SSM            (1u << 9)
+#define SPI_CR2_RXDMAEN        (1u << 0)
+#define SPI_CR2_TXDMAEN        (1u << 1)
+#define SPI_CR2_SSOE           (1u << 2)
+#define SPI_CR2_DS_Pos         8
+#define SPI_CR2_DS             (0xFu << 8)
+#define SPI_CR2_FRXTH          (1u << 12)
+#define SPI_SR_RXNE            (1u << 0)
+#define SPI_SR_TXE             (1u << 1)
+#define SPI_SR_BSY             (1u << 7)
+
+#define USART_CR1_UE           (1u << 0)
+#define USART_CR1_RE           (1u << 2)
+#define USART_CR1_TE           (1u << 3)
+#define USART_CR1_RXNEIE       (1u << 5)
+#define USART_CR1_TCIE         (1u << 6)
+#define USART_CR1_TXEIE        (1u << 7)
+#define USART_CR1_M0           (1u << 12)
+#define USART_CR1_OVER8        (1u << 15)
+#define USART_CR1_M1           (1u << 28)
+#define USART_CR2_STOP         (3u << 12)
+#define USART_ISR_ORE          (1u << 3)
+#define USART_ISR_RXNE         (1u << 5)
+#define USART_ISR_TC           (1u << 6)
+#define USART_ISR_TXE          (1u << 7)
+#define USART_ICR_ORECF        (1u << 3)
+#define USART_ICR_TCCF         (1u << 6)
+
+#define DMA_CCR_EN             (1u << 0)
+#define DMA_CCR_TCIE           (1u << 1)
+#define DMA_CCR_HTIE           (1u << 2)
+#define DMA_CCR_TEIE           (1u << 3)
+#define DMA_CCR_DIR            (1u << 4)
+#define DMA_CCR_CIRC           (1u << 5)
+#define DMA_CCR_PINC           (1u << 6)
+#define DMA_CCR_MINC           (1u << 7)
+#define DMA_CCR_PSIZE_Pos      8
+#define DMA_CCR_MSIZE_Pos      10
+#define DMA_CCR_PL_Pos         12
+#define DMA_CSELR_C2S_Pos      4
+#define DMA_CSELR_C3S_Pos      8
+#define DMA_CSELR_C2S          (0xFu << 4)
+#define DMA_CSELR_C3S          (0xFu << 8)
+#define DMA_ISR_GIF2           (1u << 4)
+#define DMA_ISR_TCIF2          (1u << 5)
+#define DMA_ISR_TEIF2          (1u << 7)
+#define DMA_ISR_GIF3           (1u << 8)
+#define DMA_ISR_TCIF3          (1u << 9)
+#define DMA_ISR_TEIF3          (1u << 11)
+#define DMA_IFCR_CGIF2         (1u << 4)
+#define DMA_IFCR_CGIF3         (1u << 8)
+
+#define DWT_CTRL_CYCCNTENA_Msk     (1u << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+
+#endif /* LAB6_HOST_STM32L432XX_H */
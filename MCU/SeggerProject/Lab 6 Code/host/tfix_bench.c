@@ -0,0 +1,93 @@
+/*********************************************************************
+*  tfix_bench.c — E155 Lab 6: host check and benchmark of ../tfix.c
+*  - For every reading the DS1722 can produce (-55..125 °C at 8..12
+*    bits) formats °C, °F and the step both ways: the old main.c
+*    float path (quantize_by_bits + snprintf "%.*f") and tfix
+*  - Counts strings that differ, then reports ns per reading for each
+*  - Usage: tfix_bench [-n reps]
+*********************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../tfix.h"
+
+/* ------------------------------------------------------ old main.c path */
+static int decimals_for_bits(int bits){
+  if (bits <= 8) return 0;
+  int d = bits - 8;
+  return (d > 4) ? 4 : d;
+}
+
+static float quantize_by_bits(float tC, int bits){
+  int shift = (bits <= 8) ? 0 : (bits - 8);
+  float step = 1.0f / (float)(1u << shift);
+  float scaled = tC / step;
+  int32_t q = (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+  return q * step;
+}
+
+static void old_path(int16_t raw, int bits, char *c, char *f, char *st){
+  int dec = decimals_for_bits(bits);
+  float tC = quantize_by_bits((float)raw / 256, bits);
+  float tF = (tC * 9.0f / 5.0f) + 32.0f;
+  snprintf(c, 16, "%.*f", dec, tC);
+  snprintf(f, 16, "%.*f", dec, tF);
+  snprintf(st, 16, "%.4f", 1.0f / (float)(1u << ((bits <= 8)? 0 : (bits - 8))));
+}
+
+static void new_path(int16_t raw, int bits, char *c, char *f, char *st){
+  int dec = tfix_decimals(bits);
+  int16_t q = tfix_quantize(raw, bits);
+  tfix_format(c, tfix_c_e4(q), dec);
+  tfix_format(f, tfix_f_e4(q), dec);
+  tfix_format(st, tfix_step_e4(bits), 4);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long reps = 200;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) reps = atol(argv[++i]);
+    else { fprintf(stderr, "usage: %s [-n reps]\n", argv[0]); return 1; }
+  }
+
+  unsigned checked = 0, bad = 0;
+  for (int bits = 8; bits <= 12; ++bits) {
+    int stride = 1 << (16 - bits);
+    for (int32_t raw = -55 * 256; raw <= 125 * 256; raw += stride) {
+      char c0[16], f0[16], s0[16], c1[TFIX_BUF_LEN], f1[TFIX_BUF_LEN], s1[TFIX_BUF_LEN];
+      old_path((int16_t)raw, bits, c0, f0, s0);
+      new_path((int16_t)raw, bits, c1, f1, s1);
+      checked++;
+      if (strcmp(c0, c1) || strcmp(f0, f1) || strcmp(s0, s1)) {
+        if (bad++ < 10) printf("%2d-bit raw %6d: %s %s %s  vs  %s %s %s\n",
+                               bits, raw, c0, f0, s0, c1, f1, s1);
+      }
+    }
+  }
+  printf("readings %u, differing %u\n\n", checked, bad);
+
+  printf("%-6s  %10s\n", "path", "ns/read");
+  for (int path = 0; path < 2; ++path) {
+    char c[16], f[16], st[16];
+    unsigned n = 0;
+    volatile char sink = 0;
+    double t0 = now_ns();
+    for (long k = 0; k < reps; ++k)
+      for (int32_t raw = -55 * 256; raw <= 125 * 256; raw += 16, ++n) {
+        if (path) new_path((int16_t)raw, 12, c, f, st);
+        else old_path((int16_t)raw, 12, c, f, st);
+        sink ^= c[0] ^ f[1];
+      }
+    printf("%-6s  %10.1f\n", path ? "tfix" : "float", (now_ns() - t0) / n);
+  }
+  return bad != 0;
+}
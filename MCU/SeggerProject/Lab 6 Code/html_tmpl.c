@@ -0,0 +1,26 @@
+// html_tmpl.c
+// Fixed-width slot patching for a prebuilt page (see html_tmpl.h)
+
+#include <string.h>
+#include "html_tmpl.h"
+
+void tmpl_init(tmpl_t *t){
+  memcpy(t->ram, t->text, t->len);
+}
+
+void tmpl_set_n(tmpl_t *t, int i, const char *s, uint16_t n){
+  const tmpl_slot_t *sl = &t->slots[i];
+  char *dst = t->ram + sl->off;
+  if (n > sl->width) n = sl->width;
+  uint16_t pad = sl->width - n;
+  memset(dst, ' ', pad);
+  memcpy(dst + pad, s, n);
+}
+
+void tmpl_set(tmpl_t *t, int i, const char *s){
+  tmpl_set_n(t, i, s, (uint16_t)strlen(s));
+}
+
+void tmpl_send(const tmpl_t *t, USART_TypeDef *USART){
+  usartWrite(USART, t->ram, t->len);
+}
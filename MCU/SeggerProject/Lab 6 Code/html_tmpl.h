@@ -0,0 +1,38 @@
+// html_tmpl.h
+// Prebuilt response template: one contiguous page in flash with fixed-width
+// slots for the dynamic fields. The page is copied to RAM once, then each
+// request only rewrites its slots and queues the whole buffer in one write.
+
+#ifndef HTML_TMPL_H
+#define HTML_TMPL_H
+
+#include <stdint.h>
+#include "STM32L432KC_USART.h"
+
+// Offset of a slot = length of everything before it, so pass the
+// concatenation of the preceding string literals: TMPL_OFF(A B C)
+#define TMPL_OFF(...)   ((uint16_t)(sizeof(__VA_ARGS__) - 1u))
+#define TMPL_LEN(s)     ((uint16_t)(sizeof(s) - 1u))
+
+typedef struct {
+  uint16_t off;       // first byte of the slot in the page
+  uint16_t width;     // bytes reserved for the field
+} tmpl_slot_t;
+
+typedef struct {
+  const char        *text;    // page in flash (NUL not sent)
+  uint16_t           len;
+  const tmpl_slot_t *slots;
+  uint8_t            n_slots;
+  char              *ram;     // len bytes, filled by tmpl_init()
+} tmpl_t;
+
+void tmpl_init(tmpl_t *t);
+// Write s into slot i, right-aligned and space-padded; truncated if too long
+void tmpl_set(tmpl_t *t, int i, const char *s);
+// Same, for a field of known length (no NUL needed)
+void tmpl_set_n(tmpl_t *t, int i, const char *s, uint16_t n);
+// Queue the whole patched page (usartWrite copies it into the TX ring)
+void tmpl_send(const tmpl_t *t, USART_TypeDef *USART);
+
+#endif // HTML_TMPL_H
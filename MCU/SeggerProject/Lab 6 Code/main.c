@@ -2,10 +2,12 @@
  * main.c
  * Uses: STM32L432KC_* helpers + STM32L432KC_SPI + DS1722
  * UART1 @ 125000 to ESP8266; SPI1 to DS1722; LED on PB3
+ * Runs as cooperative tasks (sched.h): "rx" routes request bytes as the
+ * USART1 interrupt queues them, "http" writes the response as TX ring
+ * space frees up, "ds1722" (temp_sampler.c) reads the sensor.
  */
 
 #include <string.h>
-#include <stdio.h>
 #include <stdint.h>
 #include "main.h"
 
@@ -19,107 +21,530 @@
 // SPI + DS1722 adapters
 #include "STM32L432KC_SPI.h"
 #include "DS1722.h"
+#include "spi_bench.h"
+#include "usart_bench.h"
+#include "html_tmpl.h"
+#include "router.h"
+#include "temp_sampler.h"
+#include "tfix.h"
+#include "fmt_bench.h"
+#include "spibus_bench.h"
+#include "gpio_bench.h"
+#include "clock_bench.h"
+#include "swtimer.h"
+#include "swt_bench.h"
+#include "sched.h"
 
-// Simple HTML 
-static char* webpageStart =
-"<!DOCTYPE html><html><head><title>E155 Web Server Demo Webpage</title>"
-"<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
-"<style>body{font-family:system-ui;margin:1.2rem;}button,input{font-size:1.1rem;}"
-".note{color:#666;font-size:.9rem}</style>"
-"</head><body><h1>E155 Web Server Demo Webpage</h1>";
-
-static char* ledStr =
-"<h2>LED Control</h2>"
-"<form action=\"ledon\"><input type=\"submit\" value=\"Turn the LED on!\"></form>"
-"<form action=\"ledoff\"><input type=\"submit\" value=\"Turn the LED off!\"></form>";
-
-static char* webpageEnd = "</body></html>";
-
-// Helpers 
-static int inString(char request[], const char des[]) {
-  return (strstr(request, des) != NULL) ? 1 : -1;
-}
-
-static int updateLEDStatus(char request[]) {
-  int led_status = 0;
-  if (inString(request, "ledoff")==1) { digitalWrite(LED_PIN, 0); led_status = 0; }
-  else if (inString(request, "ledon")==1) { digitalWrite(LED_PIN, 1); led_status = 1; }
-  return led_status;
-}
-
-static void maybe_update_resolution(char request[]) {
-  if (inString(request, "res8")==1 || inString(request, "8bit")==1)       { setTempConfiguration(8);  }
-  else if (inString(request, "res9")==1 || inString(request, "9bit")==1)  { setTempConfiguration(9);  }
-  else if (inString(request, "res10")==1|| inString(request, "10bit")==1) { setTempConfiguration(10); }
-  else if (inString(request, "res11")==1|| inString(request, "11bit")==1) { setTempConfiguration(11); }
-  else if (inString(request, "res12")==1|| inString(request, "12bit")==1) { setTempConfiguration(12); }
-}
-
-static void resolutionControls(USART_TypeDef *USART) {
-  sendString(USART, "<h2>Temperature</h2>");
-  sendString(USART, "<p>Select DS1722 resolution:</p><div style='display:flex;gap:.5rem;flex-wrap:wrap'>");
-  sendString(USART, "<form action=\"res8\"><input type=\"submit\" value=\"8-bit\"></form>");
-  sendString(USART, "<form action=\"res9\"><input type=\"submit\" value=\"9-bit\"></form>");
-  sendString(USART, "<form action=\"res10\"><input type=\"submit\" value=\"10-bit\"></form>");
-  sendString(USART, "<form action=\"res11\"><input type=\"submit\" value=\"11-bit\"></form>");
-  sendString(USART, "<form action=\"res12\"><input type=\"submit\" value=\"12-bit\"></form>");
-  sendString(USART, "</div>");
-}
-
-// Extract 8/9/10/11/12-bit from CONFIG (R2:R1:R0 at bits 3..1; 1xx→12)
-static int ds1722_bits_from_cfg(uint8_t cfg){
-  uint8_t r = (cfg >> 1) & 0x7;
-  switch (r) {
-    case 0: return 8;
-    case 1: return 9;
-    case 2: return 10;
-    case 3: return 11;
-    default: return 12;
+// Clock scaling: CLK_RUN_HZ from the first byte of a request until its
+// response has left the TX ring, CLK_IDLE_HZ (MSI, PLL off) in between.
+// USART1 runs from HSI16, so RX/TX baud is the same at either clock.
+#ifndef CLK_SCALING
+#define CLK_SCALING 1
+#endif
+#define CLK_RUN_HZ   CLOCK_MAX_HZ
+#define CLK_IDLE_HZ  16000000u
+
+// Simple HTML page, prebuilt as one block. [slot] = fixed-width field
+// patched per request (see html_tmpl.h); everything else is sent as is.
+// The slots sit in elements that PAGE_SCRIPT refills: with scripts on, a
+// button fetches "<action>/slots" (the slots alone, see send_slots(); routes
+// match anywhere in the line) instead of loading the page; without, or if
+// the fetch fails, the link loads it as before. Buttons are links styled as
+// buttons and optional tags are left out, so that a full load is no bigger
+// than before the script.
+#define PAGE_HEAD \
+"<!DOCTYPE html><title>E155 Web Server Demo Webpage</title>" \
+"<meta name=viewport content=\"width=device-width\">" \
+"<style>body{font-family:system-ui;margin:1.2rem}" \
+"a{display:inline-block;margin:.2rem;padding:.3rem .6rem;border:1px solid}" \
+".n{color:#666;font-size:.9rem}</style>" \
+"<h1>E155 Web Server Demo Webpage</h1>" \
+"<h2>LED Control</h2>" \
+"<a href=ledon>Turn the LED on!</a><a href=ledoff>Turn the LED off!</a>" \
+"<h2>LED Status</h2><p id=l>"
+#define SLOT_LED      "LED is off!"                                  // [LED]
+#define PAGE_TEMP \
+"<h2>Temperature</h2>" \
+"<p>Select DS1722 resolution:<br>" \
+"<a href=res8>8-bit</a><a href=res9>9-bit</a><a href=res10>10-bit</a>" \
+"<a href=res11>11-bit</a><a href=res12>12-bit</a>" \
+"<p><b>Current temperature:</b> <span id=c>"
+#define SLOT_TC       "-55.0000"                                     // [°C]
+#define PAGE_TF       "</span> &deg;C (<span id=f>"
+#define SLOT_TF       "-67.0000"                                     // [°F]
+#define PAGE_RES      "</span> &deg;F)<p class=n>Resolution: <span id=b>"
+#define SLOT_BITS     "12"                                           // [bits]
+#define PAGE_STEP     "</span>-bit (step <span id=s>"
+#define SLOT_STEP     "0.0625"                                       // [step]
+#define PAGE_CFG      "</span> &deg;C) &mdash; CONFIG=0x<span id=g>"
+#define SLOT_CFG      "00"                                           // [CONFIG]
+// Ids in slot order. Only the links (the controls) are hooked; a reply
+// without all six fields counts as failed.
+#define PAGE_SCRIPT \
+"<script>for(let a of document.links)a.onclick=e=>{e.preventDefault();" \
+"fetch(a.href+'/slots').then(r=>r.text()).then(t=>{t=t.split('<')[0].split('|');" \
+"if(t.length!=6)throw 0;t.map((v,i)=>document.getElementById('lcfbsg'[i]).innerText=v)})" \
+".catch(_=>location=a.href)}</script>"
+#define PAGE_END      "</span>" PAGE_SCRIPT "</html>"
+
+enum { S_LED, S_TC, S_TF, S_BITS, S_STEP, S_CFG, N_SLOTS };
+
+static const char page_text[] =
+  PAGE_HEAD SLOT_LED PAGE_TEMP SLOT_TC PAGE_TF SLOT_TF PAGE_RES SLOT_BITS
+  PAGE_STEP SLOT_STEP PAGE_CFG SLOT_CFG PAGE_END;
+
+static const tmpl_slot_t page_slots[N_SLOTS] = {
+  [S_LED]  = { TMPL_OFF(PAGE_HEAD), TMPL_LEN(SLOT_LED) },
+  [S_TC]   = { TMPL_OFF(PAGE_HEAD SLOT_LED PAGE_TEMP), TMPL_LEN(SLOT_TC) },
+  [S_TF]   = { TMPL_OFF(PAGE_HEAD SLOT_LED PAGE_TEMP SLOT_TC PAGE_TF), TMPL_LEN(SLOT_TF) },
+  [S_BITS] = { TMPL_OFF(PAGE_HEAD SLOT_LED PAGE_TEMP SLOT_TC PAGE_TF SLOT_TF PAGE_RES),
+               TMPL_LEN(SLOT_BITS) },
+  [S_STEP] = { TMPL_OFF(PAGE_HEAD SLOT_LED PAGE_TEMP SLOT_TC PAGE_TF SLOT_TF PAGE_RES
+                        SLOT_BITS PAGE_STEP), TMPL_LEN(SLOT_STEP) },
+  [S_CFG]  = { TMPL_OFF(PAGE_HEAD SLOT_LED PAGE_TEMP SLOT_TC PAGE_TF SLOT_TF PAGE_RES
+                        SLOT_BITS PAGE_STEP SLOT_STEP PAGE_CFG), TMPL_LEN(SLOT_CFG) },
+};
+
+static char page_ram[sizeof(page_text) - 1];
+static tmpl_t page = { page_text, sizeof(page_text) - 1, page_slots, N_SLOTS, page_ram };
+
+// Status record for pollers: the page's numbers as fixed-size JSON, patched
+// the same way. "v" is a tag of the state it reports (see status_tag());
+// "/REQ:status?v=<tag>" gets STATUS_SAME instead while that is unchanged.
+// Both end in "</html>", which is where the ESP8266 ends a response.
+#define STAT_LED      "{\"led\":"
+#define SLOT_SLED     "0"                                            // [LED]
+#define STAT_BITS     ",\"bits\":"
+#define SLOT_SBITS    "12"                                           // [bits]
+#define STAT_CFG      ",\"cfg\":\""
+#define SLOT_SCFG     "00"                                           // [CONFIG]
+#define STAT_RAW      "\",\"raw\":"
+#define SLOT_SRAW     "-32768"                                       // [Q8.8]
+#define STAT_V        ",\"v\":\""
+#define SLOT_SV       "00000000"                                     // [tag]
+#define STAT_END      "\"}</html>"
+#define STATUS_SAME   "304</html>"
+
+enum { T_LED, T_BITS, T_CFG, T_RAW, T_V, N_TSLOTS };
+
+static const char status_text[] =
+  STAT_LED SLOT_SLED STAT_BITS SLOT_SBITS STAT_CFG SLOT_SCFG STAT_RAW SLOT_SRAW
+  STAT_V SLOT_SV STAT_END;
+
+static const tmpl_slot_t status_slots[N_TSLOTS] = {
+  [T_LED]  = { TMPL_OFF(STAT_LED), TMPL_LEN(SLOT_SLED) },
+  [T_BITS] = { TMPL_OFF(STAT_LED SLOT_SLED STAT_BITS), TMPL_LEN(SLOT_SBITS) },
+  [T_CFG]  = { TMPL_OFF(STAT_LED SLOT_SLED STAT_BITS SLOT_SBITS STAT_CFG), TMPL_LEN(SLOT_SCFG) },
+  [T_RAW]  = { TMPL_OFF(STAT_LED SLOT_SLED STAT_BITS SLOT_SBITS STAT_CFG SLOT_SCFG STAT_RAW),
+               TMPL_LEN(SLOT_SRAW) },
+  [T_V]    = { TMPL_OFF(STAT_LED SLOT_SLED STAT_BITS SLOT_SBITS STAT_CFG SLOT_SCFG STAT_RAW
+                        SLOT_SRAW STAT_V), TMPL_LEN(SLOT_SV) },
+};
+
+static char status_ram[sizeof(status_text) - 1];
+static tmpl_t status = { status_text, sizeof(status_text) - 1, status_slots, N_TSLOTS, status_ram };
+
+// Routes: matched anywhere in the request line, e.g. "/REQ:ledon\n".
+// One handler per group per line, first in table order wins.
+enum { G_LED, G_RES, G_PAGE };
+
+static int led_status = 0;
+
+static void route_led(int on){
+  if (on < 0) on = !led_status;
+  gpioWrite(LED_PIN, on);
+  led_status = on;
+}
+
+static void route_res(int bits){ sampler_set_resolution(bits); }
+
+// Which response the current request gets
+enum { PAGE_MAIN, PAGE_HISTORY, PAGE_STATS, PAGE_STATUS, PAGE_SLOTS };
+static int page_kind = PAGE_MAIN;
+
+static void route_page(int kind){ page_kind = kind; }
+
+static const route_t routes[] = {
+  { "ledoff",    G_LED, route_led, 0  },
+  { "ledon",     G_LED, route_led, 1  },
+  { "ledtoggle", G_LED, route_led, -1 },
+  { "res8",      G_RES, route_res, 8  }, { "8bit",  G_RES, route_res, 8  },
+  { "res9",      G_RES, route_res, 9  }, { "9bit",  G_RES, route_res, 9  },
+  { "res10",     G_RES, route_res, 10 }, { "10bit", G_RES, route_res, 10 },
+  { "res11",     G_RES, route_res, 11 }, { "11bit", G_RES, route_res, 11 },
+  { "res12",     G_RES, route_res, 12 }, { "12bit", G_RES, route_res, 12 },
+  { "history",   G_PAGE, route_page, PAGE_HISTORY },
+  { "stats",     G_PAGE, route_page, PAGE_STATS },
+  { "status",    G_PAGE, route_page, PAGE_STATUS },
+  { "slots",     G_PAGE, route_page, PAGE_SLOTS },
+};
+
+static router_t router;
+
+// Devices on SPI1
+static spi_dev_t *const spi_devs[] = { &ds1722_spi };
+
+// Patch LED state, temperature (decimals per resolution), resolution, step
+// and the raw CONFIG into the page. The sample comes from the background
+// sampler's cache: no SPI traffic here.
+static void fill_page(void){
+  int n;
+  sample_t smp;
+
+  tmpl_set(&page, S_LED, led_status ? "LED is on!" : "LED is off!");
+
+  if (sampler_latest(&smp)) {
+    // First conversion not finished yet (up to 1.2 s after boot)
+    tmpl_set(&page, S_TC, "--");
+    tmpl_set(&page, S_TF, "--");
+    tmpl_set(&page, S_BITS, "--");
+    tmpl_set(&page, S_STEP, "--");
+    tmpl_set(&page, S_CFG, "--");
+    return;
   }
+  // Integer only: Q8.8 quantized with shifts, exact 1e-4 decimals
+  char buf[TFIX_BUF_LEN];
+  int bits = smp.bits;
+  int dec  = tfix_decimals(bits);
+  int16_t q = tfix_quantize(smp.raw, bits);       // optional, makes display match actual step
+
+  n = tfix_format(buf, tfix_c_e4(q), dec);
+  tmpl_set_n(&page, S_TC, buf, (uint16_t)n);
+  n = tfix_format(buf, tfix_f_e4(q), dec);
+  tmpl_set_n(&page, S_TF, buf, (uint16_t)n);
+
+  n = tfix_utoa(buf, (uint32_t)bits);
+  tmpl_set_n(&page, S_BITS, buf, (uint16_t)n);
+  n = tfix_format(buf, tfix_step_e4(bits), 4);
+  tmpl_set_n(&page, S_STEP, buf, (uint16_t)n);
+  n = tfix_hex2(buf, smp.cfg);
+  tmpl_set_n(&page, S_CFG, buf, (uint16_t)n);
+}
+
+// The patched page in one write
+static void send_page(USART_TypeDef *USART){
+  fill_page();
+  tmpl_send(&page, USART);
+}
+
+// Only the page's slots, in slot order, '|' between them: what PAGE_SCRIPT
+// refills after a click, formatted here so it matches the page exactly
+#define SLOTS_LEN (TMPL_LEN(SLOT_LED SLOT_TC SLOT_TF SLOT_BITS SLOT_STEP SLOT_CFG) \
+                   + N_SLOTS - 1u + TMPL_LEN("</html>"))
+
+static void send_slots(USART_TypeDef *USART){
+  fill_page();
+  for (int i = 0; i < N_SLOTS; i++) {
+    usartWrite(USART, page_ram + page_slots[i].off, page_slots[i].width);
+    if (i + 1 < N_SLOTS) usartWrite(USART, "|", 1);
+  }
+  usartWrite(USART, "</html>", 7);
+}
+
+// State behind the status record in 32 bits: LED, bits, CONFIG, raw Q8.8
+// (bits 0 until the first sample). Equal tags mean an identical record.
+static uint32_t status_tag(const sample_t *s){
+  uint32_t tag = (uint32_t)led_status << 28;
+  if (s) tag |= (uint32_t)s->bits << 24 | (uint32_t)s->cfg << 16 | (uint16_t)s->raw;
+  return tag;
 }
 
-// Number of decimals to print for a given resolution
-static int decimals_for_bits(int bits){
-  if (bits <= 8) return 0;
-  int d = bits - 8;        // 9→1, 10→2, 11→3, 12→4
-  return (d > 4) ? 4 : d;
+// If-none-match tag of the current request: "v=" then 8 hex digits,
+// picked out of the line as it streams past, like the routes
+static struct {
+  uint8_t  state;                 // 0 scan, 1 after 'v', 2 digits, 3 done
+  uint8_t  n;
+  uint32_t v;
+} tagp;
+static int      req_has_tag;
+static uint32_t req_tag;
+
+static int hex_val(char c){
+  if (c >= '0' && c <= '9') return c - '0';
+  c |= 0x20;
+  return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
 }
 
-// Quantize a °C value to the sensor’s LSB step for the current resolution
-static float quantize_by_bits(float tC, int bits){
-  int shift = (bits <= 8) ? 0 : (bits - 8);
-  float step = 1.0f / (float)(1u << shift);   // 8→1.0, 9→0.5, 10→0.25, 11→0.125, 12→0.0625
-  // symmetric round to nearest step without <math.h>
-  float scaled = tC / step;
-  int32_t q = (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
-  return q * step;
+static void tag_feed(char c){
+  if (c == '\n') {
+    req_has_tag = tagp.state >= 2 && tagp.n == 8;
+    req_tag     = tagp.v;
+    tagp.state  = 0;
+    return;
+  }
+  int h = hex_val(c);
+  if (tagp.state == 2 && h >= 0 && tagp.n < 8) {
+    tagp.v = tagp.v << 4 | (uint32_t)h;
+    tagp.n++;
+  } else if (tagp.state == 2 && h < 0 && tagp.n == 8) {
+    tagp.state = 3;               // complete: keep it for '\n'
+  } else if (tagp.state == 1 && c == '=') {
+    tagp.state = 2;
+    tagp.n = 0;
+    tagp.v = 0;
+  } else if (tagp.state != 3) {
+    tagp.state = (c == 'v');
+  }
 }
 
-// Pretty-print temperature with the right decimals + a note showing resolution and step
-static void print_temperature_block(USART_TypeDef *USART){
-  // Read config first so we know resolution, then temperature
-  uint8_t cfg = readConfiguration();
-  int bits = ds1722_bits_from_cfg(cfg);
-  int dec  = decimals_for_bits(bits);
+// Status record, or STATUS_SAME if the request's tag is still current
+static void send_status(USART_TypeDef *USART){
+  char buf[TFIX_BUF_LEN];
+  sample_t smp;
+  int n, have = !sampler_latest(&smp);
+  uint32_t tag = status_tag(have ? &smp : 0);
 
-  float tC_raw = ds1722_read_celsius();
-  float tC = quantize_by_bits(tC_raw, bits);      // optional, makes display match actual step
-  float tF = (tC * 9.0f / 5.0f) + 32.0f;
+  if (req_has_tag && req_tag == tag) {
+    usartWrite(USART, STATUS_SAME, sizeof(STATUS_SAME) - 1);
+    return;
+  }
+  tmpl_set(&status, T_LED, led_status ? "1" : "0");
+  n = tfix_utoa(buf, have ? smp.bits : 0u);
+  tmpl_set_n(&status, T_BITS, buf, (uint16_t)n);
+  tfix_hex2(buf, have ? smp.cfg : 0u);
+  tmpl_set_n(&status, T_CFG, buf, 2);
+  int16_t raw = have ? smp.raw : 0;
+  buf[0] = '-';
+  n = (raw < 0) + tfix_utoa(buf + (raw < 0), (uint32_t)(raw < 0 ? -(int32_t)raw : raw));
+  tmpl_set_n(&status, T_RAW, buf, (uint16_t)n);
+  for (int i = 0; i < 4; i++) tfix_hex2(buf + 2 * i, (uint8_t)(tag >> (24 - 8 * i)));
+  tmpl_set_n(&status, T_V, buf, 8);
+  tmpl_send(&status, USART);
+}
 
-  // dynamic format string with appropriate decimals
-  char fmt[64], buf[128];
-  snprintf(fmt, sizeof(fmt),
-           "<p><b>Current temperature:</b> %%.%df &deg;C (%%.%df &deg;F)</p>",
-           dec, dec);
-  snprintf(buf, sizeof(buf), fmt, tC, tF);
-  sendString(USART, buf);
+// History buckets, oldest first, as a <pre> table. Formatted a few rows at
+// a time into a small buffer, so the response needs no RAM of its own size.
+#define HIST_CHUNK 256
+#define HIST_ROW   48             // longest row below
 
-  // Show resolution + step and the raw CONFIG (handy for debugging)
-  float step = 1.0f / (float)(1u << ((bits <= 8)? 0 : (bits - 8)));
-  snprintf(buf, sizeof(buf),
-           "<p class='note'>Resolution: %d-bit (step %.4f &deg;C) &mdash; CONFIG=0x%02X</p>",
-           bits, step, cfg);
-  sendString(USART, buf);
+// Right-align s (n chars) in a field of width w at dst; returns bytes written
+static int put_field(char *dst, const char *s, int n, int w){
+  int pad = (n < w) ? w - n : 0;
+  memset(dst, ' ', pad);
+  memcpy(dst + pad, s, n);
+  return pad + n;
+}
+
+#define HIST_HEAD \
+"<!DOCTYPE html><html><head><title>DS1722 history</title></head><body>" \
+"<h1>DS1722 history</h1><pre>     t_s      n    min &deg;C    max &deg;C    avg &deg;C\n"
+#define HIST_TAIL "</pre><p><a href=\"/\">back</a></p></body></html>"
+
+// Rows from *row on until buf is nearly full; returns its length
+static int hist_chunk(char *buf, uint32_t *row){
+  char num[TFIX_BUF_LEN];
+  int len = 0, n;
+  hist_t h;
+
+  while (len <= HIST_CHUNK - HIST_ROW && !sampler_hist_get(*row, &h)) {
+    n = tfix_utoa(num, h.t_ms / 1000u);        len += put_field(buf + len, num, n, 8);
+    n = tfix_utoa(num, h.n);                   len += put_field(buf + len, num, n, 7);
+    n = tfix_format(num, tfix_c_e4(h.min), 4); len += put_field(buf + len, num, n, 10);
+    n = tfix_format(num, tfix_c_e4(h.max), 4); len += put_field(buf + len, num, n, 10);
+    n = tfix_format(num, tfix_c_e4(h.avg), 4); len += put_field(buf + len, num, n, 10);
+    buf[len++] = '\n';
+    (*row)++;
+  }
+  return len;
+}
+
+// ---------- tasks ----------
+
+enum { EV_RX = EV_USER, EV_TX, EV_REQ };
+
+static int rx_fn(task_t *t, uint8_t ev);
+static int http_fn(task_t *t, uint8_t ev);
+static task_t rx_task   = { .name = "rx", .fn = rx_fn };
+static task_t http_task = { .name = "http", .fn = http_fn };
+
+static USART_TypeDef *esp;
+static volatile int req_pending = 0;         // rx hands a routed line to http
+
+// Request latency: '\n' received (USART1 interrupt) to the response queued,
+// split by whether the DS1722 task had SPI I/O in flight meanwhile
+#define NL_RING 4
+static volatile uint32_t nl_t[NL_RING];      // swt_now() of each '\n'
+static volatile uint8_t  nl_busy[NL_RING];
+static volatile uint32_t nl_head = 0;
+static uint32_t nl_tail = 0, req_t0;
+static int      req_busy;
+
+typedef struct {
+  uint32_t n, us_max, us_sum;
+  uint32_t n_busy, us_max_busy;              // sensor I/O in flight
+} lat_stats_t;
+static lat_stats_t lat;
+
+static void on_rx(char c){
+  if (c == '\n') {
+    nl_t[nl_head & (NL_RING - 1u)] = swt_now();
+    nl_busy[nl_head & (NL_RING - 1u)] = (uint8_t)sampler_busy();
+    nl_head++;
+  }
+  sched_signal(&rx_task, EV_RX);
+}
+
+static void on_tx_space(void){ sched_signal(&http_task, EV_TX); }
+
+#if CLK_SCALING
+// A line is 80 us a byte at 125 kbaud; one with no '\n' this long after
+// its first byte (noise, or the '\n' lost to an RX overrun) stops holding
+// the boost
+#define LINE_TIMEOUT_US 20000u
+
+static int boosted = 1;
+static volatile int mid_line = 0;            // bytes of a request read, '\n' not yet
+static void line_timeout(swtimer_t *tm){ (void)tm; mid_line = 0; }
+static swtimer_t line_tmr = { .fn = line_timeout, .ctx = SWT_ISR };
+#endif
+
+// The RX ring is empty between the bytes of a line (80 us apart at
+// 125 kbaud), so mid_line keeps the boost until the '\n' or line_tmr
+static void idle(void){
+#if CLK_SCALING
+  if (boosted && !mid_line && !req_pending && !usartRxAvail(esp) && !usartTxPending(esp)) {
+    clockSetFreq(CLK_IDLE_HZ);
+    boosted = 0;
+  }
+#endif
+}
+
+// Route each byte as it arrives; a request is a line like "/REQ:ledon\n".
+// Holds off while http still owns the previous request.
+static int rx_fn(task_t *t, uint8_t ev){
+  char c;
+  (void)ev;
+  PT_BEGIN(&t->pt);
+  for (;;) {
+    PT_WAIT_UNTIL(&t->pt, !req_pending && usartRxAvail(esp));
+#if CLK_SCALING
+    if (!boosted) {
+      clockSetFreq(CLK_RUN_HZ);
+      boosted = 1;
+    }
+#endif
+    usartRead(esp, &c, 1);
+#if CLK_SCALING
+    if (c == '\n') {
+      mid_line = 0;
+      swt_stop(&line_tmr);
+    } else if (!mid_line) {
+      mid_line = 1;
+      swt_start(&line_tmr, LINE_TIMEOUT_US, 0);
+    }
+#endif
+    tag_feed(c);
+    if (router_feed(&router, c) < 0) continue;
+    if (nl_tail != nl_head) {
+      req_t0   = nl_t[nl_tail & (NL_RING - 1u)];
+      req_busy = nl_busy[nl_tail & (NL_RING - 1u)];
+      nl_tail++;
+    }
+    req_pending = 1;
+    sched_post(&http_task, EV_REQ);
+  }
+  PT_END(&t->pt);
+}
+
+static void lat_record(void){
+  uint32_t us = swt_now() - req_t0;
+  req_busy |= sampler_busy();
+  lat.n++;
+  lat.us_sum += us;
+  if (us > lat.us_max) lat.us_max = us;
+  if (req_busy) {
+    lat.n_busy++;
+    if (us > lat.us_max_busy) lat.us_max_busy = us;
+  }
+}
+
+static int put_str(char *dst, const char *s){
+  int n = (int)strlen(s);
+  memcpy(dst, s, n);
+  return n;
+}
+
+// "label" padded to 10 chars, then right-aligned 9-char fields
+static int stat_row(char *buf, const char *label, const uint32_t *v, int n){
+  char num[TFIX_BUF_LEN];
+  int len = put_str(buf, label);
+  for (; len < 10; len++) buf[len] = ' ';
+  for (int i = 0; i < n; i++) len += put_field(buf + len, num, tfix_utoa(num, v[i]), 9);
+  buf[len++] = '\n';
+  return len;
+}
+
+#define STATS_MAX 1024            // upper bound of send_stats() output
+
+static void send_stats(USART_TypeDef *USART){
+  char buf[STATS_MAX];
+  int len = 0;
+  sched_stats_t ss;
+  sched_get_stats(&ss);
+
+  len += put_str(buf + len, "<html><body><pre>"
+                            "task           runs   max us  mean us\n");
+  for (int i = 0; i < sched_task_count(); i++) {
+    const task_t *t = sched_task(i);
+    uint32_t v[3] = { t->runs, t->us_max, t->runs ? t->us_sum / t->runs : 0 };
+    len += stat_row(buf + len, t->name, v, 3);
+  }
+  uint32_t q[3] = { ss.posted, ss.depth_max, ss.dropped };
+  len += put_str(buf + len, "\nevents       posted    depth  dropped\n");
+  len += stat_row(buf + len, "", q, 3);
+  uint32_t l[5] = { lat.n, lat.us_max, lat.n ? lat.us_sum / lat.n : 0,
+                    lat.n_busy, lat.us_max_busy };
+  len += put_str(buf + len, "\nrequests          n   max us  mean us   n(spi)   max us\n");
+  len += stat_row(buf + len, "", l, 5);
+  len += put_str(buf + len, "</pre></body></html>");
+  usartWrite(USART, buf, (uint32_t)len);
+}
+
+// Writes the response for req_pending a piece at a time, each piece once
+// the TX ring has room for it: nothing here waits on the USART.
+static int http_fn(task_t *t, uint8_t ev){
+  static uint32_t row;
+  static char buf[HIST_CHUNK];
+  (void)ev;
+  PT_BEGIN(&t->pt);
+  for (;;) {
+    PT_WAIT_UNTIL(&t->pt, req_pending);
+
+    if (page_kind == PAGE_HISTORY) {
+      PT_WAIT_UNTIL(&t->pt, usartTxFree(esp) >= sizeof(HIST_HEAD) - 1);
+      usartWrite(esp, HIST_HEAD, sizeof(HIST_HEAD) - 1);
+      lat_record();
+      for (row = 0;;) {
+        PT_WAIT_UNTIL(&t->pt, usartTxFree(esp) >= HIST_CHUNK);
+        int len = hist_chunk(buf, &row);
+        if (!len) break;
+        usartWrite(esp, buf, (uint32_t)len);
+      }
+      PT_WAIT_UNTIL(&t->pt, usartTxFree(esp) >= sizeof(HIST_TAIL) - 1);
+      usartWrite(esp, HIST_TAIL, sizeof(HIST_TAIL) - 1);
+    } else if (page_kind == PAGE_STATS) {
+      PT_WAIT_UNTIL(&t->pt, usartTxFree(esp) >= STATS_MAX);
+      lat_record();
+      send_stats(esp);
+    } else if (page_kind == PAGE_SLOTS) {
+      PT_WAIT_UNTIL(&t->pt, usartTxFree(esp) >= SLOTS_LEN);
+      send_slots(esp);
+      lat_record();
+    } else if (page_kind == PAGE_STATUS) {
+      PT_WAIT_UNTIL(&t->pt, usartTxFree(esp) >= status.len);
+      send_status(esp);
+      lat_record();
+    } else {
+      PT_WAIT_UNTIL(&t->pt, usartTxFree(esp) >= page.len);
+      send_page(esp);
+      lat_record();
+    }
+
+    page_kind = PAGE_MAIN;
+    req_pending = 0;
+    sched_signal(&rx_task, EV_RX);          // resume the receiver
+  }
+  PT_END(&t->pt);
 }
 
 int main(void) {
@@ -134,44 +559,64 @@ int main(void) {
   pinMode(LED_PIN, GPIO_OUTPUT);
   digitalWrite(LED_PIN, 0);
 
+#if SPI_BENCH
+  spi_bench_run();
+  while (1) { }
+#endif
 
-  RCC->APB2ENR |= (RCC_APB2ENR_TIM15EN);
-  initTIM(TIM15);
+#if GPIO_BENCH
+  gpio_bench_run();
+  while (1) { }
+#endif
+
+  // Software timers on TIM2 (replaces the TIM15 delay_millis() base)
+  swt_init();
+
+#if SWT_BENCH
+  swt_bench_run();
+  while (1) { }
+#endif
 
   // USART1 to ESP8266
   USART_TypeDef * USART = initUSART(USART1_ID, 125000);
 
-  // SPI1 (CPOL=0, CPHA=1 for DS1722). Start slow-ish: BR=5 -> PCLK/64.
+  // SPI1 pins + DMA, then the bus manager runs each device at its own
+  // mode and clock (DS1722: CPHA=1, 5 MHz)
   initSPI(/*br=*/5, /*cpol=*/0, /*cpha=*/1);
+  spi_bus_init(spi_devs, sizeof(spi_devs) / sizeof(spi_devs[0]));
 
-  // Default DS1722 configuration: continuous, 12-bit
-  setTempConfiguration(12);
+#if SPIBUS_BENCH
+  spibus_bench_run();
+  while (1) { }
+#endif
 
-  while (1) {
-    // Read a single line like "/REQ:ledon\n"
-    char request[BUFF_LEN] = "                                ";
-    int idx = 0;
-    while (inString(request, "\n") == -1) {
-      while(!(USART->ISR & USART_ISR_RXNE)) { }
-      if (idx < (BUFF_LEN-1)) request[idx++] = readChar(USART);
-    }
+  // Default DS1722 configuration: continuous, 12-bit, sampled in the background
+  sampler_init(12);
 
-    int led_status = updateLEDStatus(request);
-    maybe_update_resolution(request);
+  tmpl_init(&page);
+  tmpl_init(&status);
+  router_init(&router, routes, sizeof(routes) / sizeof(routes[0]));
 
-    // Send full HTML page
-    sendString(USART, webpageStart);
-    sendString(USART, ledStr);
+#if USART_BENCH
+  usart_bench_run(USART, send_page);
+  while (1) { }
+#endif
 
-    sendString(USART, "<h2>LED Status</h2><p>");
-    sendString(USART, (led_status ? "LED is on!" : "LED is off!"));
-    sendString(USART, "</p>");
+#if FMT_BENCH
+  fmt_bench_run();
+  while (1) { }
+#endif
 
-    resolutionControls(USART);
+#if CLOCK_BENCH
+  clock_bench_run();
+  while (1) { }
+#endif
 
-    // Temperature block (formats according to current resolution)
-    print_temperature_block(USART);
-
-    sendString(USART, webpageEnd);
-  }
+  // USART1 interrupt feeds rx; TX ring space wakes http
+  esp = USART;
+  usartOnRx(USART, on_rx);
+  usartOnTxSpace(USART, on_tx_space);
+  sched_add(&rx_task);
+  sched_add(&http_task);
+  sched_run(idle);
 }
@@ -11,6 +11,5 @@
 #include "STM32L432KC.h"
 
 #define LED_PIN PB3 // LED pin for blinking on Port B pin 3
-#define BUFF_LEN 32
 
 #endif // MAIN_H
\ No newline at end of file
@@ -0,0 +1,36 @@
+// pt.h
+// Stackless protothreads: a task body is a function that returns whenever
+// it has to wait and resumes at the same line on its next call. The resume
+// point is a case label, so locals do not survive a wait (keep state in
+// statics) and a task body cannot contain a switch of its own across one.
+
+#ifndef PT_H
+#define PT_H
+
+#include <stdint.h>
+
+typedef struct { uint16_t lc; } pt_t;
+
+#define PT_WAITING  0
+#define PT_ENDED    1
+
+#define PT_INIT(pt)   ((pt)->lc = 0)
+#define PT_BEGIN(pt)  switch ((pt)->lc) { case 0:
+#define PT_END(pt)    } (pt)->lc = 0; return PT_ENDED
+
+// Return now and re-test cond on every later call until it holds
+#define PT_WAIT_UNTIL(pt, cond)                               \
+  do {                                                        \
+    (pt)->lc = __LINE__; __attribute__((fallthrough));        \
+    case __LINE__: if (!(cond)) return PT_WAITING;            \
+  } while (0)
+
+// Return now even if cond holds, then as PT_WAIT_UNTIL: waits for the
+// next event rather than acting on the current one again
+#define PT_YIELD_UNTIL(pt, cond)                              \
+  do {                                                        \
+    (pt)->lc = __LINE__; return PT_WAITING;                   \
+    case __LINE__: if (!(cond)) return PT_WAITING;            \
+  } while (0)
+
+#endif // PT_H
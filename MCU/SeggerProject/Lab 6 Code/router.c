@@ -0,0 +1,80 @@
+// router.c
+// Aho-Corasick over a small route table with a sparse (child/sibling) trie,
+// so the tables stay a few hundred bytes instead of 256 entries per node.
+
+#include "router.h"
+
+static uint8_t child_of(const router_t *r, uint8_t n, char c){
+  for (uint8_t k = r->node[n].child; k; k = r->node[k].sibling)
+    if (r->node[k].c == c) return k;
+  return 0;
+}
+
+int router_init(router_t *r, const route_t *routes, uint8_t n_routes){
+  if (n_routes > ROUTER_MAX_ROUTES) return -1;
+  r->routes   = routes;
+  r->n_routes = n_routes;
+  r->n_nodes  = 1;                // node 0 = root
+  r->node[0]  = (router_node_t){ 0, 0, 0, 0, 0 };
+
+  // Trie
+  for (uint8_t i = 0; i < n_routes; i++) {
+    uint8_t n = 0;
+    for (const char *p = routes[i].pattern; *p; p++) {
+      uint8_t k = child_of(r, n, *p);
+      if (!k) {
+        if (r->n_nodes >= ROUTER_MAX_NODES) return -1;
+        k = r->n_nodes++;
+        r->node[k] = (router_node_t){ *p, 0, r->node[n].child, 0, 0 };
+        r->node[n].child = k;
+      }
+      n = k;
+    }
+    r->node[n].out |= 1u << i;
+  }
+
+  // Failure links breadth first; out also collects the suffix nodes' routes
+  uint8_t queue[ROUTER_MAX_NODES], head = 0, tail = 0;
+  for (uint8_t k = r->node[0].child; k; k = r->node[k].sibling) queue[tail++] = k;
+  while (head < tail) {
+    uint8_t n = queue[head++];
+    for (uint8_t k = r->node[n].child; k; k = r->node[k].sibling) {
+      uint8_t f = r->node[n].fail, g;
+      while (!(g = child_of(r, f, r->node[k].c)) && f) f = r->node[f].fail;
+      r->node[k].fail = g;
+      r->node[k].out |= r->node[g].out;
+      queue[tail++] = k;
+    }
+  }
+  router_reset(r);
+  return 0;
+}
+
+void router_reset(router_t *r){
+  r->state   = 0;
+  r->matched = 0;
+}
+
+static void dispatch(const router_t *r, uint32_t m){
+  uint32_t groups_done = 0;
+  for (uint8_t i = 0; i < r->n_routes; i++) {
+    const route_t *rt = &r->routes[i];
+    if (!(m & (1u << i)) || (groups_done & (1u << rt->group))) continue;
+    groups_done |= 1u << rt->group;
+    if (rt->fn) rt->fn(rt->arg);
+  }
+}
+
+int32_t router_feed(router_t *r, char c){
+  if (c == '\n') {
+    uint32_t m = r->matched;
+    router_reset(r);
+    dispatch(r, m);
+    return (int32_t)m;
+  }
+  uint8_t n = r->state, k;
+  while (!(k = child_of(r, n, c)) && n) n = r->node[n].fail;
+  r->state = k;
+  r->matched |= r->node[k].out;
+  return -1;
+}
@@ -0,0 +1,48 @@
+// router.h
+// Streaming request router: bytes are classified as they arrive by an
+// Aho-Corasick automaton built over the route table, so a request line of
+// any length costs O(length) and nothing is buffered. At '\n' the matched
+// routes are dispatched, at most one per group (the first in table order,
+// which is how "ledoff" beats "ledon" and "res8" beats "res9").
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <stdint.h>
+
+#define ROUTER_MAX_ROUTES 31      // match set fits a non-negative int32_t
+#define ROUTER_MAX_NODES  128     // trie nodes (sum of pattern lengths + 1 is enough)
+
+typedef struct {
+  const char *pattern;            // matched anywhere in the line
+  uint8_t     group;              // one dispatch per group per line
+  void      (*fn)(int arg);
+  int         arg;
+} route_t;
+
+typedef struct {
+  char     c;                     // edge label from the parent
+  uint8_t  child;                 // first child, 0 = none
+  uint8_t  sibling;               // next child of the same parent, 0 = none
+  uint8_t  fail;                  // longest proper suffix that is also a trie node
+  uint32_t out;                   // routes ending here or at any suffix node
+} router_node_t;
+
+typedef struct {
+  const route_t *routes;
+  uint8_t        n_routes;
+  uint8_t        n_nodes;
+  uint8_t        state;           // current node
+  uint32_t       matched;         // routes seen so far on this line
+  router_node_t  node[ROUTER_MAX_NODES];
+} router_t;
+
+// Build the automaton. Returns 0, or -1 if the table does not fit.
+int router_init(router_t *r, const route_t *routes, uint8_t n_routes);
+// Feed one byte. At '\n' dispatches and returns the match set (0 if none,
+// still a complete line); otherwise returns -1.
+int32_t router_feed(router_t *r, char c);
+// Drop a partial line
+void router_reset(router_t *r);
+
+#endif // ROUTER_H
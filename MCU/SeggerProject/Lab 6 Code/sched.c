@@ -0,0 +1,92 @@
+// sched.c
+// One ring of (task, event) entries. Producers are interrupts and tasks,
+// the consumer is sched_run(); the ring is touched with interrupts masked.
+// Task run time is taken from the swtimer clock (1 us), which unlike DWT
+// keeps its rate across clock switches.
+
+#include "sched.h"
+#include "swtimer.h"
+#include "main.h"
+
+typedef struct { task_t *t; uint8_t ev; } sched_ev_t;
+
+static sched_ev_t q[SCHED_QUEUE_LEN];
+static uint16_t q_head = 0, q_tail = 0;
+static task_t *tasks[SCHED_MAX_TASKS];
+static int n_tasks = 0;
+static sched_stats_t stats;
+
+static int push(task_t *t, uint8_t ev) {
+  if ((uint16_t)(q_head - q_tail) == SCHED_QUEUE_LEN) { stats.dropped++; return -1; }
+  q[q_head & (SCHED_QUEUE_LEN - 1u)] = (sched_ev_t){ t, ev };
+  q_head++;
+  stats.posted++;
+  uint16_t depth = (uint16_t)(q_head - q_tail);
+  if (depth > stats.depth_max) stats.depth_max = depth;
+  return 0;
+}
+
+int sched_post(task_t *t, uint8_t ev) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int r = push(t, ev);
+  __set_PRIMASK(primask);
+  return r;
+}
+
+int sched_signal(task_t *t, uint8_t ev) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int r = 0;
+  if (!(t->signaled & (1u << ev))) {
+    r = push(t, ev);
+    if (!r) t->signaled |= 1u << ev;
+  }
+  __set_PRIMASK(primask);
+  return r;
+}
+
+int sched_add(task_t *t) {
+  if (n_tasks == SCHED_MAX_TASKS) return -1;
+  tasks[n_tasks++] = t;
+  PT_INIT(&t->pt);
+  return sched_post(t, EV_INIT);
+}
+
+void sched_run(void (*idle)(void)) {
+  for (;;) {
+    swt_poll();                             // deferred timer callbacks
+
+    __disable_irq();
+    if (q_head == q_tail) {
+      __enable_irq();
+      if (idle) idle();
+      // Masked, so an interrupt after the test still ends the WFI
+      __disable_irq();
+      if (q_head == q_tail) __WFI();
+      __enable_irq();
+      continue;
+    }
+    sched_ev_t e = q[q_tail & (SCHED_QUEUE_LEN - 1u)];
+    q_tail++;
+    e.t->signaled &= ~(1u << e.ev);         // a new signal from here on queues again
+    __enable_irq();
+
+    uint32_t t0 = swt_now();
+    if (e.t->fn(e.t, e.ev) == PT_ENDED) PT_INIT(&e.t->pt);
+    uint32_t us = swt_now() - t0;
+    e.t->runs++;
+    e.t->us_sum += us;
+    if (us > e.t->us_max) e.t->us_max = us;
+  }
+}
+
+int sched_task_count(void) { return n_tasks; }
+const task_t *sched_task(int i) { return (i < n_tasks) ? tasks[i] : 0; }
+
+void sched_get_stats(sched_stats_t *st) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *st = stats;
+  __set_PRIMASK(primask);
+}
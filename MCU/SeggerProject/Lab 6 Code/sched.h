@@ -0,0 +1,53 @@
+// sched.h
+// Cooperative run-to-completion scheduler. Interrupts post events to tasks;
+// sched_run() takes them off one FIFO in order and calls the task with each,
+// and the task runs until it returns (a protothread wait, see pt.h). Nothing
+// preempts a task except interrupts, so tasks share data without locking.
+// With the queue empty the core sleeps in WFI.
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include "pt.h"
+
+#define SCHED_QUEUE_LEN  32         // events (power of two)
+#define SCHED_MAX_TASKS  8
+
+enum { EV_INIT = 0, EV_USER = 1 };  // task events start at EV_USER (< 32)
+
+typedef struct task task_t;
+typedef int (*task_fn_t)(task_t *t, uint8_t ev);
+
+struct task {
+  const char *name;
+  task_fn_t   fn;
+  pt_t        pt;
+  // Private
+  volatile uint32_t signaled;       // events queued by sched_signal()
+  uint32_t    runs;
+  uint32_t    us_max;               // longest single run
+  uint32_t    us_sum;
+};
+
+typedef struct {
+  uint32_t posted;
+  uint32_t dropped;                 // queue full
+  uint16_t depth_max;
+} sched_stats_t;
+
+// Register t and queue EV_INIT for it
+int  sched_add(task_t *t);
+// Queue ev for t (any context). Returns -1 if the queue is full.
+int  sched_post(task_t *t, uint8_t ev);
+// Same, but a no-op while an earlier ev for t is still queued: for
+// readiness ("bytes arrived", "TX has room") rather than countable events
+int  sched_signal(task_t *t, uint8_t ev);
+// Dispatch forever. idle() runs (interrupts enabled) before each sleep.
+void sched_run(void (*idle)(void));
+
+int  sched_task_count(void);
+const task_t *sched_task(int i);
+void sched_get_stats(sched_stats_t *st);
+
+#endif // SCHED_H
@@ -0,0 +1,87 @@
+// spi_bench.c
+// SPI1 polled vs DMA: bus utilization and CPU time for 2/16/512-byte transfers.
+//
+// For each size and SCK rate:
+//   wall  = DWT cycles from start to completion
+//   bus   = 8 * len * SCK period, utilization = bus / wall
+//   cpu   = cycles the CPU could not use. Polled: all of wall. DMA: wall
+//           minus the work an idle loop got done meanwhile (its cost per
+//           iteration is calibrated first), i.e. setup + ISR + callback.
+// No CS is driven, so nothing on the bus answers; MISO data is ignored.
+
+#include <stdio.h>
+#include "main.h"
+#include "spi_bench.h"
+
+#if SPI_BENCH
+
+static uint8_t tx_buf[512], rx_buf[512];
+
+static volatile uint32_t idle_iters;
+static volatile int      dma_done;
+
+static void on_done(spi_txn_t *t) { (void)t; dma_done = 1; }
+
+// Cycles per idle-loop iteration, measured with nothing else running
+static uint32_t idle_cost_x16(void) {
+    uint32_t n = 0, t0 = DWT->CYCCNT;
+    dma_done = 0;
+    while (!dma_done && n < 4096u) n++;       // same loop as below
+    return ((DWT->CYCCNT - t0) * 16u) / n;
+}
+
+static void report(USART_TypeDef *U, const char *path, int br, int len,
+                   uint32_t wall, uint32_t cpu) {
+    char buf[128];
+    uint32_t bus = 8u * (uint32_t)len * (2u << br);          // SCK = PCLK / 2^(br+1)
+    snprintf(buf, sizeof(buf), "%-6s  %3d  %4d  %8lu  %8lu  %5lu%%  %5lu%%\r\n",
+             path, br, len, (unsigned long)wall, (unsigned long)cpu,
+             (unsigned long)(100u * bus / wall), (unsigned long)(100u * cpu / wall));
+    sendString(U, buf);
+}
+
+void spi_bench_run(void) {
+    static const int sizes[] = { 2, 16, 512 };
+    static const int brs[]   = { 5, 3 };                     // PCLK/64, PCLK/16 (5 MHz)
+    char buf[96];
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    for (int i = 0; i < 512; i++) tx_buf[i] = (uint8_t)i;
+
+    USART_TypeDef *U = initUSART(USART2_ID, 115200);
+    uint32_t cost16 = idle_cost_x16();
+    snprintf(buf, sizeof(buf), "\r\nLab6 SPI bench: SYSCLK %lu Hz, idle loop %lu/16 cyc\r\n",
+             (unsigned long)SystemCoreClock, (unsigned long)cost16);
+    sendString(U, buf);
+    sendString(U, "path     br   len  wall cyc   cpu cyc    bus    cpu\r\n");
+
+    for (unsigned b = 0; b < sizeof(brs) / sizeof(brs[0]); b++) {
+        initSPI(brs[b], 0, 1);
+        for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            int len = sizes[s];
+            uint32_t wall_p = 0, wall_d = 0, cpu_d = 0;
+            for (int r = 0; r < SPI_BENCH_REPS; r++) {
+                // Polled: the CPU is busy the whole time
+                uint32_t t0 = DWT->CYCCNT;
+                for (int i = 0; i < len; i++) rx_buf[i] = spiSendReceive(tx_buf[i]);
+                wall_p += DWT->CYCCNT - t0;
+
+                // DMA: count idle iterations until the callback
+                spi_txn_t t = { tx_buf, rx_buf, (uint16_t)len, SPI_NO_CS, on_done, 0, 0, 0, 0 };
+                uint32_t n = 0;
+                dma_done = 0;
+                t0 = DWT->CYCCNT;
+                spiTransferAsync(&t);
+                while (!dma_done && n < 0xFFFFFFFFu) n++;
+                uint32_t w = DWT->CYCCNT - t0, idle = (n * cost16) / 16u;
+                wall_d += w;
+                cpu_d  += (idle < w) ? w - idle : 0;
+            }
+            report(U, "polled", brs[b], len, wall_p / SPI_BENCH_REPS, wall_p / SPI_BENCH_REPS);
+            report(U, "dma",    brs[b], len, wall_d / SPI_BENCH_REPS, cpu_d / SPI_BENCH_REPS);
+        }
+    }
+}
+
+#endif // SPI_BENCH
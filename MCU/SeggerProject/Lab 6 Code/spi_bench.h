@@ -0,0 +1,15 @@
+// spi_bench.h
+// SPI1 polled vs DMA benchmark (build with -DSPI_BENCH=1), report on USART2 (ST-Link VCP)
+
+#ifndef SPI_BENCH_H
+#define SPI_BENCH_H
+
+#ifndef SPI_BENCH
+#define SPI_BENCH 0
+#endif
+
+#define SPI_BENCH_REPS 16
+
+void spi_bench_run(void);
+
+#endif // SPI_BENCH_H
@@ -0,0 +1,167 @@
+// spi_bus.c
+// FIFO of spi_req_t in front of the SPI1 DMA transaction (one in flight).
+// The queue is touched with interrupts masked; the next request is started
+// from the completion callback, so back-to-back traffic needs no thread.
+
+#include "spi_bus.h"
+#include "STM32L432KC_RCC.h"
+
+static spi_req_t *head = 0, *tail = 0;
+static spi_req_t *volatile cur = 0;     // in flight (or the polled claim)
+#define MODE_NONE 0xFFFFu
+static uint16_t   cur_mode = MODE_NONE;  // spi_dev_t.mode SPI1 is configured for
+static spi_txn_t  txn;
+static spi_req_t  polled_claim;
+static spi_bus_stats_t stats;
+static spi_dev_t *const *dev_tab = 0;
+static int        n_devs = 0;
+static volatile int held = 0;           // clock switch in progress: start nothing
+
+// Smallest prescaler that keeps SCK <= max_hz (SPI1 runs on PCLK2)
+static uint8_t br_for(uint32_t max_hz) {
+    uint32_t pclk = clockCurrent()->pclk2;
+    uint8_t br = 0;
+    while (br < 7 && (pclk >> (br + 1)) > max_hz) br++;
+    return br;
+}
+
+static void set_rates(void) {
+    for (int i = 0; i < n_devs; i++) {
+        spi_dev_t *d = dev_tab[i];
+        d->br = br_for(d->max_hz);
+        d->mode = (uint16_t)(d->br | (d->cpol << 3) | (d->cpha << 4) | (d->bits << 5));
+    }
+    cur_mode = MODE_NONE;
+}
+
+static void kick(void);
+
+// PRE: let the transfer in flight finish at the old SCK and hold the
+// queue. POST: new prescalers for the new PCLK2, then resume.
+static void clock_hook(int phase) {
+    if (phase == CLOCK_PRE) {
+        held = 1;
+        while (cur) {}
+    } else if (phase == CLOCK_POST) {
+        set_rates();
+        held = 0;
+        kick();
+    }
+}
+
+void spi_bus_init(spi_dev_t *const *devs, int n) {
+    if (!dev_tab) clockOnChange(clock_hook);
+    dev_tab = devs;
+    n_devs = n;
+    set_rates();
+    for (int i = 0; i < n; i++) {
+        spi_dev_t *d = devs[i];
+        if (d->cs != SPI_NO_CS) {
+            pinMode(d->cs, GPIO_OUTPUT);
+            digitalWrite(d->cs, d->cs_low ? PIO_HIGH : PIO_LOW);
+        }
+    }
+}
+
+static void select_dev(spi_dev_t *d) {
+    if (d->mode == cur_mode) return;
+    spiSetMode(d->br, d->cpol, d->cpha, d->bits);
+    cur_mode = d->mode;
+    stats.reconfigs++;
+}
+
+static void on_txn_done(spi_txn_t *t);
+
+// Start the head request if nothing is in flight. IRQs masked.
+static void kick(void) {
+    if (cur || !head || held) return;
+    spi_req_t *r = head;
+    head = r->next;
+    if (!head) tail = 0;
+    cur = r;
+
+    select_dev(r->dev);
+    txn = (spi_txn_t){ (const uint8_t *)r->tx, (uint8_t *)r->rx, r->len, r->dev->cs,
+                       on_txn_done, r, 0, 0, r->dev->cs_low };
+    if (spiTransferAsync(&txn)) {
+        // Someone used spiTransferAsync() directly; fail rather than hang
+        cur = 0;
+        r->status = -1;
+        r->busy = 0;
+        if (r->done) r->done(r);
+    }
+}
+
+static void on_txn_done(spi_txn_t *t) {
+    spi_req_t *r = t->arg;
+    r->status = t->status;
+    stats.txns++;
+    cur = 0;
+    r->busy = 0;
+    if (r->done) r->done(r);            // may submit again
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    kick();
+    __set_PRIMASK(primask);
+}
+
+int spi_bus_submit(spi_req_t *r) {
+    if (r->len == 0) return -1;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (r->busy) { __set_PRIMASK(primask); return -1; }
+    r->busy   = 1;
+    r->status = 0;
+    r->next   = 0;
+    if (tail) tail->next = r; else head = r;
+    tail = r;
+    kick();
+    __set_PRIMASK(primask);
+    return 0;
+}
+
+int spi_bus_transfer(spi_dev_t *dev, const void *tx, void *rx, uint16_t len) {
+    if (len < SPI_DMA_MIN_LEN && dev->bits <= 8) {
+        // Claim an idle bus and run the bytes by hand: cheaper than DMA setup
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        int idle = !cur && !head && !held;
+        if (idle) cur = &polled_claim;
+        __set_PRIMASK(primask);
+
+        if (idle) {
+            const uint8_t *t8 = tx;
+            uint8_t *r8 = rx;
+            select_dev(dev);
+            if (dev->cs != SPI_NO_CS) gpioWrite(dev->cs, dev->cs_low ? PIO_LOW : PIO_HIGH);
+            for (uint16_t i = 0; i < len; i++) {
+                uint8_t b = spiSendReceive(t8 ? t8[i] : 0x00);
+                if (r8) r8[i] = b;
+            }
+            while (SPI1->SR & SPI_SR_BSY) {}
+            if (dev->cs != SPI_NO_CS) gpioWrite(dev->cs, dev->cs_low ? PIO_HIGH : PIO_LOW);
+            stats.polled++;
+
+            // Release, and start anything queued meanwhile
+            primask = __get_PRIMASK();
+            __disable_irq();
+            cur = 0;
+            kick();
+            __set_PRIMASK(primask);
+            return 0;
+        }
+    }
+    spi_req_t r = { dev, tx, rx, len, 0, 0, 0, 0, 0 };
+    if (spi_bus_submit(&r)) return -1;
+    while (r.busy) {}
+    return r.status;
+}
+
+int spi_bus_idle(void) { return !cur && !head; }
+
+void spi_bus_get_stats(spi_bus_stats_t *st) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *st = stats;
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,58 @@
+// spi_bus.h
+// SPI1 bus manager: several devices, each with its own chip select,
+// polarity, mode, frame size and maximum clock. Requests go through one
+// FIFO; SPI1 is reconfigured only when the next request is for a device with
+// different settings than the last one, and each device runs at the fastest prescaler
+// its max_hz allows (DS1722: 5 MHz at PCLK 80 MHz, was PCLK/64 = 1.25 MHz).
+//
+// The bus owns SPI1 after spi_bus_init(): use requests, not spiSendReceive().
+
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#include <stdint.h>
+#include "STM32L432KC_SPI.h"
+
+typedef struct {
+    const char *name;
+    int         cs;             // GPIO pin, or SPI_NO_CS
+    uint8_t     cs_low;         // 0: active-high (DS1722), 1: active-low
+    uint8_t     cpol, cpha;
+    uint8_t     bits;           // frame size 4..16
+    uint32_t    max_hz;         // fastest SCK the device is rated for
+    // Filled by spi_bus_init() and after every clock switch
+    uint8_t     br;             // SCK = PCLK / 2^(br+1)
+    uint16_t    mode;           // br/cpol/cpha/bits key: equal keys share a config
+} spi_dev_t;
+
+typedef struct spi_req spi_req_t;
+struct spi_req {
+    spi_dev_t     *dev;
+    const void    *tx;          // NULL: clock out 0; uint16_t frames if bits > 8
+    void          *rx;          // NULL: discard
+    uint16_t       len;         // frames
+    void         (*done)(spi_req_t *r);   // from the DMA ISR, may be NULL
+    void          *arg;
+    volatile int   busy;        // 1 from submit until completion
+    volatile int   status;      // 0 ok, -1 DMA transfer error
+    spi_req_t     *next;        // queue link (bus internal)
+};
+
+typedef struct {
+    uint32_t txns;              // requests completed
+    uint32_t reconfigs;         // spiSetMode() calls
+    uint32_t polled;            // short blocking transfers done without DMA
+} spi_bus_stats_t;
+
+// Set up CS pins (inactive) and prescalers for a device table. The table
+// is kept: prescalers are recomputed from it when PCLK2 changes.
+void spi_bus_init(spi_dev_t *const *devs, int n);
+// Queue r (ISR-safe). Returns 0, or -1 if r is still busy or len is 0.
+int  spi_bus_submit(spi_req_t *r);
+// Blocking transfer (thread code only). Short 8-bit transfers on an idle
+// bus are polled, the rest go through the queue.
+int  spi_bus_transfer(spi_dev_t *dev, const void *tx, void *rx, uint16_t len);
+int  spi_bus_idle(void);
+void spi_bus_get_stats(spi_bus_stats_t *st);
+
+#endif // SPI_BUS_H
@@ -0,0 +1,89 @@
+// spibus_bench.c
+// Two simulated devices (nothing needs to be wired; CS pins PB0/PB1):
+//   A: DS1722-like, CS active-high, mode 1, 8-bit, 5 MHz, 4-byte reads
+//   B: DAC-like,    CS active-low,  mode 0, 16-bit, 20 MHz, 32-frame writes
+// SPIBUS_BENCH_REQS requests, all queued up front, three ways:
+//   global       A/B alternating, both at the old initSPI() setup
+//                (PCLK/64, mode 1, 8-bit; B sent as 64 bytes)
+//   interleaved  A/B alternating, each device at its own settings
+//   batched      all A then all B, each at its own settings
+// Per run: wall cycles until the bus is idle, SPI1 reconfigurations and
+// bytes/s. spiSetMode() itself is timed separately.
+
+#include <stdio.h>
+#include "main.h"
+#include "spi_bus.h"
+#include "spibus_bench.h"
+
+#if SPIBUS_BENCH
+
+static spi_dev_t dev_a  = { "sim-a",  PB0, 0, 0, 1, 8,  5000000u, 0, 0 };
+static spi_dev_t dev_b  = { "sim-b",  PB1, 1, 0, 0, 16, 20000000u, 0, 0 };
+static spi_dev_t glob_a = { "glob-a", PB0, 0, 0, 1, 8,  1250000u, 0, 0 };
+static spi_dev_t glob_b = { "glob-b", PB1, 1, 0, 1, 8,  1250000u, 0, 0 };
+static spi_dev_t *const devs[] = { &dev_a, &dev_b, &glob_a, &glob_b };
+
+static uint8_t   a_tx[4] = { 0x00 }, a_rx[SPIBUS_BENCH_REQS][4];
+static uint16_t  b_tx[32];
+static spi_req_t reqs[SPIBUS_BENCH_REQS];
+
+static void run(USART_TypeDef *U, const char *name, spi_dev_t *a, spi_dev_t *b, int batched) {
+    char buf[112];
+    spi_bus_stats_t s0, s1;
+    uint32_t bytes = 0;
+    int half = SPIBUS_BENCH_REQS / 2;
+
+    spi_bus_get_stats(&s0);
+    uint32_t t0 = DWT->CYCCNT;
+    for (int i = 0; i < SPIBUS_BENCH_REQS; i++) {
+        int to_a = batched ? (i < half) : !(i & 1);
+        spi_req_t *r = &reqs[i];
+        if (to_a) *r = (spi_req_t){ a, a_tx, a_rx[i], 4, 0, 0, 0, 0, 0 };
+        else      *r = (spi_req_t){ b, b_tx, 0, (uint16_t)(b->bits > 8 ? 32 : 64), 0, 0, 0, 0, 0 };
+        bytes += to_a ? 4u : 64u;
+        spi_bus_submit(r);
+    }
+    while (!spi_bus_idle()) {}
+    uint32_t wall = DWT->CYCCNT - t0;
+    spi_bus_get_stats(&s1);
+
+    snprintf(buf, sizeof(buf), "%-12s  %9lu  %6lu  %8lu\r\n", name, (unsigned long)wall,
+             (unsigned long)(s1.reconfigs - s0.reconfigs),
+             (unsigned long)((uint64_t)bytes * SystemCoreClock / wall));
+    sendString(U, buf);
+    usartFlush(U);
+}
+
+void spibus_bench_run(void) {
+    char buf[112];
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    USART_TypeDef *U = initUSART(USART2_ID, 115200);
+    for (int i = 0; i < 32; i++) b_tx[i] = (uint16_t)(i * 0x0801u);
+
+    spi_bus_init(devs, sizeof(devs) / sizeof(devs[0]));
+
+    // Cost of one reconfiguration (A <-> B settings)
+    uint32_t t0 = DWT->CYCCNT;
+    for (int i = 0; i < 16; i++) {
+        spiSetMode(dev_a.br, dev_a.cpol, dev_a.cpha, dev_a.bits);
+        spiSetMode(dev_b.br, dev_b.cpol, dev_b.cpha, dev_b.bits);
+    }
+    uint32_t cost = (DWT->CYCCNT - t0) / 32u;
+    spi_bus_init(devs, sizeof(devs) / sizeof(devs[0]));     // forget the mode
+
+    snprintf(buf, sizeof(buf), "\r\nLab6 SPI bus bench: SYSCLK %lu Hz, %d requests, "
+             "A br %u, B br %u, reconfig %lu cyc\r\n",
+             (unsigned long)SystemCoreClock, SPIBUS_BENCH_REQS, dev_a.br, dev_b.br,
+             (unsigned long)cost);
+    sendString(U, buf);
+    sendString(U, "run            wall cyc  reconf       B/s\r\n");
+    usartFlush(U);
+
+    run(U, "global",      &glob_a, &glob_b, 0);
+    run(U, "interleaved", &dev_a,  &dev_b,  0);
+    run(U, "batched",     &dev_a,  &dev_b,  1);
+}
+
+#endif // SPIBUS_BENCH
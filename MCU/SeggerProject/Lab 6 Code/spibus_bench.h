@@ -0,0 +1,16 @@
+// spibus_bench.h
+// SPI1 bus manager: interleaved traffic to two simulated devices
+// (build with -DSPIBUS_BENCH=1), report on USART2 (ST-Link VCP)
+
+#ifndef SPIBUS_BENCH_H
+#define SPIBUS_BENCH_H
+
+#ifndef SPIBUS_BENCH
+#define SPIBUS_BENCH 0
+#endif
+
+#define SPIBUS_BENCH_REQS 64
+
+void spibus_bench_run(void);
+
+#endif // SPIBUS_BENCH_H
@@ -0,0 +1,103 @@
+// swt_bench.c
+// For 1..256 periodic timers with periods spread over 1..10 ms: run for
+// SWT_BENCH_RUN_MS and report
+//   late   callback start - deadline, in cycles (DWT at the callback vs
+//          the deadline converted to cycles), ISR callbacks and deferred
+//          ones run from a swt_poll() loop
+//   isr    cycles per TIM2 interrupt and per expiry (swtimer's own stats)
+//   start  cycles for one swt_start() with n timers armed
+// The deadline is in 1 us ticks, so "late" has up to 1 us of quantization.
+
+#include <stdio.h>
+#include "main.h"
+#include "swtimer.h"
+#include "swt_bench.h"
+
+#if SWT_BENCH
+
+#define MAX_N 256
+static swtimer_t tmr[MAX_N];
+static uint32_t late_max, n_cb;
+static uint64_t late_sum;
+static uint32_t cyc_per_tick;
+
+// CYCCNT and the TIM2 count sampled together, to map deadlines to cycles
+static uint32_t c_ref, t_ref;
+
+static void on_fire(swtimer_t *t) {
+  uint32_t now = DWT->CYCCNT;
+  uint32_t due = c_ref + (t->deadline - t_ref) * cyc_per_tick;
+  int32_t late = (int32_t)(now - due);
+  if (late < 0) late = 0;
+  if ((uint32_t)late > late_max) late_max = (uint32_t)late;
+  late_sum += (uint32_t)late;
+  n_cb++;
+}
+
+static void run(USART_TypeDef *U, int n, int ctx) {
+  char buf[128];
+  swt_stats_t st;
+  uint32_t seed = 12345u, c0;
+
+  late_max = n_cb = 0;
+  late_sum = 0;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  t_ref = swt_now();
+  while (swt_now() == t_ref) {}             // sample right on a tick edge
+  c_ref = DWT->CYCCNT;
+  t_ref = swt_now();
+  __set_PRIMASK(primask);
+
+  uint32_t start_cyc = 0;
+  for (int i = 0; i < n; i++) {
+    seed = seed * 1103515245u + 12345u;
+    uint32_t period = 1000u + (seed >> 8) % 9001u;    // 1..10 ms
+    tmr[i].fn = on_fire;
+    tmr[i].ctx = (uint8_t)ctx;
+    c0 = DWT->CYCCNT;
+    swt_start(&tmr[i], period, period);
+    start_cyc = DWT->CYCCNT - c0;
+  }
+  swt_reset_stats();
+
+  uint32_t t0 = swt_now();
+  while (swt_now() - t0 < SWT_BENCH_RUN_MS * 1000u) {
+    if (ctx == SWT_DEFERRED) swt_poll();
+  }
+  for (int i = 0; i < n; i++) swt_stop(&tmr[i]);
+  swt_get_stats(&st);
+
+  uint32_t isr_mean = st.irqs ? (uint32_t)(st.isr_cycles_sum / st.irqs) : 0;
+  uint32_t per_exp  = st.fired ? (uint32_t)(st.isr_cycles_sum / st.fired) : 0;
+  uint32_t load_pm  = (uint32_t)(st.isr_cycles_sum * 1000u /
+                                 ((uint64_t)SystemCoreClock * SWT_BENCH_RUN_MS / 1000u));
+  snprintf(buf, sizeof(buf), "%4d %-4s %7lu %6lu %6lu %6lu %6lu %6lu %5lu.%lu%% %6lu %4lu\r\n",
+           n, ctx == SWT_ISR ? "isr" : "def", (unsigned long)n_cb,
+           (unsigned long)(n_cb ? late_sum / n_cb : 0), (unsigned long)late_max,
+           (unsigned long)isr_mean, (unsigned long)st.isr_cycles_max, (unsigned long)per_exp,
+           (unsigned long)(load_pm / 10u), (unsigned long)(load_pm % 10u),
+           (unsigned long)start_cyc, (unsigned long)st.overruns);
+  sendString(U, buf);
+}
+
+void swt_bench_run(void) {
+  static const int counts[] = { 1, 4, 16, 64, 128, 256 };
+  char buf[128];
+  USART_TypeDef *U = initUSART(USART2_ID, 115200);
+  cyc_per_tick = SystemCoreClock / SWT_HZ;
+
+  snprintf(buf, sizeof(buf), "\r\nLab6 swtimer bench: SYSCLK %lu Hz, %u ms per row, cycles\r\n",
+           (unsigned long)SystemCoreClock, SWT_BENCH_RUN_MS);
+  sendString(U, buf);
+  sendString(U, "   n ctx    calls  late   late   isr    isr   per    isr     start ovr\r\n"
+                "                    mean   max    mean   max   exp    load\r\n");
+  usartFlush(U);
+  for (int ctx = SWT_ISR; ctx <= SWT_DEFERRED; ctx++)
+    for (unsigned i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+      run(U, counts[i], ctx);
+      usartFlush(U);                         // keep USART2 IRQs out of the next row
+    }
+}
+
+#endif // SWT_BENCH
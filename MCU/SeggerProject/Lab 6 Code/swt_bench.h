@@ -0,0 +1,16 @@
+// swt_bench.h
+// Software timer accuracy and TIM2 interrupt cost vs number of armed
+// timers (build with -DSWT_BENCH=1), report on USART2 (ST-Link VCP)
+
+#ifndef SWT_BENCH_H
+#define SWT_BENCH_H
+
+#ifndef SWT_BENCH
+#define SWT_BENCH 0
+#endif
+
+#define SWT_BENCH_RUN_MS  1000u       // per timer count
+
+void swt_bench_run(void);
+
+#endif // SWT_BENCH_H
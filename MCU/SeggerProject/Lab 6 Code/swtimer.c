@@ -0,0 +1,246 @@
+// swtimer.c
+// Binary min-heap of armed timers keyed by deadline (compared as signed
+// differences, so wrap-around is harmless). Each timer keeps its heap
+// index, which makes stop/restart O(log n) without a search. Heap and
+// deferred list are only touched with interrupts masked.
+
+#include "swtimer.h"
+#include "main.h"
+
+#define SWT_TIM  TIM2
+
+enum { ST_IDLE, ST_ARMED, ST_FIRING };
+
+static swtimer_t *heap[SWT_MAX_TIMERS];
+static int n_armed = 0;
+static swtimer_t *dq_head = 0, *dq_tail = 0;   // deferred, in expiry order
+static swt_stats_t stats;
+
+#define BEFORE(a, b)  ((int32_t)((a)->deadline - (b)->deadline) < 0)
+
+// ---------- heap ----------
+
+static void place(swtimer_t *t, int i) {
+  heap[i] = t;
+  t->slot = (int16_t)i;
+}
+
+static void sift_up(int i) {
+  swtimer_t *t = heap[i];
+  while (i > 0) {
+    int p = (i - 1) / 2;
+    if (!BEFORE(t, heap[p])) break;
+    place(heap[p], i);
+    i = p;
+  }
+  place(t, i);
+}
+
+static void sift_down(int i) {
+  swtimer_t *t = heap[i];
+  for (;;) {
+    int c = 2 * i + 1;
+    if (c >= n_armed) break;
+    if (c + 1 < n_armed && BEFORE(heap[c + 1], heap[c])) c++;
+    if (!BEFORE(heap[c], t)) break;
+    place(heap[c], i);
+    i = c;
+  }
+  place(t, i);
+}
+
+static void heap_remove(swtimer_t *t) {
+  int i = t->slot;
+  swtimer_t *last = heap[--n_armed];
+  t->slot = -1;
+  if (last == t) return;
+  place(last, i);
+  if (i > 0 && BEFORE(last, heap[(i - 1) / 2])) sift_up(i);
+  else sift_down(i);
+}
+
+static void heap_insert(swtimer_t *t) {
+  place(t, n_armed++);
+  sift_up(n_armed - 1);
+  if (n_armed > stats.armed_max) stats.armed_max = (uint16_t)n_armed;
+}
+
+// ---------- hardware ----------
+
+uint32_t swt_now(void) { return SWT_TIM->CNT; }
+
+// Point CC1 at the earliest deadline. Returns 1 if it is already due,
+// in which case the caller must dispatch rather than wait for a match.
+static int program(void) {
+  if (!n_armed) {
+    SWT_TIM->DIER &= ~TIM_DIER_CC1IE;
+    return 0;
+  }
+  SWT_TIM->CCR1 = heap[0]->deadline;
+  SWT_TIM->SR = ~TIM_SR_CC1IF;
+  SWT_TIM->DIER |= TIM_DIER_CC1IE;
+  // A compare that lands on the current count may already have been missed
+  return (int32_t)(heap[0]->deadline - SWT_TIM->CNT) <= 0;
+}
+
+// Keeps the us count across clock switches. The time timResume() adds
+// may step over CCR1, so check for a missed match.
+static tim_hold_t hold;
+
+static void clock_hook(int phase) {
+  if (phase == CLOCK_HOLD) {
+    timHold(SWT_TIM, &hold);
+  } else if (phase == CLOCK_POST) {
+    uint32_t div = timClock(SWT_TIM) / SWT_HZ;
+    timResume(SWT_TIM, &hold, (div ? div : 1u) - 1u);
+    if (program()) NVIC_SetPendingIRQ(TIM2_IRQn);
+  }
+}
+
+void swt_init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  // DWT for the ISR stats
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  RCC->APB1ENR1 |= RCC_APB1ENR1_TIM2EN;
+  SWT_TIM->CR1 = 0;
+  uint32_t div = timClock(SWT_TIM) / SWT_HZ;
+  SWT_TIM->PSC = (div ? div : 1u) - 1u;
+  SWT_TIM->ARR = 0xFFFFFFFFu;                    // TIM2 is 32 bits
+  SWT_TIM->CCMR1 = 0;                            // CC1: output compare, frozen
+  SWT_TIM->EGR = TIM_EGR_UG;
+  SWT_TIM->SR = 0;
+  SWT_TIM->DIER = 0;
+  clockOnChange(clock_hook);
+  NVIC_SetPriority(TIM2_IRQn, SWT_IRQ_PRIO);
+  NVIC_EnableIRQ(TIM2_IRQn);
+  SWT_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+// ---------- API ----------
+
+static void arm(swtimer_t *t, uint32_t deadline) {
+  t->deadline = deadline;
+  t->state = ST_ARMED;
+  heap_insert(t);
+}
+
+int swt_start(swtimer_t *t, uint32_t delay_us, uint32_t period_us) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (t->state == ST_ARMED) heap_remove(t);
+  else if (n_armed == SWT_MAX_TIMERS) { __set_PRIMASK(primask); return -1; }
+  t->period = period_us;
+  arm(t, swt_now() + delay_us);
+  if (program()) NVIC_SetPendingIRQ(TIM2_IRQn);
+  __set_PRIMASK(primask);
+  return 0;
+}
+
+void swt_stop(swtimer_t *t) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (t->state == ST_ARMED) {
+    int was_first = (t->slot == 0);
+    heap_remove(t);
+    if (was_first) program();
+  }
+  t->state = ST_IDLE;
+  if (t->queued) {
+    // Drop an expiry that swt_poll() has not run yet
+    swtimer_t **pp = &dq_head, *prev = 0;
+    while (*pp != t) { prev = *pp; pp = &(*pp)->next; }
+    *pp = t->next;
+    if (dq_tail == t) dq_tail = prev;
+    t->queued = 0;
+  }
+  __set_PRIMASK(primask);
+}
+
+int swt_armed(const swtimer_t *t) { return t->state == ST_ARMED; }
+
+// ---------- expiry ----------
+
+void TIM2_IRQHandler(void) {
+  uint32_t c0 = DWT->CYCCNT;
+  SWT_TIM->SR = ~TIM_SR_CC1IF;
+  stats.irqs++;
+
+  do {
+    while (n_armed && (int32_t)(heap[0]->deadline - SWT_TIM->CNT) <= 0) {
+      swtimer_t *t = heap[0];
+      heap_remove(t);
+      stats.fired++;
+      if (t->ctx == SWT_DEFERRED) {
+        // Re-arm now: the period does not depend on when swt_poll() runs
+        if (t->queued) stats.overruns++;
+        else {
+          t->queued = 1;
+          t->next = 0;
+          if (dq_tail) dq_tail->next = t; else dq_head = t;
+          dq_tail = t;
+        }
+        if (t->period) arm(t, t->deadline + t->period);
+        else t->state = ST_IDLE;
+        continue;
+      }
+      // ISR callback: it may stop or restart t itself
+      t->state = ST_FIRING;
+      t->fn(t);
+      if (t->state == ST_FIRING) {
+        if (t->period) arm(t, t->deadline + t->period);
+        else t->state = ST_IDLE;
+      }
+    }
+  } while (program());
+
+  uint32_t dc = DWT->CYCCNT - c0;
+  stats.isr_cycles_sum += dc;
+  if (dc > stats.isr_cycles_max) stats.isr_cycles_max = dc;
+}
+
+int swt_poll(void) {
+  int ran = 0;
+  for (;;) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    swtimer_t *t = dq_head;
+    if (t) {
+      dq_head = t->next;
+      if (!dq_head) dq_tail = 0;
+      t->queued = 0;
+    }
+    __set_PRIMASK(primask);
+    if (!t) return ran;
+    t->fn(t);
+    ran++;
+  }
+}
+
+static void delay_done(swtimer_t *t) { *(volatile int *)t->arg = 1; }
+
+void swt_delay_ms(uint32_t ms) {
+  volatile int done = 0;
+  swtimer_t t = { delay_done, (void *)&done, SWT_ISR, ST_IDLE, 0, -1, 0, 0, 0 };
+  if (swt_start(&t, ms * 1000u, 0)) return;
+  while (!done) {
+    swt_poll();
+    // Masked, so an expiry between the test and WFI still wakes us
+    __disable_irq();
+    if (!done) __WFI();
+    __enable_irq();
+  }
+}
+
+void swt_get_stats(swt_stats_t *st) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *st = stats;
+  __set_PRIMASK(primask);
+}
+
+void swt_reset_stats(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  stats = (swt_stats_t){ 0 };
+  stats.armed_max = (uint16_t)n_armed;
+  __set_PRIMASK(primask);
+}
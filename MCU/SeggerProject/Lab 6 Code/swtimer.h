@@ -0,0 +1,62 @@
+// swtimer.h
+// Software timers multiplexed onto TIM2. TIM2 free-runs at 1 MHz (32 bits,
+// wraps after 71 min) and CC1 is always set to the earliest deadline of a
+// min-heap, so there is no periodic tick: one interrupt per expiry (or per
+// group of expiries that fall due together).
+//
+// Callbacks run either in the TIM2 interrupt (SWT_ISR) or from swt_poll()
+// in thread code (SWT_DEFERRED). Periodic timers re-arm from their
+// deadline, not from when the callback ran, so they do not drift.
+
+#ifndef SWTIMER_H
+#define SWTIMER_H
+
+#include <stdint.h>
+
+#define SWT_HZ            1000000u    // tick: 1 us (needs timer clock >= 1 MHz)
+#define SWT_MAX_TIMERS    256         // armed at once
+#define SWT_MAX_DELAY_US  0x7FFFFFFFu // deadlines are compared modulo 2^32
+#define SWT_IRQ_PRIO      2
+
+enum { SWT_ISR, SWT_DEFERRED };
+
+typedef struct swtimer swtimer_t;
+typedef void (*swt_fn_t)(swtimer_t *t);
+
+struct swtimer {
+  swt_fn_t   fn;
+  void      *arg;
+  uint8_t    ctx;             // SWT_ISR or SWT_DEFERRED
+  // Private
+  uint8_t    state;
+  uint8_t    queued;          // on the deferred list
+  int16_t    slot;            // heap index while armed
+  uint32_t   period;          // ticks, 0 = one-shot
+  uint32_t   deadline;        // tick of the current (or just fired) expiry
+  swtimer_t *next;            // deferred list
+};
+
+typedef struct {
+  uint32_t irqs;              // TIM2 interrupts taken
+  uint32_t fired;             // expiries dispatched
+  uint32_t overruns;          // deferred expiries dropped (previous not run yet)
+  uint32_t isr_cycles_max;    // one interrupt, entry to exit (DWT)
+  uint64_t isr_cycles_sum;
+  uint16_t armed_max;         // heap high-water mark
+} swt_stats_t;
+
+void     swt_init(void);
+// (Re)arm t to fire delay_us from now, then every period_us (0: once).
+// Returns -1 if the heap is full. Callable from any context.
+int      swt_start(swtimer_t *t, uint32_t delay_us, uint32_t period_us);
+void     swt_stop(swtimer_t *t);
+int      swt_armed(const swtimer_t *t);
+uint32_t swt_now(void);
+// Run deferred callbacks that are due. Returns how many ran.
+int      swt_poll(void);
+// Sleep (WFI) for ms, running deferred callbacks meanwhile. Thread code only.
+void     swt_delay_ms(uint32_t ms);
+void     swt_get_stats(swt_stats_t *st);
+void     swt_reset_stats(void);
+
+#endif // SWTIMER_H
@@ -0,0 +1,238 @@
+// temp_sampler.c
+// TIM16 update IRQ keeps the time base and signals the DS1722 task, which
+// queues a 4-byte burst from CONFIG_R (address, CONFIG, TEMP_LSB, TEMP_MSB)
+// on the bus, waits for the completion event (DMA IRQ) and updates the
+// cache and history. The timer period is the conversion time of the
+// current resolution, so every read sees a finished conversion.
+//
+// Readers are tasks only (see temp_sampler.h). The cache and history are
+// written by the sensor task alone and tasks run to their next yield, so a
+// reader never sees an update half done. The TIM16 IRQ only bumps
+// stats.busy, one word.
+
+#include "temp_sampler.h"
+#include "DS1722.h"
+#include "spi_bus.h"
+#include "STM32L432KC_RCC.h"
+#include "STM32L432KC_TIM.h"
+#include "sched.h"
+#include "swtimer.h"
+
+#define SAMPLER_TIM    TIM16
+
+
+static sample_t latest;
+static hist_t   hist[SAMPLER_HIST_LEN];
+static uint32_t hist_n = 0;                    // buckets ever opened
+static int32_t  hist_sum = 0;                  // Q8.8 sum of the open bucket
+
+static volatile uint32_t t_base = 0;           // timer ticks up to the last update
+static volatile int      forced = 0;           // that update was a forced UG
+static uint32_t          anchor_us = 0;        // swt_now() of ideal tick anchor_ticks
+static uint32_t          anchor_ticks = 0;
+static volatile int      pending_bits = 0;     // resolution change requested
+static sampler_stats_t   stats;
+
+static uint8_t   tx[4], rx[4];
+static spi_req_t req;
+static volatile int io_busy = 0;               // tick taken, result not stored yet
+
+enum { EV_TICK = EV_USER, EV_IO };
+static int sensor_fn(task_t *t, uint8_t ev);
+static task_t sensor_task = { .name = "ds1722", .fn = sensor_fn };
+
+// ---------- timer ----------
+
+#define TICKS_PER_MS  (SAMPLER_TIM_HZ / 1000u)
+
+// Takes effect at the next update (ARR is preloaded only if ARPE is set;
+// it is not, so this is immediate and the running period is cut short)
+static void set_period(int bits) {
+  uint32_t ms = ds1722_conv_ms(bits) * (100u + SAMPLER_MARGIN_PCT) / 100u;
+  SAMPLER_TIM->ARR = ms * TICKS_PER_MS - 1u;
+}
+
+static void timer_init(void) {
+  RCC->APB2ENR |= RCC_APB2ENR_TIM16EN;
+  SAMPLER_TIM->CR1 = 0;
+  SAMPLER_TIM->PSC = timClock(SAMPLER_TIM) / SAMPLER_TIM_HZ - 1u;
+  SAMPLER_TIM->EGR = TIM_EGR_UG;                  // load PSC
+  SAMPLER_TIM->SR  = 0;
+  SAMPLER_TIM->DIER = TIM_DIER_UIE;
+  NVIC_SetPriority(TIM1_UP_TIM16_IRQn, SAMPLER_IRQ_PRIO);
+  NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
+}
+
+// The ideal 10 kHz time base counts on the swtimer's us (kept across clock
+// switches): tick anchor_ticks + k is at anchor_us + k * US_PER_TICK. Moving
+// the anchor by whole ticks keeps the differences below the 2^32 us wrap.
+#define US_PER_TICK  (1000000u / SAMPLER_TIM_HZ)
+
+static void anchor_advance(void) {
+  uint32_t k = (swt_now() - anchor_us) / US_PER_TICK;
+  anchor_us    += k * US_PER_TICK;
+  anchor_ticks += k;
+}
+
+// A new PSC needs an UG, which drops the tick in progress (waiting up to
+// 100 us for the next count would be too long with interrupts masked).
+// Instead put the count back on the ideal time base: t_base + CNT stays
+// within a tick of it, however many switches there are.
+static void timer_clock_hook(int phase) {
+  if (phase != CLOCK_POST) return;
+  anchor_advance();
+  uint32_t arr = SAMPLER_TIM->ARR, cnt = SAMPLER_TIM->CNT;
+  uint32_t hw = t_base + cnt;
+  if ((SAMPLER_TIM->SR & TIM_SR_UIF) && !forced) hw += arr + 1u;   // update not taken yet
+  int32_t lag = (int32_t)(anchor_ticks - hw);
+  if (lag > 0)      cnt = (cnt + (uint32_t)lag > arr) ? arr : cnt + (uint32_t)lag;
+  else if (lag < 0) cnt = ((uint32_t)-lag > cnt) ? 0u : cnt - (uint32_t)-lag;
+  timSetPrescaler(SAMPLER_TIM, timClock(SAMPLER_TIM) / SAMPLER_TIM_HZ - 1u);
+  SAMPLER_TIM->CNT = cnt;
+}
+
+// ---------- cache + history (task context) ----------
+
+static void hist_add(int16_t raw, uint32_t t) {
+  hist_t *h = &hist[(hist_n - 1u) & (SAMPLER_HIST_LEN - 1u)];
+  if (hist_n == 0 || t - h->t_ms >= SAMPLER_BUCKET_MS) {
+    h = &hist[hist_n & (SAMPLER_HIST_LEN - 1u)];
+    hist_n++;
+    h->t_ms = t - (t % SAMPLER_BUCKET_MS);
+    h->min = h->max = raw;
+    h->n = 0;
+    hist_sum = 0;
+  }
+  if (raw < h->min) h->min = raw;
+  if (raw > h->max) h->max = raw;
+  h->n++;
+  hist_sum += raw;
+  int32_t half = (hist_sum < 0) ? -(int32_t)(h->n / 2u) : (int32_t)(h->n / 2u);
+  h->avg = (int16_t)((hist_sum + half) / (int32_t)h->n);
+}
+
+static void store(int16_t raw, uint8_t cfg, uint32_t now) {
+  latest.raw  = raw;
+  latest.cfg  = cfg;
+  latest.bits = (uint8_t)ds1722_bits_from_cfg(cfg);
+  latest.t_ms = now;
+  latest.n++;
+  hist_add(raw, now);
+  stats.reads++;
+}
+
+static void on_io(spi_req_t *r) { (void)r; sched_post(&sensor_task, EV_IO); }
+
+// ---------- timer tick ----------
+
+void TIM1_UP_TIM16_IRQHandler(void) {
+  if (!(SAMPLER_TIM->SR & TIM_SR_UIF)) return;
+  SAMPLER_TIM->SR = ~TIM_SR_UIF;
+  if (!forced) t_base += SAMPLER_TIM->ARR + 1u;
+  forced = 0;
+  anchor_advance();
+  if (io_busy) { stats.busy++; return; }    // last read not finished yet
+  sched_signal(&sensor_task, EV_TICK);
+}
+
+// ---------- DS1722 task ----------
+
+static int sensor_fn(task_t *t, uint8_t ev) {
+  static uint32_t t_ms;
+  PT_BEGIN(&t->pt);
+  for (;;) {
+    PT_YIELD_UNTIL(&t->pt, ev == EV_TICK);
+    io_busy = 1;
+    t_ms = t_base / TICKS_PER_MS;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    int bits = pending_bits;
+    pending_bits = 0;
+    if (bits) {
+      // New resolution restarts conversion: next read one conversion later
+      set_period(bits);
+      t_base += SAMPLER_TIM->CNT;               // keep t_base + CNT continuous
+      SAMPLER_TIM->CNT = 0;
+    }
+    __set_PRIMASK(primask);
+
+    if (bits) {
+      tx[0] = DS1722_ADDR_CONFIG_W;
+      tx[1] = ds1722_cfg_for_bits(bits);
+      req = (spi_req_t){ &ds1722_spi, tx, 0, 2, on_io, 0, 0, 0, 0 };
+    } else {
+      tx[0] = DS1722_ADDR_CONFIG_R;
+      tx[1] = tx[2] = tx[3] = 0;
+      req = (spi_req_t){ &ds1722_spi, tx, rx, 4, on_io, 0, 0, 0, 0 };
+    }
+    if (spi_bus_submit(&req)) {
+      stats.busy++;
+    } else {
+      PT_YIELD_UNTIL(&t->pt, ev == EV_IO);
+      if (req.status) stats.errors++;
+      else if (req.rx) store((int16_t)(((uint16_t)rx[3] << 8) | rx[2]), rx[1], t_ms);
+    }
+    io_busy = 0;
+  }
+  PT_END(&t->pt);
+}
+
+// ---------- public API ----------
+
+void sampler_init(int bits) {
+  setTempConfiguration(bits);     // polled: the timer is not running yet
+  sched_add(&sensor_task);
+  timer_init();
+  clockOnChange(timer_clock_hook);
+  set_period(bits);
+  anchor_us = swt_now();
+  SAMPLER_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+void sampler_set_resolution(int bits) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  pending_bits = bits;
+  // Apply now rather than at the end of a long (12-bit) period: bank the
+  // elapsed ticks and force an update. If one is already pending it will
+  // pick the change up itself.
+  if (!(SAMPLER_TIM->SR & TIM_SR_UIF)) {
+    t_base += SAMPLER_TIM->CNT;
+    forced = 1;
+    SAMPLER_TIM->EGR = TIM_EGR_UG;
+  }
+  __set_PRIMASK(primask);
+}
+
+int sampler_busy(void) { return io_busy; }
+
+uint32_t sampler_ms(void) {
+  uint32_t base, cnt;
+  do {
+    base = t_base;
+    cnt  = SAMPLER_TIM->CNT;
+  } while (base != t_base);
+  return (base + cnt) / TICKS_PER_MS;
+}
+
+int sampler_latest(sample_t *s) {
+  *s = latest;
+  return s->n ? 0 : -1;
+}
+
+uint32_t sampler_hist_count(void) {
+  uint32_t n = hist_n;
+  return (n < SAMPLER_HIST_LEN) ? n : SAMPLER_HIST_LEN;
+}
+
+int sampler_hist_get(uint32_t i, hist_t *h) {
+  uint32_t n = hist_n, count = (n < SAMPLER_HIST_LEN) ? n : SAMPLER_HIST_LEN;
+  if (i >= count) return -1;
+  *h = hist[(n - count + i) & (SAMPLER_HIST_LEN - 1u)];
+  return 0;
+}
+
+void sampler_get_stats(sampler_stats_t *st) {
+  *st = stats;
+}
@@ -0,0 +1,61 @@
+// temp_sampler.h
+// Background DS1722 sampling: a task (sched.h) woken by TIM16. Reads are
+// timed to the conversion period of the current resolution (plus a
+// margin), queued on the SPI1 bus manager (DMA), and land in a cache
+// (latest sample + timestamp) and a ring of min/max/avg buckets. Readers
+// never touch SPI. sched_run() must be running for samples to arrive.
+//
+// While the sampler runs it owns the DS1722 CONFIG: change the resolution
+// with sampler_set_resolution(), not setTempConfiguration().
+
+#ifndef TEMP_SAMPLER_H
+#define TEMP_SAMPLER_H
+
+#include <stdint.h>
+
+#define SAMPLER_TIM_HZ      10000u    // TIM16 tick (0.1 ms), ARR up to 6.5 s
+#define SAMPLER_MARGIN_PCT  10u       // read this far past the conversion time
+#define SAMPLER_HIST_LEN    64u       // buckets kept (power of two)
+#define SAMPLER_BUCKET_MS   10000u    // time covered by one bucket
+#define SAMPLER_IRQ_PRIO    4
+
+typedef struct {
+  int16_t  raw;         // °C, Q8.8 as the sensor reports it
+  uint8_t  cfg;         // CONFIG read in the same burst
+  uint8_t  bits;        // resolution from cfg
+  uint32_t t_ms;        // sampler time of the read
+  uint32_t n;           // samples so far (0 = none yet)
+} sample_t;
+
+typedef struct {
+  uint32_t t_ms;        // start of the bucket
+  int16_t  min, max;    // Q8.8
+  int16_t  avg;         // Q8.8, rounded mean
+  uint16_t n;           // samples in the bucket
+} hist_t;
+
+typedef struct {
+  uint32_t reads;       // completed reads
+  uint32_t busy;        // ticks skipped: the last read was still in progress
+  uint32_t errors;      // DMA transfer errors
+} sampler_stats_t;
+
+// Write the resolution and start sampling (call after initSPI)
+void     sampler_init(int bits);
+// Applied from the next timer tick; the first read follows one conversion
+void     sampler_set_resolution(int bits);
+// 1 from a tick until its read is stored: SPI I/O in flight
+int      sampler_busy(void);
+// ms since sampler_init(), in timer ticks
+uint32_t sampler_ms(void);
+// Readers below: task context only (the sensor task writes without
+// masking interrupts, so an interrupt could see half an update)
+// Latest sample; returns 0, or -1 if there is none yet
+int      sampler_latest(sample_t *s);
+// Buckets available (closed + the open one, at most SAMPLER_HIST_LEN)
+uint32_t sampler_hist_count(void);
+// Bucket i, 0 = oldest; returns 0, or -1 if i is out of range
+int      sampler_hist_get(uint32_t i, hist_t *h);
+void     sampler_get_stats(sampler_stats_t *st);
+
+#endif // TEMP_SAMPLER_H
@@ -0,0 +1,53 @@
+// tfix.c
+// Integer-only temperature math and formatting (see tfix.h)
+
+#include "tfix.h"
+
+static const int32_t pow10_tab[5] = { 1, 10, 100, 1000, 10000 };
+
+int16_t tfix_quantize(int16_t q88, int bits){
+  if (bits < 8)  bits = 8;
+  if (bits > 12) bits = 12;
+  int s = 16 - bits;                        // 8-bit: 8 fraction bits dropped .. 12-bit: 4
+  int32_t a = (q88 < 0) ? -(int32_t)q88 : q88;
+  a = ((a + (1 << (s - 1))) >> s) << s;
+  return (int16_t)((q88 < 0) ? -a : a);
+}
+
+int tfix_utoa(char *buf, uint32_t v){
+  char tmp[10];
+  int n = 0, len = 0;
+  do { tmp[n++] = (char)('0' + v % 10u); v /= 10u; } while (v);
+  while (n) buf[len++] = tmp[--n];
+  buf[len] = 0;
+  return len;
+}
+
+int tfix_hex2(char *buf, uint8_t v){
+  static const char hex[] = "0123456789ABCDEF";
+  buf[0] = hex[v >> 4];
+  buf[1] = hex[v & 0xF];
+  buf[2] = 0;
+  return 2;
+}
+
+int tfix_format(char *buf, int32_t v_e4, int dec){
+  if (dec < 0) dec = 0;
+  if (dec > 4) dec = 4;
+  int len = 0;
+  uint32_t a = (v_e4 < 0) ? 0u - (uint32_t)v_e4 : (uint32_t)v_e4;
+  uint32_t div = (uint32_t)pow10_tab[4 - dec];
+  a = (a + div / 2u) / div;                 // now in units of 10^-dec
+
+  if (v_e4 < 0) buf[len++] = '-';           // "%.0f" of -0.4 is "-0" too
+  uint32_t p = (uint32_t)pow10_tab[dec];
+  len += tfix_utoa(buf + len, a / p);
+  if (dec) {
+    uint32_t f = a % p;
+    buf[len++] = '.';
+    for (int i = dec - 1; i >= 0; i--) { buf[len + i] = (char)('0' + f % 10u); f /= 10u; }
+    len += dec;
+    buf[len] = 0;
+  }
+  return len;
+}
@@ -0,0 +1,33 @@
+// tfix.h
+// Integer-only DS1722 temperature math and formatting. Readings stay in the
+// sensor's Q8.8 format; decimal output is in units of 1e-4, which is exact
+// for every step the DS1722 can report (1/16 °C in °C and in °F).
+
+#ifndef TFIX_H
+#define TFIX_H
+
+#include <stdint.h>
+
+#define TFIX_BUF_LEN  13          // "-214748.3648" + NUL, worst case of tfix_format
+
+// Round a Q8.8 °C value to the step of a 8..12-bit reading (ties away from 0)
+int16_t tfix_quantize(int16_t q88, int bits);
+
+// Q8.8 °C -> 1e-4 °C / 1e-4 °F (exact for multiples of 1/16 °C)
+static inline int32_t tfix_c_e4(int16_t q88) { return (int32_t)q88 * 625 / 16; }
+static inline int32_t tfix_f_e4(int16_t q88) { return (int32_t)q88 * 1125 / 16 + 320000; }
+
+// Resolution step in 1e-4 °C: 8-bit 10000 .. 12-bit 625
+static inline int32_t tfix_step_e4(int bits) { return 10000 >> (bits - 8); }
+
+// Decimals that show every step of a 8..12-bit reading: 0..4
+static inline int tfix_decimals(int bits) { return (bits <= 8) ? 0 : (bits >= 12) ? 4 : bits - 8; }
+
+// Write v_e4 / 1e4 with dec (0..4) decimals, rounded half away from zero,
+// like "%.*f" but exact. NUL-terminated; returns the length.
+int tfix_format(char *buf, int32_t v_e4, int dec);
+// Unsigned decimal / two hex digits (upper case); same return convention
+int tfix_utoa(char *buf, uint32_t v);
+int tfix_hex2(char *buf, uint8_t v);
+
+#endif // TFIX_H
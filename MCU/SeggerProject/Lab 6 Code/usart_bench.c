@@ -0,0 +1,97 @@
+// usart_bench.c
+// Lab 6 page over USART1, blocking (TXE + TC per byte) vs queued (TXE IRQ).
+//
+// For each path:
+//   bytes = page length (queued once with the USART1 IRQ masked, read back
+//           as the ring fill level)
+//   wall  = DWT cycles from send_page() until TC after the last byte
+//   ret   = cycles until send_page() returns to the caller
+//   cpu   = cycles the CPU could not use. Blocking: all of wall. Queued: wall
+//           minus the work an idle loop got done while the ring drained (its
+//           cost per iteration is calibrated first), i.e. page building +
+//           enqueue + one TXE interrupt per byte.
+// Page building (DS1722 read, snprintf) is in both.
+
+#include <stdio.h>
+#include "main.h"
+#include "usart_bench.h"
+
+#if USART_BENCH
+
+static int tx_busy(USART_TypeDef *U) {
+    return usartTxPending(U) || !(U->ISR & USART_ISR_TC);
+}
+
+// Cycles per idle-loop iteration, with the ring held non-empty
+static uint32_t idle_cost_x16(USART_TypeDef *U, IRQn_Type irq) {
+    uint32_t n = 0, t0;
+    NVIC_DisableIRQ(irq);
+    usartWrite(U, "", 1);
+    t0 = DWT->CYCCNT;
+    while (tx_busy(U) && n < 4096u) n++;      // same loop as below
+    t0 = ((DWT->CYCCNT - t0) * 16u) / n;
+    NVIC_EnableIRQ(irq);
+    usartFlush(U);
+    return t0;
+}
+
+static void report(USART_TypeDef *R, const char *path, uint32_t bytes,
+                   uint32_t wall, uint32_t ret, uint32_t cpu) {
+    char buf[128];
+    uint32_t bps = (uint32_t)((uint64_t)bytes * SystemCoreClock / wall);
+    snprintf(buf, sizeof(buf), "%-8s  %5lu  %9lu  %9lu  %9lu  %6lu  %5lu%%\r\n",
+             path, (unsigned long)bytes, (unsigned long)wall, (unsigned long)ret,
+             (unsigned long)cpu, (unsigned long)bps, (unsigned long)(100u * cpu / wall));
+    sendString(R, buf);
+    usartFlush(R);
+}
+
+void usart_bench_run(USART_TypeDef *U, void (*send_page)(USART_TypeDef *)) {
+    IRQn_Type irq = (U == USART1) ? USART1_IRQn : USART2_IRQn;
+    char buf[112];
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    USART_TypeDef *R = initUSART(USART2_ID, 115200);
+
+    // Page length: queue it without letting the interrupt drain it
+    NVIC_DisableIRQ(irq);
+    send_page(U);
+    uint32_t bytes = usartTxPending(U);
+    NVIC_EnableIRQ(irq);
+    usartFlush(U);
+
+    uint32_t cost16 = idle_cost_x16(U, irq);
+    snprintf(buf, sizeof(buf), "\r\nLab6 USART bench: SYSCLK %lu Hz, page %lu B, idle loop %lu/16 cyc\r\n",
+             (unsigned long)SystemCoreClock, (unsigned long)bytes, (unsigned long)cost16);
+    sendString(R, buf);
+    sendString(R, "path      bytes   wall cyc    ret cyc    cpu cyc     B/s    cpu\r\n");
+    usartFlush(R);
+
+    uint32_t wall_b = 0, wall_q = 0, ret_q = 0, cpu_q = 0;
+    for (int r = 0; r < USART_BENCH_REPS; r++) {
+        // Blocking: sendString() waits for TC after every byte
+        usartTxQueue(U, 0);
+        uint32_t t0 = DWT->CYCCNT;
+        send_page(U);
+        wall_b += DWT->CYCCNT - t0;
+
+        // Queued: count idle iterations while the TXE interrupt drains the ring
+        usartTxQueue(U, 1);
+        uint32_t n = 0;
+        t0 = DWT->CYCCNT;
+        send_page(U);
+        uint32_t ret = DWT->CYCCNT - t0;
+        while (tx_busy(U)) n++;
+        uint32_t w = DWT->CYCCNT - t0, idle = (n * cost16) / 16u;
+        wall_q += w;
+        ret_q  += ret;
+        cpu_q  += (idle < w) ? w - idle : 0;
+    }
+    wall_b /= USART_BENCH_REPS;
+    report(R, "blocking", bytes, wall_b, wall_b, wall_b);
+    report(R, "queued", bytes, wall_q / USART_BENCH_REPS, ret_q / USART_BENCH_REPS,
+           cpu_q / USART_BENCH_REPS);
+}
+
+#endif // USART_BENCH
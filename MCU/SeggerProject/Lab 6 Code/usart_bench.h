@@ -0,0 +1,18 @@
+// usart_bench.h
+// Lab 6 page over USART1: blocking vs queued TX (build with -DUSART_BENCH=1),
+// report on USART2 (ST-Link VCP)
+
+#ifndef USART_BENCH_H
+#define USART_BENCH_H
+
+#include <stm32l432xx.h>
+
+#ifndef USART_BENCH
+#define USART_BENCH 0
+#endif
+
+#define USART_BENCH_REPS 8
+
+void usart_bench_run(USART_TypeDef *page_usart, void (*send_page)(USART_TypeDef *));
+
+#endif // USART_BENCH_H
@@ -0,0 +1,325 @@
+/*********************************************************************
+*  dds.c — E155 Lab 4: multi-voice DDS synthesizer (TONE_ENGINE_DDS)
+*  - Each voice is a 32-bit phase accumulator stepping through a
+*    256-entry sine table; inc = f * 2^32 / Fs (precomputed per MIDI
+*    note), so pitch error is below Fs / 2^32 ≈ 7.5 µHz
+*  - Voices are mixed two at a time with SMLAD (dual 16x16 MAC)
+*  - Notes from the sequencer go to voices round-robin, so the
+*    release tail of one note overlaps the next
+*  - tone_flush() re-renders the queued half buffer after a button
+*    press, so a new note is heard within one half buffer
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+
+#include "lab4_regs.h"
+#include "dds.h"
+#include "seq.h"
+
+#if TONE_ENGINE == TONE_ENGINE_DDS
+
+#if (DDS_FS_HZ % 2000UL) != 0
+#error "DDS_FS_HZ must give a whole number of samples per 500 us score tick"
+#endif
+
+/* Cortex-M4 DSP intrinsics (ACLE); portable fallbacks for other targets */
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#define dds_smlad(x, y, acc)  __smlad((int)(x), (int)(y), (acc))
+#define dds_usat12(x)         ((unsigned)__usat((x), 12))
+#else
+static inline int dds_smlad(unsigned x, unsigned y, int acc) {
+  return acc + (short)x * (short)y + (short)(x >> 16) * (short)(y >> 16);
+}
+static inline unsigned dds_usat12(int x) { return (x < 0) ? 0u : (x > 4095) ? 4095u : (unsigned)x; }
+#endif
+
+#define DDS_OUT_SHIFT   19      /* Q15 sample * Q15 gain -> 12-bit swing */
+#define DDS_MIDSCALE    2048
+#define DDS_REL_SHIFT   5       /* release: level -= level/32 per half buffer */
+#define DDS_LEVEL_FLOOR 32
+#define DDS_NO_VOICE    0xFFu
+
+#if TONE_MEASURE
+#define MEASURE_SETUP()  tone_measure_setup_done()
+#else
+#define MEASURE_SETUP()  ((void)0)
+#endif
+
+volatile dds_stats_t dds_stats;
+
+/* Phase increment of every MIDI note: round(f * 2^32 / Fs), f in mHz */
+#define NOTE_INC(mhz) (unsigned)((((unsigned long long)(mhz) << 32) + DDS_FS_HZ * 500ULL) / (DDS_FS_HZ * 1000ULL)),
+static const unsigned note_inc[128] = { SCORE_MIDI_MHZ(NOTE_INC) };
+
+static const short sine256[256] = {
+       0,   804,  1608,  2410,  3212,  4011,  4808,  5602,  6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+   12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+   23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+   30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+   32767, 32757, 32728, 32678, 32609, 32521, 32412, 32285, 32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571,
+   30273, 29956, 29621, 29268, 28898, 28510, 28105, 27683, 27245, 26790, 26319, 25832, 25329, 24811, 24279, 23731,
+   23170, 22594, 22005, 21403, 20787, 20159, 19519, 18868, 18204, 17530, 16846, 16151, 15446, 14732, 14010, 13279,
+   12539, 11793, 11039, 10278,  9512,  8739,  7962,  7179,  6393,  5602,  4808,  4011,  3212,  2410,  1608,   804,
+       0,  -804, -1608, -2410, -3212, -4011, -4808, -5602, -6393, -7179, -7962, -8739, -9512,-10278,-11039,-11793,
+  -12539,-13279,-14010,-14732,-15446,-16151,-16846,-17530,-18204,-18868,-19519,-20159,-20787,-21403,-22005,-22594,
+  -23170,-23731,-24279,-24811,-25329,-25832,-26319,-26790,-27245,-27683,-28105,-28510,-28898,-29268,-29621,-29956,
+  -30273,-30571,-30852,-31113,-31356,-31580,-31785,-31971,-32137,-32285,-32412,-32521,-32609,-32678,-32728,-32757,
+  -32767,-32757,-32728,-32678,-32609,-32521,-32412,-32285,-32137,-31971,-31785,-31580,-31356,-31113,-30852,-30571,
+  -30273,-29956,-29621,-29268,-28898,-28510,-28105,-27683,-27245,-26790,-26319,-25832,-25329,-24811,-24279,-23731,
+  -23170,-22594,-22005,-21403,-20787,-20159,-19519,-18868,-18204,-17530,-16846,-16151,-15446,-14732,-14010,-13279,
+  -12539,-11793,-11039,-10278, -9512, -8739, -7962, -7179, -6393, -5602, -4808, -4011, -3212, -2410, -1608,  -804,
+};
+
+/* Voice state (written by play_note() with IRQs masked, read by the ISR) */
+static unsigned      phase[DDS_VOICES];
+static unsigned      inc[DDS_VOICES];
+static short         level[DDS_VOICES];     /* Q15 envelope */
+static unsigned char gate[DDS_VOICES];
+static unsigned      active_pairs;          /* pairs [0, active_pairs) are mixed */
+static unsigned      rendered_pairs;        /* pairs advanced by the last render */
+static unsigned      fresh;                 /* voices (re)started since that render */
+static unsigned      next_voice;
+static unsigned      cur_voice = DDS_NO_VOICE;
+
+static volatile int      note_samples;      /* left in the current score event */
+static volatile unsigned note_done = 1;
+
+static unsigned short dac_buf[2 * DDS_HALF];
+
+#if TONE_MEASURE
+/* Latency probe: the half buffer holding a new note's first sample */
+#define FIRST_IDLE    0u
+#define FIRST_RENDER  1u                    /* goes into the next half rendered */
+#define FIRST_QUEUED  2u                    /* in first_half, DMA not there yet */
+static unsigned short *first_half;
+static unsigned        first_state;
+#endif
+
+/* The half the DMA reads next (the other one is playing now) */
+static inline unsigned short *queued_half(void) {
+  return (DMA1_CNDTR3 > DDS_HALF) ? &dac_buf[DDS_HALF] : &dac_buf[0];
+}
+
+/* Mix `pairs` voice pairs into n 12-bit DAC samples */
+static void render(unsigned short *out, unsigned n, unsigned pairs) {
+  unsigned gains[DDS_VOICES / 2];
+  for (unsigned p = 0; p < pairs; ++p)
+    gains[p] = (unsigned short)level[2*p] | ((unsigned)(unsigned short)level[2*p + 1] << 16);
+
+  for (unsigned i = 0; i < n; ++i) {
+    int acc = 0;
+    for (unsigned p = 0; p < pairs; ++p) {
+      unsigned v  = 2*p;
+      unsigned p0 = (phase[v]     += inc[v]);
+      unsigned p1 = (phase[v + 1] += inc[v + 1]);
+      unsigned s  = (unsigned short)sine256[p0 >> 24]
+                  | ((unsigned)(unsigned short)sine256[p1 >> 24] << 16);
+      acc = dds_smlad(s, gains[p], acc);
+    }
+    out[i] = (unsigned short)dds_usat12((acc >> DDS_OUT_SHIFT) + DDS_MIDSCALE);
+  }
+}
+
+/* Per-half-buffer envelope: released voices decay exponentially */
+static void envelope_step(void) {
+  unsigned top = 0;
+  for (unsigned v = 0; v < DDS_VOICES; ++v) {
+    if (!gate[v] && level[v]) {
+      level[v] -= level[v] >> DDS_REL_SHIFT;
+      if (level[v] < DDS_LEVEL_FLOOR) level[v] = 0;
+    }
+    if (level[v]) top = v/2 + 1;
+  }
+  active_pairs = top;
+}
+
+/* Half/full-transfer: refill whichever half the DMA is not reading */
+void DMA1_Channel3_IRQHandler(void) {
+#if TONE_MEASURE
+  unsigned t0 = DWT_CYCCNT;
+#endif
+  unsigned flags = DMA1_ISR & (DMA_ISR_GIF3 | DMA_ISR_TCIF3 | DMA_ISR_HTIF3);
+  DMA1_IFCR = flags;
+  if ((flags & (DMA_ISR_TCIF3 | DMA_ISR_HTIF3)) == (DMA_ISR_TCIF3 | DMA_ISR_HTIF3))
+    dds_stats.underruns++;
+
+  unsigned short *half = queued_half();
+#if TONE_MEASURE
+  if (first_state == FIRST_QUEUED && half != first_half) {   /* DMA just entered it */
+    tone_measure_first_edge();
+    first_state = FIRST_IDLE;
+  }
+#endif
+  rendered_pairs = active_pairs;
+  fresh = 0;
+  render(half, DDS_HALF, rendered_pairs);
+  envelope_step();
+#if TONE_MEASURE
+  if (first_state == FIRST_RENDER) { first_half = half; first_state = FIRST_QUEUED; }
+#endif
+
+  if (!note_done) {
+    note_samples -= (int)DDS_HALF;
+    if (note_samples <= 0) {
+      if (cur_voice != DDS_NO_VOICE) gate[cur_voice] = 0;   /* start release */
+      cur_voice = DDS_NO_VOICE;
+      note_done = 1;
+      seq_note_done();                       /* next event, if a song is running */
+    }
+  }
+#if TONE_MEASURE
+  unsigned dt = DWT_CYCCNT - t0;
+  if (dt > dds_stats.isr_cycles_max) dds_stats.isr_cycles_max = dt;
+#endif
+}
+
+#if TONE_MEASURE
+/* Render one half buffer with 0..DDS_VOICES/2 pairs sounding and record
+ * cycles per sample; runs once before the DMA is started. */
+static void dds_bench(void) {
+  unsigned short scratch[DDS_HALF];
+  unsigned maxp = DDS_VOICES / 2;
+
+  for (unsigned v = 0; v < DDS_VOICES; ++v) {
+    inc[v]   = 0x0E10000u + v * 0x10000u;   /* ~220 Hz .. spread */
+    level[v] = DDS_VOICE_GAIN;
+  }
+  for (unsigned p = 0; p <= maxp; ++p) {
+    unsigned t0 = DWT_CYCCNT;
+    render(scratch, DDS_HALF, p);
+    dds_stats.cycles_per_sample[p] = (DWT_CYCCNT - t0 + DDS_HALF/2) / DDS_HALF;
+  }
+  for (unsigned v = 0; v < DDS_VOICES; ++v) { phase[v] = 0; inc[v] = 0; level[v] = 0; }
+
+  dds_stats.budget = (unsigned)(TIMER_CLK_HZ / DDS_FS_HZ);
+  unsigned base  = dds_stats.cycles_per_sample[0];
+  unsigned slope = (dds_stats.cycles_per_sample[maxp] - base + maxp - 1) / maxp;   /* per pair */
+  unsigned avail = dds_stats.budget / 2;      /* keep half the core for everything else */
+  dds_stats.voices_fit = (slope && avail > base) ? 2u * ((avail - base) / slope) : 0u;
+}
+#endif
+
+static void dac_dma_init(void) {
+  RCC_AHB2ENR  |= GPIOAEN;
+  RCC_AHB1ENR  |= DMA1EN;
+  RCC_APB1ENR1 |= DAC1EN | TIM6EN;
+
+  GPIOA_MODER |= (3u << (4*2));              /* PA4 = analog (DAC1_OUT1) */
+
+  for (unsigned i = 0; i < 2 * DDS_HALF; ++i) dac_buf[i] = DDS_MIDSCALE;
+
+  /* DMA1 ch3: dac_buf -> DHR12R1, 16-bit, circular, half + full interrupts */
+  DMA1_CCR3   = 0;
+  DMA1_CSELR  = (DMA1_CSELR & ~(0xFu << 8)) | DMA_CSELR_C3S_DAC1;
+  DMA1_CPAR3  = (unsigned)(DAC1_BASE + 0x08);
+  DMA1_CMAR3  = (unsigned)(unsigned long)dac_buf;
+  DMA1_CNDTR3 = 2 * DDS_HALF;
+  DMA1_CCR3   = DMA_CCR_DIR | DMA_CCR_CIRC | DMA_CCR_MINC | DMA_CCR_PSIZE16
+              | DMA_CCR_MSIZE16 | DMA_CCR_PL_HIGH | DMA_CCR_HTIE | DMA_CCR_TCIE;
+  DMA1_CCR3  |= DMA_CCR_EN;
+  nvic_enable(DMA1_CH3_IRQn, 1);
+
+  /* DAC ch1 converts on every TIM6 TRGO and requests the next sample */
+  DAC_CR = DAC_CR_TSEL1_TIM6 | DAC_CR_TEN1 | DAC_CR_DMAEN1 | DAC_CR_EN1;
+
+  /* TIM6: free-running sample clock, TRGO on update */
+  TIM6_CR1 = 0;
+  TIM6_PSC = 0;
+  TIM6_ARR = (unsigned)(TIMER_CLK_HZ / DDS_FS_HZ - 1UL);
+  TIM6_CR2 = TIM_CR2_MMS_UPDATE;
+  TIM6_EGR = TIM_EGR_UG;
+  TIM6_SR  = 0;
+  TIM6_CR1 = TIM_CR1_CEN;
+}
+
+static void wait_note_done(void) {
+  for (;;) {
+    cpu_irq_disable();
+    if (note_done) { cpu_irq_enable(); return; }
+#if TONE_MEASURE
+    unsigned t0 = DWT_CYCCNT;
+    cpu_wfi();
+    tone_stats.idle_cycles += DWT_CYCCNT - t0;
+#else
+    cpu_wfi();
+#endif
+    cpu_irq_enable();
+  }
+}
+
+void tone_init(void) {
+  tone_clock_init();
+#if TONE_MEASURE
+  tone_measure_init();
+  dds_bench();
+#endif
+  dac_dma_init();
+}
+
+/* Safe from thread or ISR context; the previous note is released */
+void tone_start(unsigned note, unsigned dur) {
+  if (dur == 0) dur = 1;
+
+  unsigned pm = cpu_irq_save();
+  if (cur_voice != DDS_NO_VOICE) gate[cur_voice] = 0;
+  if (note != SCORE_REST) {
+    unsigned v = next_voice;
+    next_voice = (next_voice + 1u) % DDS_VOICES;
+    phase[v] = 0;
+    inc[v]   = note_inc[note & 127u];
+    level[v] = DDS_VOICE_GAIN;
+    gate[v]  = 1;
+    fresh   |= 1u << v;
+    cur_voice = v;
+    if (v/2 + 1 > active_pairs) active_pairs = v/2 + 1;
+#if TONE_MEASURE
+    first_state = FIRST_RENDER;
+#endif
+  } else {
+    cur_voice = DDS_NO_VOICE;                /* rest: earlier tails keep ringing */
+  }
+  note_samples = (int)dur;
+  note_done = 0;
+  cpu_irq_restore(pm);
+  MEASURE_SETUP();
+}
+
+void tone_stop(void) {
+  unsigned pm = cpu_irq_save();
+  if (cur_voice != DDS_NO_VOICE) gate[cur_voice] = 0;
+  cur_voice = DDS_NO_VOICE;
+  note_done = 1;
+  cpu_irq_restore(pm);
+}
+
+/* A note started between half-buffer interrupts is first rendered into
+ * the half after the queued one: up to 2 x DDS_HALF samples (1 ms) late.
+ * Rewind the voices and render the queued half again so it is heard when
+ * the playing half ends. Skipped when the DMA is about to switch halves;
+ * then the next interrupt is only a few samples away anyway. Call at the
+ * DMA interrupt's priority (or with IRQs masked). */
+void tone_flush(void) {
+  unsigned pm = cpu_irq_save();
+  unsigned left = DMA1_CNDTR3;
+  if (left > DDS_HALF) left -= DDS_HALF;    /* samples left in the playing half */
+  if (left >= DDS_FLUSH_MIN) {
+    unsigned short *half = queued_half();
+    for (unsigned v = 0; v < 2*rendered_pairs; ++v)
+      if (!(fresh & (1u << v))) phase[v] -= DDS_HALF * inc[v];
+    rendered_pairs = active_pairs;
+    fresh = 0;
+    render(half, DDS_HALF, rendered_pairs);
+#if TONE_MEASURE
+    if (first_state == FIRST_RENDER) { first_half = half; first_state = FIRST_QUEUED; }
+#endif
+  }
+  cpu_irq_restore(pm);
+}
+
+void play_note(unsigned note, unsigned dur) {
+  if (dur == 0) return;
+  tone_start(note, dur);
+  wait_note_done();
+}
+
+#endif /* TONE_ENGINE == TONE_ENGINE_DDS */
@@ -0,0 +1,36 @@
+/*********************************************************************
+*  dds.h — E155 Lab 4: multi-voice DDS synthesizer (TONE_ENGINE_DDS)
+*  - Audio out:   PA4 = DAC1_OUT1 (to LM386 IN+ via pot/divider)
+*  - TIM6 TRGO clocks the DAC at DDS_FS_HZ, DMA1 ch3 streams a
+*    circular double buffer, the half/full ISR renders the next half
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+#ifndef DDS_H
+#define DDS_H
+
+#include "tone.h"
+
+#define DDS_FS_HZ      TONE_DUR_HZ /* 32 kHz: TIM6 reload = TIMER_CLK_HZ / DDS_FS_HZ */
+#define DDS_VOICES     8u        /* even: voices are mixed in pairs with SMLAD          */
+#define DDS_HALF       16u       /* samples per half buffer (0.5 ms at 32 kHz)         */
+#define DDS_VOICE_GAIN 8191      /* Q15 per-voice level: four full voices = full scale */
+#define DDS_FLUSH_MIN  4u        /* tone_flush() needs this many samples of headroom   */
+
+#if (DDS_VOICES & 1u) || DDS_VOICES == 0
+#error "DDS_VOICES must be a non-zero even number"
+#endif
+
+/* Budget report (TONE_MEASURE=1, read from the debugger).
+ * cycles_per_sample[p] is the measured render cost with p voice pairs active;
+ * budget is what one sample period allows at TIMER_CLK_HZ. */
+typedef struct {
+  unsigned budget;                               /* TIMER_CLK_HZ / DDS_FS_HZ           */
+  unsigned cycles_per_sample[DDS_VOICES/2 + 1];  /* from dds_bench() at start-up       */
+  unsigned voices_fit;                           /* voices that fit in 50% of budget   */
+  unsigned isr_cycles_max;                       /* worst live half-buffer ISR         */
+  unsigned underruns;                            /* ISR found both halves pending      */
+} dds_stats_t;
+
+extern volatile dds_stats_t dds_stats;
+
+#endif /* DDS_H */
@@ -0,0 +1,234 @@
+/*********************************************************************
+*  lab4_sim.c — E155 Lab 4: host renderer and timing benchmark
+*  - Runs the real tone.c / seq.c / scores.c against the register
+*    model in sim.c and records every PA11 transition
+*  - Per score event: pitch error (cents) from the edge spacing,
+*    duration error and start drift from the engine's note timer
+*    (TIM6 starts for the ISR engine, TIM2 starts for busy-wait)
+*  - Optional WAV of the exact pin waveform (box-filtered)
+*  - Usage: lab4_sim [-q] [-w prefix] [-r rate] [song ...]
+*           songs: fur_elise imperial (default: all)
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lab4_regs.h"
+#include "../tone.h"
+#include "../scores.h"
+
+#if TONE_ENGINE == TONE_ENGINE_DDS
+#error "the host model drives PA11 only: build with TONE_ENGINE_ISR or TONE_ENGINE_BUSYWAIT"
+#endif
+
+#if TONE_ENGINE == TONE_ENGINE_ISR
+#define ENGINE_NAME "isr"
+#define NOTE_TIMER  1          /* sim_trace.tim_start[1] = TIM6 */
+#else
+#define ENGINE_NAME "busywait"
+#define NOTE_TIMER  0          /* TIM2 */
+#endif
+
+static const struct { const char *name; const score_t *score; } songs[] = {
+  { "fur_elise", &fur_elise },
+  { "imperial",  &imperial  },
+};
+#define N_SONGS (sizeof songs / sizeof songs[0])
+
+static const char *note_names[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+/* A note's first edge is driven just before its timer is enabled */
+#define EDGE_GUARD 100u
+
+typedef struct { unsigned note, ticks; } event_t;
+
+/* Same event list play_score() walks: ties merged, leading tie dropped */
+static unsigned score_events(const score_t *s, event_t *ev, unsigned max) {
+  unsigned n = 0;
+  const score_word_t *w = s->notes;
+  while (*w != SCORE_END && n < max) {
+    unsigned note = SCORE_NOTE_OF(*w), ticks = SCORE_TICKS_OF(*w);
+    ++w;
+    while (SCORE_NOTE_OF(*w) == SCORE_TIE) { ticks += SCORE_TICKS_OF(*w); ++w; }
+    if (note == SCORE_TIE) continue;
+    ev[n].note = note;
+    ev[n].ticks = ticks;
+    n++;
+  }
+  return n;
+}
+
+static int cmp_ull(const void *a, const void *b) {
+  unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+  return (x > y) - (x < y);
+}
+
+/* Mean edge spacing, ignoring intervals more than 10% off the median:
+ * the first and last half periods of a note are cut by its start/stop */
+static double half_period(const sim_edge_t *e, unsigned n) {
+  static unsigned long long iv[1u << 16];
+  unsigned m = 0;
+  for (unsigned i = 1; i < n && m < (1u << 16); ++i) iv[m++] = e[i].t - e[i-1].t;
+  qsort(iv, m, sizeof iv[0], cmp_ull);
+  double med = (double)iv[m / 2], sum = 0;
+  unsigned used = 0;
+  for (unsigned i = 0; i < m; ++i)
+    if (fabs((double)iv[i] - med) <= 0.1 * med) { sum += (double)iv[i]; used++; }
+  return sum / used;
+}
+
+static double midi_hz(unsigned note) { return 440.0 * pow(2.0, ((double)note - 69.0) / 12.0); }
+
+static void put_le(FILE *f, unsigned v, unsigned bytes) {
+  for (unsigned i = 0; i < bytes; ++i) fputc((v >> (8u*i)) & 0xFFu, f);
+}
+
+/* 16-bit mono WAV of the pin: each sample is the fraction of its period
+ * the pin spent high, scaled to half of full scale */
+static int write_wav(const char *path, unsigned long long t0, unsigned long long t1, unsigned rate) {
+  FILE *f = fopen(path, "wb");
+  if (!f) { perror(path); return -1; }
+  double cps = (double)TIMER_CLK_HZ / rate;
+  unsigned n = (unsigned)((double)(t1 - t0) / cps) + 1u;
+
+  fwrite("RIFF", 1, 4, f); put_le(f, 36u + 2u*n, 4); fwrite("WAVE", 1, 4, f);
+  fwrite("fmt ", 1, 4, f); put_le(f, 16, 4); put_le(f, 1, 2); put_le(f, 1, 2);
+  put_le(f, rate, 4); put_le(f, 2u*rate, 4); put_le(f, 2, 2); put_le(f, 16, 2);
+  fwrite("data", 1, 4, f); put_le(f, 2u*n, 4);
+
+  const sim_edge_t *e = sim_trace.edges;
+  unsigned ne = sim_trace.n_edges, k = 0, level = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    double a = (double)t0 + i * cps, b = a + cps, high = 0.0, t = a;
+    while (k < ne && (double)e[k].t < b) {
+      double te = (double)e[k].t < a ? a : (double)e[k].t;
+      if (level) high += te - t;
+      t = te;
+      level = e[k].level;
+      k++;
+    }
+    if (level) high += b - t;
+    put_le(f, (unsigned)(short)(high / cps * 16383.0), 2);
+  }
+  fclose(f);
+  return 0;
+}
+
+static void run_song(const char *name, const score_t *s, int quiet, const char *wav_prefix, unsigned rate) {
+  static event_t ev[4096];
+  unsigned n = score_events(s, ev, 4096);
+  double clk = (double)TIMER_CLK_HZ, tick_s = (double)s->tick_len / TONE_DUR_HZ;
+
+  sim_trace_clear();
+  play_score(s);
+  unsigned long long t_done = sim_trace.now;
+
+  const sim_times_t *starts = &sim_trace.tim_start[NOTE_TIMER];
+  const sim_times_t *stops  = &sim_trace.tim_stop[NOTE_TIMER];
+  if (starts->n != n)
+    printf("warning: %s: %u score events but %u note-timer starts\n", name, n, starts->n);
+  if (starts->n == 0) return;
+  unsigned m = starts->n < n ? starts->n : n;
+  unsigned long long t0 = starts->t[0];
+  unsigned long long t_end = (NOTE_TIMER == 1 && stops->n) ? stops->t[stops->n - 1] : t_done;
+
+  if (!quiet) {
+    printf("\n%s (%s engine, TIMER_CLK_HZ %lu, tick %.1f ms)\n", name, ENGINE_NAME,
+           (unsigned long)TIMER_CLK_HZ, tick_s * 1e3);
+    printf("   #  note   f_ideal Hz  f_meas Hz    cents   dur ms   dur err us  start drift us\n");
+  }
+
+  double max_cents = 0, sum_cents2 = 0, max_derr = 0, sum_derr = 0;
+  unsigned n_pitched = 0, k = 0;
+  double expected_t = 0;
+  for (unsigned i = 0; i < m; ++i) {
+    unsigned long long a = starts->t[i];
+    unsigned long long b = (i + 1 < starts->n) ? starts->t[i + 1] : t_end;
+    double dur_exp = ev[i].ticks * tick_s;
+    double dur_meas = (double)(b - a) / clk;
+    double derr_us = (dur_meas - dur_exp) * 1e6;
+    double drift_us = ((double)(a - t0) / clk - expected_t) * 1e6;
+    expected_t += dur_exp;
+    if (fabs(derr_us) > max_derr) max_derr = fabs(derr_us);
+    sum_derr += fabs(derr_us);
+
+    while (k < sim_trace.n_edges && sim_trace.edges[k].t + EDGE_GUARD < a) k++;
+    unsigned first = k, last = k;
+    while (last < sim_trace.n_edges && sim_trace.edges[last].t + EDGE_GUARD < b) last++;
+    unsigned n_e = last - first;
+
+    if (ev[i].note == SCORE_REST) {
+      if (!quiet) printf("%4u  rest   %s  %9.3f  %+10.1f  %+14.1f\n", i,
+                         n_e ? "(edges!)  " : "          ", dur_meas * 1e3, derr_us, drift_us);
+      continue;
+    }
+    double f_ideal = midi_hz(ev[i].note), f_meas = 0, cents = 0;
+    if (n_e >= 3) {
+      f_meas = clk / (2.0 * half_period(&sim_trace.edges[first], n_e));
+      cents = 1200.0 * log2(f_meas / f_ideal);
+      if (fabs(cents) > max_cents) max_cents = fabs(cents);
+      sum_cents2 += cents * cents;
+      n_pitched++;
+    }
+    if (!quiet)
+      printf("%4u  %-2s%-2d %11.3f %10.3f %+8.2f %9.3f  %+10.1f  %+14.1f\n", i,
+             note_names[ev[i].note % 12], (int)ev[i].note / 12 - 1, f_ideal, f_meas, cents,
+             dur_meas * 1e3, derr_us, drift_us);
+  }
+
+  double total_exp = 0;
+  for (unsigned i = 0; i < n; ++i) total_exp += ev[i].ticks * tick_s;
+  double total_meas = (double)(t_end - t0) / clk;
+  double drift_us = (total_meas - total_exp) * 1e6;
+
+  printf("%-10s %-8s clk %8lu  events %4u  pitch max %6.2f rms %6.2f cents  "
+         "dur err max %8.1f mean %8.1f us  drift %+9.1f us (%+.1f ppm)\n",
+         name, ENGINE_NAME, (unsigned long)TIMER_CLK_HZ, m, max_cents,
+         n_pitched ? sqrt(sum_cents2 / n_pitched) : 0.0, max_derr, m ? sum_derr / m : 0.0,
+         drift_us, drift_us / total_exp);
+  if (!quiet) {
+    printf("tone_stats: edges %u  jitter max %u mean %.2f cycles  setup max %u mean %.1f cycles  idle %.1f%%\n",
+           tone_stats.edges, tone_stats.jitter_max,
+           tone_stats.edges ? (double)tone_stats.jitter_sum / tone_stats.edges : 0.0,
+           tone_stats.setup_cycles_max,
+           tone_stats.notes ? (double)tone_stats.setup_cycles_sum / tone_stats.notes : 0.0,
+           tone_stats.total_cycles ? 100.0 * tone_stats.idle_cycles / tone_stats.total_cycles : 0.0);
+  }
+
+  if (wav_prefix) {
+    char path[512];
+    snprintf(path, sizeof path, "%s%s.wav", wav_prefix, name);
+    if (write_wav(path, t0, t_end, rate) == 0 && !quiet) printf("wrote %s\n", path);
+  }
+}
+
+int main(int argc, char **argv) {
+  int quiet = 0;
+  const char *wav_prefix = 0;
+  unsigned rate = 44100;
+  const char *want[N_SONGS + 8];
+  unsigned n_want = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-q")) quiet = 1;
+    else if (!strcmp(argv[i], "-w") && i + 1 < argc) wav_prefix = argv[++i];
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc) rate = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && n_want < N_SONGS + 8) want[n_want++] = argv[i];
+    else {
+      fprintf(stderr, "usage: %s [-q] [-w prefix] [-r rate] [song ...]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  sim_reset(AUDIO_PIN);
+  tone_init();
+
+  for (unsigned s = 0; s < N_SONGS; ++s) {
+    int run = (n_want == 0);
+    for (unsigned j = 0; j < n_want; ++j) if (!strcmp(want[j], songs[s].name)) run = 1;
+    if (run) run_song(songs[s].name, songs[s].score, quiet, wav_prefix, rate);
+  }
+  return 0;
+}
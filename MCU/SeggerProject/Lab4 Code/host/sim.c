@@ -0,0 +1,363 @@
+/*********************************************************************
+*  sim.c — E155 Lab 4: host register model (LAB4_HOST_SIM builds)
+*  - Every sim_addr() call first applies the firmware's previous write
+*    (registers are compared with what the model last published),
+*    then advances time, fires timer updates and interrupts in order,
+*    and publishes live values (CNT, CYCCNT, ...)
+*  - The NVIC latches a pending bit while a peripheral flag is up,
+*    exactly like the hardware, so a stale pending interrupt after a
+*    cleared flag still fires unless ICPR clears it
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lab4_regs.h"
+
+sim_trace_t sim_trace;
+
+/* Sparse memory map: 4 KB pages allocated on first touch */
+#define PAGE_SIZE 4096ul
+#define MAX_PAGES 32u
+
+typedef struct { unsigned long base; unsigned char *mem; } page_t;
+static page_t   pages[MAX_PAGES];
+static unsigned n_pages;
+static page_t  *last_page;
+
+static unsigned char *mem_at(unsigned long addr) {
+  unsigned long base = addr & ~(PAGE_SIZE - 1ul);
+  if (!last_page || last_page->base != base) {
+    unsigned i;
+    for (i = 0; i < n_pages && pages[i].base != base; ++i) { }
+    if (i == n_pages) {
+      if (n_pages == MAX_PAGES) { fprintf(stderr, "sim: too many pages (0x%08lx)\n", addr); exit(2); }
+      pages[i].base = base;
+      pages[i].mem  = calloc(PAGE_SIZE, 1);
+      n_pages++;
+    }
+    last_page = &pages[i];
+  }
+  return last_page->mem + (addr & (PAGE_SIZE - 1ul));
+}
+
+static inline unsigned *reg(unsigned long addr) { return (unsigned *)mem_at(addr); }
+
+/* Timers */
+#define TIM_CR1   0x00ul
+#define TIM_DIER  0x0Cul
+#define TIM_SR    0x10ul
+#define TIM_EGR   0x14ul
+#define TIM_CNT   0x24ul
+#define TIM_PSC   0x28ul
+#define TIM_ARR   0x2Cul
+
+typedef struct {
+  unsigned long       base;
+  unsigned            irq;
+  unsigned long long  span;       /* 2^bits */
+  int                 running;
+  unsigned long long  t_base;     /* cycle where the count was cnt_base */
+  unsigned            cnt_base;
+  unsigned            psc_act;    /* PSC is preloaded: active after an update */
+  unsigned            cnt_pub;
+} tim_t;
+
+static tim_t tims[2];
+#define N_TIMS 2u
+
+/* NVIC */
+#define N_IRQ_WORDS 2u
+static unsigned nvic_enabled[N_IRQ_WORDS];
+static unsigned nvic_pending[N_IRQ_WORDS];
+static unsigned nvic_active[N_IRQ_WORDS];
+static unsigned primask;
+static unsigned cur_prio;          /* 16 = thread mode */
+static unsigned irqs_taken;
+
+static unsigned odr_pub, cyc_pub;
+static unsigned long long cyc_offset;
+
+void TIM2_IRQHandler(void) __attribute__((weak));
+void TIM6_DAC_IRQHandler(void) __attribute__((weak));
+
+static const struct { unsigned irq; void (*handler)(void); } vectors[] = {
+  { TIM2_IRQn,     TIM2_IRQHandler },
+  { TIM6_DAC_IRQn, TIM6_DAC_IRQHandler },
+};
+#define N_VECTORS (sizeof vectors / sizeof vectors[0])
+
+static void times_push(sim_times_t *v, unsigned long long t) {
+  if (v->n == v->cap) {
+    v->cap = v->cap ? 2u * v->cap : 256u;
+    v->t = realloc(v->t, v->cap * sizeof *v->t);
+  }
+  v->t[v->n++] = t;
+}
+
+static void edge_push(unsigned long long t, unsigned level) {
+  if (sim_trace.n_edges == sim_trace.cap_edges) {
+    sim_trace.cap_edges = sim_trace.cap_edges ? 2u * sim_trace.cap_edges : 4096u;
+    sim_trace.edges = realloc(sim_trace.edges, sim_trace.cap_edges * sizeof *sim_trace.edges);
+  }
+  sim_trace.edges[sim_trace.n_edges].t     = t;
+  sim_trace.edges[sim_trace.n_edges].level = level;
+  sim_trace.n_edges++;
+}
+
+/* Timer helpers */
+static unsigned tim_arr(const tim_t *t) {
+  return (unsigned)(*reg(t->base + TIM_ARR) & (t->span - 1ull));
+}
+
+static unsigned tim_cnt(const tim_t *t) {
+  if (!t->running) return t->cnt_base;
+  return t->cnt_base + (unsigned)((sim_trace.now - t->t_base) / (t->psc_act + 1ull));
+}
+
+static unsigned long long tim_next_update(const tim_t *t) {
+  unsigned long long arr = tim_arr(t), cnt = t->cnt_base;
+  unsigned long long steps = (cnt <= arr) ? arr - cnt + 1ull : t->span - cnt + arr + 1ull;
+  return t->t_base + steps * (t->psc_act + 1ull);
+}
+
+static void tim_update(tim_t *t, unsigned long long when) {
+  unsigned *cr1 = reg(t->base + TIM_CR1);
+  *reg(t->base + TIM_SR) |= TIM_SR_UIF;
+  t->cnt_base = 0;
+  t->t_base   = when;
+  t->psc_act  = *reg(t->base + TIM_PSC) & 0xFFFFu;
+  if (*cr1 & TIM_CR1_OPM) {
+    *cr1 &= ~TIM_CR1_CEN;
+    t->running = 0;
+    times_push(&sim_trace.tim_stop[t - tims], when);
+  }
+}
+
+static void tim_writes(tim_t *t) {
+  unsigned *cr1 = reg(t->base + TIM_CR1);
+  unsigned *egr = reg(t->base + TIM_EGR);
+  unsigned *cnt = reg(t->base + TIM_CNT);
+
+  if (*cnt != t->cnt_pub) {                     /* CNT written */
+    t->cnt_base = *cnt;
+    t->t_base   = sim_trace.now;
+  }
+  if (*egr & TIM_EGR_UG) {                      /* software update */
+    *egr = 0;
+    t->cnt_base = 0;
+    t->t_base   = sim_trace.now;
+    t->psc_act  = *reg(t->base + TIM_PSC) & 0xFFFFu;
+    if (!(*cr1 & TIM_CR1_URS)) *reg(t->base + TIM_SR) |= TIM_SR_UIF;
+  }
+  if ((*cr1 & TIM_CR1_CEN) && !t->running) {
+    t->running = 1;
+    t->t_base  = sim_trace.now;
+    times_push(&sim_trace.tim_start[t - tims], sim_trace.now);
+  } else if (!(*cr1 & TIM_CR1_CEN) && t->running) {
+    t->cnt_base = tim_cnt(t);
+    t->running  = 0;
+  }
+}
+
+/* Firmware writes since the last sync take effect now */
+static void apply_writes(void) {
+  for (unsigned i = 0; i < N_TIMS; ++i) tim_writes(&tims[i]);
+
+  unsigned *bsrr = reg(GPIOA_BASE + 0x18), *odr = reg(GPIOA_BASE + 0x14);
+  if (*bsrr) {
+    unsigned set = *bsrr & 0xFFFFu, rst = *bsrr >> 16;
+    *odr  = (*odr & ~rst) | set;
+    *bsrr = 0;
+  }
+  if (*odr != odr_pub) {
+    unsigned bit = 1u << sim_trace.audio_pin;
+    if ((*odr ^ odr_pub) & bit) edge_push(sim_trace.now, (*odr & bit) != 0);
+    odr_pub = *odr;
+  }
+
+  for (unsigned n = 0; n < N_IRQ_WORDS; ++n) {
+    unsigned *iser = reg(0xE000E100UL + 4u*n), *icpr = reg(0xE000E280UL + 4u*n);
+    if (*iser != nvic_enabled[n]) nvic_enabled[n] |= *iser;
+    if (*icpr) { nvic_pending[n] &= ~*icpr; *icpr = 0; }
+  }
+
+  unsigned *cyc = reg(0xE0001004UL);
+  if (*cyc != cyc_pub) cyc_offset = *cyc - sim_trace.now;
+
+  unsigned *rcc_cr = reg(RCC_BASE + 0x00), *rcc_cfgr = reg(RCC_BASE + 0x08);
+  *rcc_cr   = (*rcc_cr & ~RCC_CR_PLLRDY) | ((*rcc_cr & RCC_CR_PLLON) ? RCC_CR_PLLRDY : 0u);
+  *rcc_cfgr = (*rcc_cfgr & ~(3u << 2)) | ((*rcc_cfgr & 3u) << 2);
+}
+
+static void publish(void) {
+  for (unsigned i = 0; i < N_TIMS; ++i) {
+    tims[i].cnt_pub = tim_cnt(&tims[i]);
+    *reg(tims[i].base + TIM_CNT) = tims[i].cnt_pub;
+  }
+  for (unsigned n = 0; n < N_IRQ_WORDS; ++n) *reg(0xE000E100UL + 4u*n) = nvic_enabled[n];
+  cyc_pub = (unsigned)(sim_trace.now + cyc_offset);
+  *reg(0xE0001004UL) = cyc_pub;
+}
+
+/* Peripheral interrupt lines -> NVIC pending latch. A line that is
+ * still high while its handler runs re-pends only on exit. */
+static void sample_lines(void) {
+  for (unsigned i = 0; i < N_TIMS; ++i) {
+    unsigned irq = tims[i].irq, bit = 1u << (irq & 31u);
+    if ((nvic_active[irq >> 5] & bit) == 0
+        && (*reg(tims[i].base + TIM_SR) & *reg(tims[i].base + TIM_DIER) & TIM_DIER_UIE))
+      nvic_pending[irq >> 5] |= bit;
+  }
+}
+
+static unsigned irq_prio(unsigned irq) { return *mem_at(0xE000E400UL + irq) >> 4; }
+
+static int irq_ready(unsigned irq) {
+  unsigned bit = 1u << (irq & 31u);
+  return (nvic_pending[irq >> 5] & nvic_enabled[irq >> 5] & bit) != 0;
+}
+
+static void sync(unsigned cost);
+
+static void dispatch(void) {
+  while (!primask) {
+    int best = -1;
+    unsigned best_prio = cur_prio;
+    for (unsigned v = 0; v < N_VECTORS; ++v) {
+      unsigned irq = vectors[v].irq;
+      if (vectors[v].handler && irq_ready(irq) && irq_prio(irq) < best_prio) {
+        best = (int)v;
+        best_prio = irq_prio(irq);
+      }
+    }
+    if (best < 0) return;
+
+    unsigned irq = vectors[best].irq, bit = 1u << (irq & 31u), saved = cur_prio;
+    nvic_pending[irq >> 5] &= ~bit;
+    nvic_active[irq >> 5]  |=  bit;
+    irqs_taken++;
+    cur_prio = best_prio;
+    sync(SIM_IRQ_ENTRY);
+    vectors[best].handler();
+    sync(SIM_IRQ_EXIT);
+    nvic_active[irq >> 5]  &= ~bit;
+    cur_prio = saved;
+    sample_lines();
+  }
+}
+
+/* Run timer events up to `target`, taking interrupts as they fire */
+static void advance(unsigned long long target) {
+  for (;;) {
+    tim_t *next = 0;
+    unsigned long long tu = target;
+    for (unsigned i = 0; i < N_TIMS; ++i) {
+      if (!tims[i].running) continue;
+      unsigned long long u = tim_next_update(&tims[i]);
+      if (u <= tu) { tu = u; next = &tims[i]; }
+    }
+    if (!next) {
+      if (target > sim_trace.now) sim_trace.now = target;
+      return;
+    }
+    if (tu > sim_trace.now) sim_trace.now = tu;
+    tim_update(next, tu);
+    sample_lines();
+    dispatch();
+  }
+}
+
+static void sync(unsigned cost) {
+  apply_writes();
+  advance(sim_trace.now + cost);
+  sample_lines();
+  dispatch();
+  publish();
+}
+
+/* A polling loop reads one register back to back. After a few identical
+ * reads, jump straight to the access just before the next timer event:
+ * nothing can change in between, so the outcome is the same as stepping.
+ * A changed value restarts the count, so the write that usually follows
+ * a successful poll is never skipped over. */
+#define SPIN_READS 3u
+
+void *sim_addr(unsigned long addr) {
+  static unsigned long spin_addr;
+  static unsigned spin_n, spin_val;
+  if (addr == spin_addr && ++spin_n >= SPIN_READS) {
+    apply_writes();
+    unsigned long long tu = ~0ull;
+    for (unsigned i = 0; i < N_TIMS; ++i)
+      if (tims[i].running && tim_next_update(&tims[i]) < tu) tu = tim_next_update(&tims[i]);
+    if (tu != ~0ull && tu > sim_trace.now + SIM_ACCESS_CYCLES)
+      sim_trace.now += (tu - sim_trace.now - 1u) / SIM_ACCESS_CYCLES * SIM_ACCESS_CYCLES;
+  } else if (addr != spin_addr) {
+    spin_addr = addr;
+    spin_n = 0;
+  }
+  sync(SIM_ACCESS_CYCLES);
+  unsigned v = *reg(addr & ~3ul);
+  if (v != spin_val) { spin_val = v; spin_n = 0; }
+  return mem_at(addr);
+}
+
+unsigned sim_primask(unsigned pm) {
+  unsigned old = primask;
+  primask = pm;
+  sync(0);
+  return old;
+}
+
+/* Sleep until an interrupt is pending (taken at once if PRIMASK is clear) */
+void sim_wfi(void) {
+  unsigned taken = irqs_taken;
+  sync(0);
+  for (;;) {
+    if (irqs_taken != taken) return;
+    for (unsigned v = 0; v < N_VECTORS; ++v)
+      if (irq_ready(vectors[v].irq) && irq_prio(vectors[v].irq) < cur_prio) return;
+
+    unsigned long long tu = ~0ull;
+    for (unsigned i = 0; i < N_TIMS; ++i)
+      if (tims[i].running && tim_next_update(&tims[i]) < tu) tu = tim_next_update(&tims[i]);
+    if (tu == ~0ull) {
+      fprintf(stderr, "sim: WFI at cycle %llu with no timer running\n", sim_trace.now);
+      exit(2);
+    }
+    advance(tu);
+    sample_lines();
+    dispatch();
+    publish();
+  }
+}
+
+void sim_trace_clear(void) {
+  sim_trace.n_edges = 0;
+  for (unsigned i = 0; i < 2; ++i) {
+    sim_trace.tim_start[i].n = 0;
+    sim_trace.tim_stop[i].n  = 0;
+  }
+}
+
+void sim_reset(unsigned audio_pin) {
+  for (unsigned i = 0; i < n_pages; ++i) memset(pages[i].mem, 0, PAGE_SIZE);
+  memset(tims, 0, sizeof tims);
+  tims[0].base = TIM2_BASE; tims[0].irq = TIM2_IRQn;     tims[0].span = 1ull << 32;
+  tims[1].base = TIM6_BASE; tims[1].irq = TIM6_DAC_IRQn; tims[1].span = 1ull << 16;
+  *reg(TIM2_BASE + TIM_ARR) = 0xFFFFFFFFu;
+  *reg(TIM6_BASE + TIM_ARR) = 0xFFFFu;
+  memset(nvic_enabled, 0, sizeof nvic_enabled);
+  memset(nvic_pending, 0, sizeof nvic_pending);
+  memset(nvic_active, 0, sizeof nvic_active);
+  primask = 0;
+  cur_prio = 16;
+  irqs_taken = 0;
+  odr_pub = cyc_pub = 0;
+  cyc_offset = 0;
+  sim_trace.now = 0;
+  sim_trace.audio_pin = audio_pin;
+  sim_trace_clear();
+}
@@ -0,0 +1,52 @@
+/*********************************************************************
+*  sim.h — E155 Lab 4: host register model (LAB4_HOST_SIM builds)
+*  - lab4_regs.h turns every register access into sim_addr(), which
+*    advances simulated time and returns a pointer into a sparse
+*    copy of the memory map
+*  - Modeled: TIM2/TIM6 (PSC, ARR, CNT, UG, URS, OPM, UIF, UIE),
+*    GPIOA ODR/BSRR, NVIC enable/pending/priority, PRIMASK, WFI,
+*    DWT_CYCCNT, RCC PLL ready/switch status. Everything else is
+*    plain memory
+*  - Time is in CPU cycles at TIMER_CLK_HZ. Register accesses cost
+*    SIM_ACCESS_CYCLES, interrupt entry/exit SIM_IRQ_ENTRY/EXIT;
+*    plain C between accesses is free
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+#ifndef LAB4_SIM_H
+#define LAB4_SIM_H
+
+#define SIM_ACCESS_CYCLES  2u
+#define SIM_IRQ_ENTRY     12u
+#define SIM_IRQ_EXIT      10u
+
+/* Firmware side (called through lab4_regs.h) */
+void    *sim_addr(unsigned long addr);
+unsigned sim_primask(unsigned pm);      /* set PRIMASK, return the old value */
+void     sim_wfi(void);
+
+/* Test-bench side */
+typedef struct {
+  unsigned long long t;                 /* cycle of the transition */
+  unsigned           level;             /* pin level after it      */
+} sim_edge_t;
+
+typedef struct {
+  unsigned long long *t;
+  unsigned            n, cap;
+} sim_times_t;
+
+typedef struct {
+  unsigned long long now;               /* cycles since sim_reset()         */
+  sim_edge_t        *edges;             /* PA11 transitions                  */
+  unsigned           n_edges, cap_edges;
+  sim_times_t        tim_start[2];      /* CEN 0->1: [0] TIM2, [1] TIM6      */
+  sim_times_t        tim_stop[2];       /* one-pulse update (CEN 1->0 by HW) */
+  unsigned           audio_pin;
+} sim_trace_t;
+
+extern sim_trace_t sim_trace;
+
+void sim_reset(unsigned audio_pin);
+void sim_trace_clear(void);              /* keep the model, drop the recordings */
+
+#endif /* LAB4_SIM_H */
@@ -0,0 +1,214 @@
+/*********************************************************************
+*  lab4_regs.h — E155 Lab 4: bare-metal register map (no CMSIS)
+*  - RCC / FLASH / PWR / GPIOA / GPIOB / SYSCFG / EXTI
+*  - TIM2 / TIM6 / TIM7 / DAC1 / DMA1
+*  - NVIC, SCB and DWT cycle counter (core peripherals)
+*  - -DLAB4_HOST_SIM routes every access through host/sim.c so the
+*    tone code runs on a PC against a register model
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+#ifndef LAB4_REGS_H
+#define LAB4_REGS_H
+
+#ifdef LAB4_HOST_SIM
+#include "host/sim.h"
+#define LAB4_REG32(addr)  (*(volatile unsigned int*)sim_addr(addr))
+#define LAB4_REG8(addr)   (*(volatile unsigned char*)sim_addr(addr))
+#else
+#define LAB4_REG32(addr)  (*(volatile unsigned int*)(addr))
+#define LAB4_REG8(addr)   (*(volatile unsigned char*)(addr))
+#endif
+
+#define PERIPH_BASE       0x40000000UL
+#define AHB1PERIPH_BASE   0x40020000UL
+#define AHB2PERIPH_BASE   0x48000000UL
+#define RCC_BASE          (AHB1PERIPH_BASE + 0x1000UL)   // 0x40021000
+#define TIM2_BASE         (PERIPH_BASE + 0x0000UL)       // 0x40000000
+#define TIM6_BASE         (PERIPH_BASE + 0x1000UL)       // 0x40001000
+#define TIM7_BASE         (PERIPH_BASE + 0x1400UL)       // 0x40001400
+#define PWR_BASE          (PERIPH_BASE + 0x7000UL)       // 0x40007000
+#define DAC1_BASE         (PERIPH_BASE + 0x7400UL)       // 0x40007400
+#define SYSCFG_BASE       (PERIPH_BASE + 0x10000UL)      // 0x40010000
+#define EXTI_BASE         (PERIPH_BASE + 0x10400UL)      // 0x40010400
+#define DMA1_BASE         (AHB1PERIPH_BASE + 0x0000UL)   // 0x40020000
+#define FLASH_R_BASE      (AHB1PERIPH_BASE + 0x2000UL)   // 0x40022000
+#define GPIOA_BASE        (AHB2PERIPH_BASE + 0x0000UL)   // 0x48000000
+#define GPIOB_BASE        (AHB2PERIPH_BASE + 0x0400UL)   // 0x48000400
+
+/* RCC clock tree */
+#define RCC_CR        LAB4_REG32(RCC_BASE + 0x00)
+#define RCC_CFGR      LAB4_REG32(RCC_BASE + 0x08)
+#define RCC_PLLCFGR   LAB4_REG32(RCC_BASE + 0x0C)
+#define RCC_CR_PLLON      (1u<<24)
+#define RCC_CR_PLLRDY     (1u<<25)
+#define RCC_CFGR_SW_PLL   (3u<<0)
+#define RCC_CFGR_SWS_PLL  (3u<<2)
+#define RCC_PLLCFGR_MSI   (1u<<0)     /* PLLSRC = MSI */
+#define RCC_PLLCFGR_REN   (1u<<24)    /* PLLCLK (R) output enable */
+
+/* RCC enables */
+#define RCC_AHB1ENR   LAB4_REG32(RCC_BASE + 0x48)
+#define RCC_AHB2ENR   LAB4_REG32(RCC_BASE + 0x4C)
+#define RCC_APB1ENR1  LAB4_REG32(RCC_BASE + 0x58)
+#define RCC_APB2ENR   LAB4_REG32(RCC_BASE + 0x60)
+#define DMA1EN        (1u<<0)
+#define GPIOAEN       (1u<<0)
+#define GPIOBEN       (1u<<1)
+#define TIM2EN        (1u<<0)
+#define TIM6EN        (1u<<4)
+#define TIM7EN        (1u<<5)
+#define PWREN         (1u<<28)
+#define DAC1EN        (1u<<29)
+#define SYSCFGEN      (1u<<0)     /* APB2ENR */
+
+/* FLASH */
+#define FLASH_ACR     LAB4_REG32(FLASH_R_BASE + 0x00)
+#define FLASH_ACR_LATENCY_Msk  (7u<<0)
+#define FLASH_ACR_PRFTEN       (1u<<8)
+#define FLASH_ACR_ICEN         (1u<<9)
+#define FLASH_ACR_DCEN         (1u<<10)
+
+/* PWR: low-power mode selected by SLEEPDEEP */
+#define PWR_CR1       LAB4_REG32(PWR_BASE + 0x00)
+#define PWR_CR1_LPMS_Msk   (7u<<0)
+#define PWR_CR1_LPMS_STOP2 (2u<<0)
+
+/* GPIOA */
+#define GPIOA_MODER   LAB4_REG32(GPIOA_BASE + 0x00)
+#define GPIOA_PUPDR   LAB4_REG32(GPIOA_BASE + 0x0C)
+#define GPIOA_IDR     LAB4_REG32(GPIOA_BASE + 0x10)
+#define GPIOA_ODR     LAB4_REG32(GPIOA_BASE + 0x14)
+#define GPIOA_BSRR    LAB4_REG32(GPIOA_BASE + 0x18)
+
+/* GPIOB  */
+#define GPIOB_MODER   LAB4_REG32(GPIOB_BASE + 0x00)
+#define GPIOB_PUPDR   LAB4_REG32(GPIOB_BASE + 0x0C)
+#define GPIOB_IDR     LAB4_REG32(GPIOB_BASE + 0x10)
+
+/* SYSCFG / EXTI: button edges (EXTICR2 holds the port of lines 4..7) */
+#define SYSCFG_EXTICR2 LAB4_REG32(SYSCFG_BASE + 0x0C)
+#define EXTI_IMR1     LAB4_REG32(EXTI_BASE + 0x00)
+#define EXTI_RTSR1    LAB4_REG32(EXTI_BASE + 0x08)
+#define EXTI_FTSR1    LAB4_REG32(EXTI_BASE + 0x0C)
+#define EXTI_PR1      LAB4_REG32(EXTI_BASE + 0x14)
+#define EXTICR_PA     0u
+#define EXTICR_PB     1u
+
+/* TIM2 (32-bit, tone half-period) */
+#define TIM2_CR1      LAB4_REG32(TIM2_BASE + 0x00)
+#define TIM2_DIER     LAB4_REG32(TIM2_BASE + 0x0C)
+#define TIM2_SR       LAB4_REG32(TIM2_BASE + 0x10)
+#define TIM2_EGR      LAB4_REG32(TIM2_BASE + 0x14)
+#define TIM2_CNT      LAB4_REG32(TIM2_BASE + 0x24)
+#define TIM2_PSC      LAB4_REG32(TIM2_BASE + 0x28)
+#define TIM2_ARR      LAB4_REG32(TIM2_BASE + 0x2C)
+
+/* TIM6 (16-bit basic timer: note duration, or DAC sample clock for DDS) */
+#define TIM6_CR1      LAB4_REG32(TIM6_BASE + 0x00)
+#define TIM6_CR2      LAB4_REG32(TIM6_BASE + 0x04)
+#define TIM6_DIER     LAB4_REG32(TIM6_BASE + 0x0C)
+#define TIM6_SR       LAB4_REG32(TIM6_BASE + 0x10)
+#define TIM6_EGR      LAB4_REG32(TIM6_BASE + 0x14)
+#define TIM6_CNT      LAB4_REG32(TIM6_BASE + 0x24)
+#define TIM6_PSC      LAB4_REG32(TIM6_BASE + 0x28)
+#define TIM6_ARR      LAB4_REG32(TIM6_BASE + 0x2C)
+
+/* TIM7 (16-bit basic timer: button debounce tick) */
+#define TIM7_CR1      LAB4_REG32(TIM7_BASE + 0x00)
+#define TIM7_DIER     LAB4_REG32(TIM7_BASE + 0x0C)
+#define TIM7_SR       LAB4_REG32(TIM7_BASE + 0x10)
+#define TIM7_EGR      LAB4_REG32(TIM7_BASE + 0x14)
+#define TIM7_CNT      LAB4_REG32(TIM7_BASE + 0x24)
+#define TIM7_PSC      LAB4_REG32(TIM7_BASE + 0x28)
+#define TIM7_ARR      LAB4_REG32(TIM7_BASE + 0x2C)
+
+#define TIM_CR1_CEN   (1u<<0)
+#define TIM_CR1_URS   (1u<<2)   /* only counter over/underflow raises UIF */
+#define TIM_CR1_OPM   (1u<<3)   /* one-pulse: CEN clears at next update */
+#define TIM_DIER_UIE  (1u<<0)
+#define TIM_EGR_UG    (1u<<0)
+#define TIM_SR_UIF    (1u<<0)
+#define TIM_CR2_MMS_UPDATE (2u<<4)   /* TRGO = update event */
+
+/* DAC1 channel 1 (PA4) */
+#define DAC_CR        LAB4_REG32(DAC1_BASE + 0x00)
+#define DAC_DHR12R1   LAB4_REG32(DAC1_BASE + 0x08)
+#define DAC_CR_EN1      (1u<<0)
+#define DAC_CR_TEN1     (1u<<2)
+#define DAC_CR_TSEL1_TIM6 (0u<<3)    /* TSEL1 = 000: TIM6_TRGO */
+#define DAC_CR_DMAEN1   (1u<<12)
+
+/* DMA1 channel 3 (request 6 = DAC_CH1) */
+#define DMA1_ISR      LAB4_REG32(DMA1_BASE + 0x00)
+#define DMA1_IFCR     LAB4_REG32(DMA1_BASE + 0x04)
+#define DMA1_CCR3     LAB4_REG32(DMA1_BASE + 0x30)
+#define DMA1_CNDTR3   LAB4_REG32(DMA1_BASE + 0x34)
+#define DMA1_CPAR3    LAB4_REG32(DMA1_BASE + 0x38)
+#define DMA1_CMAR3    LAB4_REG32(DMA1_BASE + 0x3C)
+#define DMA1_CSELR    LAB4_REG32(DMA1_BASE + 0xA8)
+#define DMA_ISR_GIF3    (1u<<8)
+#define DMA_ISR_TCIF3   (1u<<9)
+#define DMA_ISR_HTIF3   (1u<<10)
+#define DMA_CCR_EN      (1u<<0)
+#define DMA_CCR_TCIE    (1u<<1)
+#define DMA_CCR_HTIE    (1u<<2)
+#define DMA_CCR_DIR     (1u<<4)      /* memory -> peripheral */
+#define DMA_CCR_CIRC    (1u<<5)
+#define DMA_CCR_MINC    (1u<<7)
+#define DMA_CCR_PSIZE16 (1u<<8)
+#define DMA_CCR_MSIZE16 (1u<<10)
+#define DMA_CCR_PL_HIGH (2u<<12)
+#define DMA_CSELR_C3S_DAC1 (6u<<8)
+
+/* NVIC (Cortex-M4 core) */
+#define NVIC_ISER(n)  LAB4_REG32(0xE000E100UL + 4u*(n))
+#define NVIC_ICPR(n)  LAB4_REG32(0xE000E280UL + 4u*(n))
+#define NVIC_IPR(irq) LAB4_REG8(0xE000E400UL + (irq))
+#define EXTI4_IRQn     10u
+#define DMA1_CH3_IRQn  13u
+#define EXTI9_5_IRQn   23u
+#define TIM2_IRQn      28u
+#define TIM6_DAC_IRQn  54u
+#define TIM7_IRQn      55u
+
+/* SCB: WFI enters Stop (PWR_CR1.LPMS) instead of Sleep when SLEEPDEEP is set */
+#define SCB_SCR       LAB4_REG32(0xE000ED10UL)
+#define SCB_SCR_SLEEPDEEP (1u<<2)
+
+/* DWT cycle counter (used by the measurement builds) */
+#define DEMCR         LAB4_REG32(0xE000EDFCUL)
+#define DWT_CTRL      LAB4_REG32(0xE0001000UL)
+#define DWT_CYCCNT    LAB4_REG32(0xE0001004UL)
+#define DEMCR_TRCENA  (1u<<24)
+#define DWT_CYCCNTENA (1u<<0)
+
+static inline void nvic_enable(unsigned irq, unsigned prio) {
+  NVIC_IPR(irq) = (unsigned char)(prio << 4);   /* 4 implemented priority bits */
+  NVIC_ISER(irq >> 5) = 1u << (irq & 31u);
+}
+
+static inline void nvic_clear_pending(unsigned irq) {
+  NVIC_ICPR(irq >> 5) = 1u << (irq & 31u);
+}
+
+#ifdef LAB4_HOST_SIM
+static inline void cpu_irq_disable(void)        { sim_primask(1); }
+static inline void cpu_irq_enable(void)         { sim_primask(0); }
+static inline unsigned cpu_irq_save(void)       { return sim_primask(1); }
+static inline void cpu_irq_restore(unsigned pm) { sim_primask(pm); }
+static inline void cpu_wfi(void)                { sim_wfi(); }
+#else
+static inline void cpu_irq_disable(void) { __asm volatile ("cpsid i" ::: "memory"); }
+static inline void cpu_irq_enable(void)  { __asm volatile ("cpsie i" ::: "memory"); }
+static inline unsigned cpu_irq_save(void) {      /* mask IRQs, return old PRIMASK */
+  unsigned pm;
+  __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (pm) :: "memory");
+  return pm;
+}
+static inline void cpu_irq_restore(unsigned pm) {
+  __asm volatile ("msr primask, %0" :: "r" (pm) : "memory");
+}
+static inline void cpu_wfi(void)         { __asm volatile ("wfi" ::: "memory"); }
+#endif
+
+#endif /* LAB4_REGS_H */
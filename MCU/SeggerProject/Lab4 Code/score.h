@@ -0,0 +1,59 @@
+/*********************************************************************
+*  score.h — E155 Lab 4: packed note-stream format
+*  - One 16-bit word per event:  [15:9] note  [8:0] ticks (1..511)
+*      note   = MIDI note number (60 = C4, 69 = A4 = 440 Hz)
+*               SCORE_REST (0): silence, SCORE_TIE (127): extend the
+*               previous event without re-triggering it
+*      ticks  = duration in units of the score's tick
+*  - 0x0000 (a zero-length rest) ends the stream
+*  - tools/midi2score.py emits this format from .mid files
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+#ifndef SCORE_H
+#define SCORE_H
+
+typedef unsigned short score_word_t;
+
+#define SCORE_REST        0u
+#define SCORE_TIE         127u
+#define SCORE_MAX_TICKS   511u
+/* Longest event (a note or rest plus its ties) every engine can time:
+ * the ISR engine's TIM6 counts 65536 x 500 us. Longer ones are split,
+ * re-striking the note (tools/midi2score.py does this). */
+#define SCORE_EVENT_MAX_US 32768000u
+
+#define SCORE_NOTE(n, t)  ((score_word_t)(((unsigned)(n) << 9) | (unsigned)(t)))
+#define SCORE_END         ((score_word_t)0)
+#define SCORE_NOTE_OF(w)  ((unsigned)(w) >> 9)
+#define SCORE_TICKS_OF(w) ((unsigned)(w) & SCORE_MAX_TICKS)
+
+/* Equal-tempered pitch of every MIDI note in mHz (A4 = 440000).
+ * X-macro so each engine can fold it into its own constant table
+ * (timer reload, phase increment, ...) at compile time. */
+#define SCORE_MIDI_MHZ(X) \
+  X(8176) X(8662) X(9177) X(9723) X(10301) X(10913) X(11562) X(12250) \
+  X(12978) X(13750) X(14568) X(15434) X(16352) X(17324) X(18354) X(19445) \
+  X(20602) X(21827) X(23125) X(24500) X(25957) X(27500) X(29135) X(30868) \
+  X(32703) X(34648) X(36708) X(38891) X(41203) X(43654) X(46249) X(48999) \
+  X(51913) X(55000) X(58270) X(61735) X(65406) X(69296) X(73416) X(77782) \
+  X(82407) X(87307) X(92499) X(97999) X(103826) X(110000) X(116541) X(123471) \
+  X(130813) X(138591) X(146832) X(155563) X(164814) X(174614) X(184997) X(195998) \
+  X(207652) X(220000) X(233082) X(246942) X(261626) X(277183) X(293665) X(311127) \
+  X(329628) X(349228) X(369994) X(391995) X(415305) X(440000) X(466164) X(493883) \
+  X(523251) X(554365) X(587330) X(622254) X(659255) X(698456) X(739989) X(783991) \
+  X(830609) X(880000) X(932328) X(987767) X(1046502) X(1108731) X(1174659) X(1244508) \
+  X(1318510) X(1396913) X(1479978) X(1567982) X(1661219) X(1760000) X(1864655) X(1975533) \
+  X(2093005) X(2217461) X(2349318) X(2489016) X(2637020) X(2793826) X(2959955) X(3135963) \
+  X(3322438) X(3520000) X(3729310) X(3951066) X(4186009) X(4434922) X(4698636) X(4978032) \
+  X(5274041) X(5587652) X(5919911) X(6271927) X(6644875) X(7040000) X(7458620) X(7902133) \
+  X(8372018) X(8869844) X(9397273) X(9956063) X(10548082) X(11175303) X(11839822) X(12543854)
+
+/* A song: its tick length in the engine's duration unit plus the stream.
+ * Build tick_len with SCORE_TICK_LEN(µs) from tone.h; keep the tick a
+ * multiple of 500 µs so it is exact for every engine. */
+typedef struct {
+  unsigned            tick_len;
+  const score_word_t *notes;
+} score_t;
+
+#endif /* SCORE_H */
@@ -0,0 +1,47 @@
+/*********************************************************************
+*  scores.c — E155 Lab 4: built-in songs in the packed score format
+*  - Same melodies as the old {Hz, ms} tables, with each pitch snapped
+*    to the nearest MIDI note (623 Hz -> D#5 = 622.25 Hz, ...)
+*  - New songs: tools/midi2score.py song.mid --name song > song.c
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+
+#include "tone.h"
+#include "scores.h"
+
+/* Für Elise (tick = 125 ms) */
+static const score_word_t fur_elise_notes[] = {
+  SCORE_NOTE(76,1), SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(71,1), SCORE_NOTE(74,1), SCORE_NOTE(72,1),
+  SCORE_NOTE(69,2), SCORE_NOTE(0,1), SCORE_NOTE(60,1), SCORE_NOTE(64,1), SCORE_NOTE(69,1), SCORE_NOTE(71,2), SCORE_NOTE(0,1), SCORE_NOTE(64,1),
+  SCORE_NOTE(68,1), SCORE_NOTE(71,1), SCORE_NOTE(72,2), SCORE_NOTE(0,1), SCORE_NOTE(64,1), SCORE_NOTE(76,1), SCORE_NOTE(75,1), SCORE_NOTE(76,1),
+  SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(71,1), SCORE_NOTE(74,1), SCORE_NOTE(72,1), SCORE_NOTE(69,2), SCORE_NOTE(0,1), SCORE_NOTE(60,1),
+  SCORE_NOTE(64,1), SCORE_NOTE(69,1), SCORE_NOTE(71,2), SCORE_NOTE(0,1), SCORE_NOTE(64,1), SCORE_NOTE(72,1), SCORE_NOTE(71,1), SCORE_NOTE(69,2),
+  SCORE_NOTE(0,1), SCORE_NOTE(71,1), SCORE_NOTE(72,1), SCORE_NOTE(74,1), SCORE_NOTE(76,3), SCORE_NOTE(67,1), SCORE_NOTE(77,1), SCORE_NOTE(76,1),
+  SCORE_NOTE(74,3), SCORE_NOTE(65,1), SCORE_NOTE(76,1), SCORE_NOTE(74,1), SCORE_NOTE(72,3), SCORE_NOTE(64,1), SCORE_NOTE(74,1), SCORE_NOTE(72,1),
+  SCORE_NOTE(71,2), SCORE_NOTE(0,1), SCORE_NOTE(64,1), SCORE_NOTE(76,1), SCORE_NOTE(0,2), SCORE_NOTE(76,1), SCORE_NOTE(88,1), SCORE_NOTE(0,2),
+  SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(0,2), SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(75,1),
+  SCORE_NOTE(76,1), SCORE_NOTE(71,1), SCORE_NOTE(74,1), SCORE_NOTE(72,1), SCORE_NOTE(69,2), SCORE_NOTE(0,1), SCORE_NOTE(60,1), SCORE_NOTE(64,1),
+  SCORE_NOTE(69,1), SCORE_NOTE(71,2), SCORE_NOTE(0,1), SCORE_NOTE(64,1), SCORE_NOTE(68,1), SCORE_NOTE(71,1), SCORE_NOTE(72,2), SCORE_NOTE(0,1),
+  SCORE_NOTE(64,1), SCORE_NOTE(76,1), SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(75,1), SCORE_NOTE(76,1), SCORE_NOTE(71,1), SCORE_NOTE(74,1),
+  SCORE_NOTE(72,1), SCORE_NOTE(69,2), SCORE_NOTE(0,1), SCORE_NOTE(60,1), SCORE_NOTE(64,1), SCORE_NOTE(69,1), SCORE_NOTE(71,2), SCORE_NOTE(0,1),
+  SCORE_NOTE(64,1), SCORE_NOTE(72,1), SCORE_NOTE(71,1), SCORE_NOTE(69,4),
+  SCORE_END
+};
+const score_t fur_elise = { SCORE_TICK_LEN(125000), fur_elise_notes };
+
+/* Imperial March (tick = 62.5 ms) — tempo 120 BPM */
+static const score_word_t imperial_notes[] = {
+  SCORE_NOTE(69,12), SCORE_NOTE(69,12), SCORE_NOTE(69,2), SCORE_NOTE(69,2), SCORE_NOTE(69,2), SCORE_NOTE(69,2), SCORE_NOTE(65,4), SCORE_NOTE(0,4),
+  SCORE_NOTE(69,12), SCORE_NOTE(69,12), SCORE_NOTE(69,2), SCORE_NOTE(69,2), SCORE_NOTE(69,2), SCORE_NOTE(69,2), SCORE_NOTE(65,4), SCORE_NOTE(0,4),
+  SCORE_NOTE(69,8), SCORE_NOTE(69,8), SCORE_NOTE(69,8), SCORE_NOTE(65,6), SCORE_NOTE(72,2), SCORE_NOTE(69,8), SCORE_NOTE(65,6), SCORE_NOTE(72,2),
+  SCORE_NOTE(69,16), SCORE_NOTE(76,8), SCORE_NOTE(76,8), SCORE_NOTE(76,8), SCORE_NOTE(77,6), SCORE_NOTE(72,2), SCORE_NOTE(69,8), SCORE_NOTE(65,6),
+  SCORE_NOTE(72,2), SCORE_NOTE(69,16), SCORE_NOTE(81,8), SCORE_NOTE(69,6), SCORE_NOTE(69,2), SCORE_NOTE(81,8), SCORE_NOTE(80,6), SCORE_NOTE(79,2),
+  SCORE_NOTE(75,2), SCORE_NOTE(74,2), SCORE_NOTE(75,4), SCORE_NOTE(0,4), SCORE_NOTE(69,4), SCORE_NOTE(75,8), SCORE_NOTE(74,6), SCORE_NOTE(73,2),
+  SCORE_NOTE(72,2), SCORE_NOTE(71,2), SCORE_NOTE(72,2), SCORE_NOTE(0,4), SCORE_NOTE(65,4), SCORE_NOTE(68,8), SCORE_NOTE(65,6), SCORE_NOTE(69,3),
+  SCORE_NOTE(72,8), SCORE_NOTE(69,6), SCORE_NOTE(72,2), SCORE_NOTE(76,16), SCORE_NOTE(81,8), SCORE_NOTE(69,6), SCORE_NOTE(69,2), SCORE_NOTE(81,8),
+  SCORE_NOTE(80,6), SCORE_NOTE(79,2), SCORE_NOTE(75,2), SCORE_NOTE(74,2), SCORE_NOTE(75,4), SCORE_NOTE(0,4), SCORE_NOTE(69,4), SCORE_NOTE(75,8),
+  SCORE_NOTE(74,6), SCORE_NOTE(73,2), SCORE_NOTE(72,2), SCORE_NOTE(71,2), SCORE_NOTE(72,2), SCORE_NOTE(0,4), SCORE_NOTE(65,4), SCORE_NOTE(68,8),
+  SCORE_NOTE(65,6), SCORE_NOTE(69,3), SCORE_NOTE(69,8), SCORE_NOTE(65,6), SCORE_NOTE(72,2), SCORE_NOTE(69,16),
+  SCORE_END
+};
+const score_t imperial = { SCORE_TICK_LEN(62500), imperial_notes };
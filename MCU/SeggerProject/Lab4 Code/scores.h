@@ -0,0 +1,13 @@
+/*********************************************************************
+*  scores.h — E155 Lab 4: songs linked into the player
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+#ifndef SCORES_H
+#define SCORES_H
+
+#include "score.h"
+
+extern const score_t fur_elise;
+extern const score_t imperial;
+
+#endif /* SCORES_H */
@@ -0,0 +1,134 @@
+/*********************************************************************
+*  seq.c — E155 Lab 4: event-driven song sequencer
+*  - seq_note_done() runs in the engine's end-of-note interrupt,
+*    fetches the next score word and starts it with tone_start()
+*  - All state is touched at NVIC priority 1 (engine note-end, button
+*    EXTI) or with PRIMASK set, so no further locking is needed
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+
+#include "lab4_regs.h"
+#include "seq.h"
+
+#if TONE_ENGINE != TONE_ENGINE_BUSYWAIT
+
+static const score_t      *song;           /* playing, or 0 when idle */
+static const score_word_t *next_word;
+static const score_t      *queue[SEQ_QUEUE_LEN];
+static unsigned            q_head, q_count;
+
+static void song_begin(const score_t *s) {
+  song      = s;
+  next_word = s->notes;
+#if TONE_MEASURE
+  tone_measure_begin();
+#endif
+}
+
+/* Start the next sounding event; move to the queued song at SCORE_END */
+static void advance(void) {
+  while (song) {
+    if (*next_word == SCORE_END) {
+#if TONE_MEASURE
+      tone_measure_end();
+#endif
+      song = 0;
+      if (q_count) {
+        song_begin(queue[q_head]);
+        q_head = (q_head + 1u) % SEQ_QUEUE_LEN;
+        q_count--;
+      }
+      continue;
+    }
+#if TONE_MEASURE
+    tone_measure_fetch();
+#endif
+    unsigned note  = SCORE_NOTE_OF(*next_word);
+    unsigned ticks = SCORE_TICKS_OF(*next_word);
+    ++next_word;
+    while (SCORE_NOTE_OF(*next_word) == SCORE_TIE) { ticks += SCORE_TICKS_OF(*next_word); ++next_word; }
+    if (note == SCORE_TIE) continue;        /* tie with nothing to extend */
+    tone_start(note, ticks * song->tick_len);
+    return;
+  }
+  tone_stop();
+}
+
+void seq_note_done(void) {
+  if (song) advance();
+}
+
+int seq_play(const score_t *score, unsigned mode) {
+  int started = 0;
+  unsigned pm = cpu_irq_save();
+  if (song && mode == SEQ_QUEUE) {
+    if (q_count < SEQ_QUEUE_LEN) {
+      queue[(q_head + q_count) % SEQ_QUEUE_LEN] = score;
+      q_count++;
+    }
+  } else {
+    if (mode == SEQ_PREEMPT) q_count = 0;
+    song_begin(score);
+    advance();
+    tone_flush();
+    started = 1;
+  }
+  cpu_irq_restore(pm);
+  return started;
+}
+
+void seq_stop(void) {
+  unsigned pm = cpu_irq_save();
+  song = 0;
+  q_count = 0;
+  tone_stop();
+  cpu_irq_restore(pm);
+}
+
+int seq_busy(void) { return song != 0; }
+
+/* One PRIMASK-guarded WFI: the wake-up interrupt runs after cpsie */
+static void sleep_once(int deep) {
+  if (deep) SCB_SCR |= SCB_SCR_SLEEPDEEP;
+#if TONE_MEASURE
+  unsigned t0 = DWT_CYCCNT;                 /* CYCCNT stops in Stop mode */
+  cpu_wfi();
+  tone_stats.idle_cycles += DWT_CYCCNT - t0;
+#else
+  cpu_wfi();
+#endif
+  if (deep) SCB_SCR &= ~SCB_SCR_SLEEPDEEP;
+}
+
+void seq_wait(void) {
+  for (;;) {
+    cpu_irq_disable();
+    if (!song) { cpu_irq_enable(); return; }
+    sleep_once(0);
+    cpu_irq_enable();
+  }
+}
+
+void seq_idle(int allow_stop) {
+  cpu_irq_disable();
+#if SEQ_IDLE_STOP
+  if (allow_stop && !song) {
+    RCC_APB1ENR1 |= PWREN;
+    PWR_CR1 = (PWR_CR1 & ~PWR_CR1_LPMS_Msk) | PWR_CR1_LPMS_STOP2;
+    sleep_once(1);
+  } else {
+    sleep_once(0);
+  }
+#else
+  (void)allow_stop;
+  sleep_once(0);
+#endif
+  cpu_irq_enable();
+}
+
+void play_score(const score_t *score) {
+  seq_play(score, SEQ_QUEUE);
+  seq_wait();
+}
+
+#endif /* TONE_ENGINE != TONE_ENGINE_BUSYWAIT */
@@ -0,0 +1,40 @@
+/*********************************************************************
+*  seq.h — E155 Lab 4: event-driven song sequencer
+*  - Walks a score from the engine's end-of-note interrupt, so the
+*    thread only sleeps; requests can preempt or queue behind the
+*    current song
+*  - ISR and DDS engines only (the busy-wait engine owns the core)
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+#ifndef SEQ_H
+#define SEQ_H
+
+#include "tone.h"
+
+#define SEQ_PREEMPT   0u   /* drop the queue and start this song now     */
+#define SEQ_QUEUE     1u   /* start now if idle, else play after the rest */
+
+#define SEQ_QUEUE_LEN 4u
+
+/* Stop mode (Stop 2) while nothing plays. Wake-up restarts SYSCLK on
+ * MSI, so this only applies when the engine runs from the 4 MHz MSI. */
+#ifndef SEQ_IDLE_STOP
+#if TONE_ENGINE == TONE_ENGINE_ISR && TIMER_CLK_HZ == 4000000UL
+#define SEQ_IDLE_STOP 1
+#else
+#define SEQ_IDLE_STOP 0
+#endif
+#endif
+
+/* Call from thread or from ISRs at the engine's note-end priority (1).
+ * Returns 1 if the song started sounding, 0 if it was queued or dropped. */
+int  seq_play(const score_t *score, unsigned mode);
+void seq_stop(void);
+int  seq_busy(void);
+
+void seq_wait(void);                 /* sleep until the queue is empty        */
+void seq_idle(int allow_stop);       /* sleep once: Stop 2 if idle and allowed */
+
+void seq_note_done(void);            /* engine hook, end-of-note interrupt    */
+
+#endif /* SEQ_H */
@@ -0,0 +1,362 @@
+/*********************************************************************
+*  tone.c — E155 Lab 4: square-wave tone engine
+*  - Audio out:   PA11  (toggle to LM386 IN+ via pot/divider)
+*  - TIM2:        TIMER_CLK_HZ tick, one update per half period
+*  - TIM6:        one-pulse note-duration timer (ISR engine only);
+*                 its interrupt hands the next event to seq.c
+*  - Per-note reloads come from a compile-time table, so starting a
+*    note is a table load and a multiply (no runtime division)
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+
+#include "lab4_regs.h"
+#include "tone.h"
+#include "seq.h"
+
+#define AUDIO_SET     (1u << AUDIO_PIN)
+#define AUDIO_RST     (1u << (AUDIO_PIN + 16))
+
+volatile tone_stats_t   tone_stats;
+volatile tone_latency_t tone_latency;
+
+/* Measurement helpers (DWT cycle counter) */
+#if TONE_MEASURE
+static unsigned edge_prev;       /* CYCCNT at previous edge            */
+static unsigned edge_nominal;    /* expected cycles between edges      */
+static unsigned edge_armed;      /* 0 until the first edge of a note   */
+static unsigned setup_t0;        /* CYCCNT when the score word was fetched */
+static unsigned song_t0;         /* CYCCNT at tone_measure_begin()     */
+static unsigned press_t0;        /* CYCCNT on entry to the button ISR  */
+static volatile unsigned press_armed;
+
+/* Only differences of CYCCNT are used, so it is never reset (that
+ * would corrupt a press timestamp taken just before a song starts) */
+void tone_measure_init(void) {
+  DEMCR    |= DEMCR_TRCENA;
+  DWT_CTRL |= DWT_CYCCNTENA;
+}
+
+static inline void measure_note(unsigned arr) {
+  edge_nominal = arr + 1u;       /* TIM2 and the core share TIMER_CLK_HZ */
+  edge_armed   = 0;
+}
+
+static inline void measure_edge(void) {
+  unsigned now = DWT_CYCCNT;
+  if (edge_armed) {
+    unsigned d   = now - edge_prev;
+    unsigned dev = (d > edge_nominal) ? d - edge_nominal : edge_nominal - d;
+    if (dev > tone_stats.jitter_max) tone_stats.jitter_max = dev;
+    tone_stats.jitter_sum += dev;
+    tone_stats.edges++;
+  }
+  edge_armed = 1;
+  edge_prev  = now;
+}
+
+/* Called by the engines right after the note's timers are running */
+void tone_measure_setup_done(void) {
+  unsigned dt = DWT_CYCCNT - setup_t0;
+  if (dt > tone_stats.setup_cycles_max) tone_stats.setup_cycles_max = dt;
+  tone_stats.setup_cycles_sum += dt;
+  tone_stats.notes++;
+}
+
+void tone_measure_fetch(void) { setup_t0 = DWT_CYCCNT; }
+
+void tone_measure_begin(void) {
+  tone_measure_init();
+  tone_stats.total_cycles = 0;
+  tone_stats.idle_cycles  = 0;
+  tone_stats.edges        = 0;
+  tone_stats.jitter_max   = 0;
+  tone_stats.jitter_sum   = 0;
+  tone_stats.notes            = 0;
+  tone_stats.setup_cycles_max = 0;
+  tone_stats.setup_cycles_sum = 0;
+  song_t0 = DWT_CYCCNT;
+}
+
+void tone_measure_end(void) {
+  tone_stats.total_cycles = DWT_CYCCNT - song_t0;   /* 32-bit: fine for songs < 17 min @ 4 MHz */
+}
+
+/* Latency log: armed by the button handler, closed by the first edge */
+void tone_measure_press(unsigned t0) {
+  press_t0    = t0;
+  press_armed = 1;
+}
+
+void tone_measure_first_edge(void) {
+  if (!press_armed) return;
+  press_armed = 0;
+  unsigned dt = DWT_CYCCNT - press_t0;
+  if (tone_latency.count == 0 || dt < tone_latency.min) tone_latency.min = dt;
+  if (dt > tone_latency.max) tone_latency.max = dt;
+  tone_latency.sum += dt;
+  tone_latency.log[tone_latency.count % TONE_LAT_LOG] = dt;
+  tone_latency.count++;
+}
+#define MEASURE_NOTE(arr)  measure_note(arr)
+#define MEASURE_EDGE()     measure_edge()
+#define MEASURE_SETUP()    tone_measure_setup_done()
+#define MEASURE_FIRST()    tone_measure_first_edge()
+#else
+#define MEASURE_NOTE(arr)  ((void)0)
+#define MEASURE_EDGE()     ((void)0)
+#define MEASURE_SETUP()    ((void)0)
+#define MEASURE_FIRST()    ((void)0)
+#endif
+
+/* Bring SYSCLK up to TIMER_CLK_HZ. The reset clock is MSI 4 MHz; 80 MHz comes
+ * from the PLL (MSI 4 MHz * N=40 / R=2) with 4 flash wait states. Any other
+ * TIMER_CLK_HZ is assumed to be configured before tone_init(). */
+void tone_clock_init(void) {
+#if TIMER_CLK_HZ == 80000000UL
+  FLASH_ACR = (FLASH_ACR & ~FLASH_ACR_LATENCY_Msk) | 4u
+            | FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN;
+  RCC_CR &= ~RCC_CR_PLLON;
+  while (RCC_CR & RCC_CR_PLLRDY) { /* wait for unlock */ }
+  RCC_PLLCFGR = RCC_PLLCFGR_MSI
+              | (0u  << 4)                  /* M = 1  */
+              | (40u << 8)                  /* N = 40 */
+              | (0u  << 25)                 /* R = 2  */
+              | RCC_PLLCFGR_REN;
+  RCC_CR |= RCC_CR_PLLON;
+  while ((RCC_CR & RCC_CR_PLLRDY) == 0) { /* wait for lock */ }
+  RCC_CFGR = (RCC_CFGR & ~RCC_CFGR_SW_PLL) | RCC_CFGR_SW_PLL;
+  while ((RCC_CFGR & RCC_CFGR_SWS_PLL) != RCC_CFGR_SWS_PLL) { }
+#endif
+}
+
+#if TONE_ENGINE != TONE_ENGINE_DDS
+/* Half period of every MIDI note in TIM2 counts, minus one (ARR):
+ * round(TIMER_CLK_HZ / 2f) - 1, evaluated by the compiler. */
+#define NOTE_ARR(mhz) (unsigned)((TIMER_CLK_HZ * 500ULL + (mhz)/2) / (mhz) - 1ULL),
+static const unsigned note_arr[128] = { SCORE_MIDI_MHZ(NOTE_ARR) };
+
+/* Helpers */
+static void audio_init_pa_output(void) {
+  RCC_AHB2ENR |= GPIOAEN;
+  GPIOA_MODER &= ~(3u << (AUDIO_PIN*2));
+  GPIOA_MODER |=  (1u << (AUDIO_PIN*2));   /* PA11 = output */
+  GPIOA_BSRR = AUDIO_RST;                  /* drive low */
+}
+
+static inline void audio_low(void) { GPIOA_BSRR = AUDIO_RST; }
+
+static void tim2_init_tick(void) {
+  RCC_APB1ENR1 |= TIM2EN;
+  TIM2_CR1 &= ~TIM_CR1_CEN;
+  TIM2_PSC = 0;                   /* count at TIMER_CLK_HZ (finer than 1 µs) */
+  TIM2_ARR = 0xFFFFFFFFu;
+  TIM2_EGR = TIM_EGR_UG;          /* latch PSC/ARR */
+  TIM2_CNT = 0;
+  TIM2_SR  = 0;
+}
+#endif /* TONE_ENGINE != TONE_ENGINE_DDS */
+
+#if TONE_ENGINE == TONE_ENGINE_ISR
+/*********************************************************************
+*  ISR engine: TIM2 update -> toggle PA11, TIM6 one-pulse -> note end.
+*  TIM2 has the higher priority so an edge is never delayed by the
+*  end-of-note handler; the core sleeps in WFI for the whole note.
+*  The pin goes high as soon as a note starts, so the first edge does
+*  not wait half a period for TIM2.
+*********************************************************************/
+#define DUR_MAX 65536u                      /* TIM6 is 16-bit: 32.7 s per event */
+
+static volatile unsigned note_done = 1;
+static unsigned audio_high;                 /* only touched with TIM2 quiet */
+
+void TIM2_IRQHandler(void) {
+  TIM2_SR = 0;                              /* clear UIF */
+  audio_high ^= 1u;
+  GPIOA_BSRR = audio_high ? AUDIO_SET : AUDIO_RST;
+  MEASURE_EDGE();
+}
+
+static void tone_halt(void) {
+  TIM6_CR1 &= ~TIM_CR1_CEN;
+  TIM2_CR1 &= ~TIM_CR1_CEN;                 /* stop the tone ... */
+  TIM6_SR = 0;
+  TIM2_SR = 0;
+  nvic_clear_pending(TIM6_DAC_IRQn);        /* an update that raced the stop */
+  nvic_clear_pending(TIM2_IRQn);
+  audio_high = 0;
+  audio_low();                              /* ... and park the pin low */
+}
+
+void TIM6_DAC_IRQHandler(void) {
+  if ((TIM6_SR & TIM_SR_UIF) == 0) return;  /* note was replaced meanwhile */
+  tone_halt();
+  note_done = 1;
+  seq_note_done();                          /* next event, if a song is running */
+}
+
+static void tim6_init_duration(void) {
+  RCC_APB1ENR1 |= TIM6EN;
+  TIM6_CR1  = TIM_CR1_OPM | TIM_CR1_URS;    /* one-pulse; UG does not raise UIF */
+  TIM6_PSC  = (unsigned)(TIMER_CLK_HZ / TONE_DUR_HZ - 1UL);
+  TIM6_ARR  = 0xFFFF;
+  TIM6_EGR  = TIM_EGR_UG;                   /* latch PSC */
+  TIM6_SR   = 0;
+  TIM6_DIER = TIM_DIER_UIE;
+  nvic_enable(TIM6_DAC_IRQn, 1);
+}
+
+static void tim2_init_tone(void) {
+  tim2_init_tick();
+  TIM2_CR1 |= TIM_CR1_URS;                  /* UG reloads without an edge */
+  TIM2_DIER = TIM_DIER_UIE;
+  nvic_enable(TIM2_IRQn, 0);
+}
+
+/* Sleep until TIM6 ends the note. PRIMASK is set around the check so an
+ * interrupt landing between the test and WFI still wakes the core. */
+static void wait_note_done(void) {
+  for (;;) {
+    cpu_irq_disable();
+    if (note_done) { cpu_irq_enable(); return; }
+#if TONE_MEASURE
+    unsigned t0 = DWT_CYCCNT;
+    cpu_wfi();
+    tone_stats.idle_cycles += DWT_CYCCNT - t0;
+#else
+    cpu_wfi();
+#endif
+    cpu_irq_enable();                       /* pending ISR runs here */
+  }
+}
+
+void tone_init(void) {
+  tone_clock_init();
+  audio_init_pa_output();
+  tim2_init_tone();
+  tim6_init_duration();
+  audio_low();
+}
+
+/* Safe from thread or ISR context; replaces the sounding note */
+void tone_start(unsigned note, unsigned dur) {
+  if (dur == 0) dur = 1;
+  if (dur > DUR_MAX) dur = DUR_MAX;
+  int sounding = (note != SCORE_REST);
+  unsigned arr = note_arr[note & 127u];
+
+  unsigned pm = cpu_irq_save();
+  tone_halt();
+  TIM6_ARR = dur - 1u;
+  TIM6_EGR = TIM_EGR_UG;
+  if (sounding) {
+    TIM2_ARR = arr;
+    TIM2_EGR = TIM_EGR_UG;
+    TIM2_CNT = 0;
+    MEASURE_NOTE(arr);
+    audio_high = 1;
+    GPIOA_BSRR = AUDIO_SET;                 /* first edge now, TIM2 takes it from here */
+    MEASURE_EDGE();
+    MEASURE_FIRST();
+  }
+  note_done = 0;
+  TIM6_CR1 |= TIM_CR1_CEN;                  /* start both timers back to back */
+  if (sounding) TIM2_CR1 |= TIM_CR1_CEN;
+  cpu_irq_restore(pm);
+  MEASURE_SETUP();
+}
+
+void tone_stop(void) {
+  unsigned pm = cpu_irq_save();
+  tone_halt();
+  note_done = 1;
+  cpu_irq_restore(pm);
+}
+
+void tone_flush(void) { /* edges are already live */ }
+
+void play_note(unsigned note, unsigned dur) {
+  if (dur == 0) return;
+  tone_start(note, dur);
+  wait_note_done();
+}
+
+#elif TONE_ENGINE == TONE_ENGINE_BUSYWAIT
+/*********************************************************************
+*  Busy-wait engine: the original loop. The core polls UIF and toggles
+*  PA11 itself, so it is 100% busy for the whole song.
+*********************************************************************/
+/* 2^32 / half period, so toggles = dur / half is one UMULL */
+#define NOTE_INV(mhz) (unsigned)(0x100000000ULL / ((TIMER_CLK_HZ * 500ULL + (mhz)/2) / (mhz))),
+static const unsigned note_inv[128] = { SCORE_MIDI_MHZ(NOTE_INV) };
+
+static inline void tim2_wait_update(void) {
+  while ((TIM2_SR & TIM_SR_UIF) == 0) { /* spin */ }
+  TIM2_SR = 0; /* clear UIF */
+}
+
+static inline void audio_toggle(void) { GPIOA_ODR ^= (1u << AUDIO_PIN); }
+
+static void tim2_run(unsigned arr) {
+  TIM2_CR1 &= ~TIM_CR1_CEN;
+  TIM2_ARR  = arr;
+  TIM2_EGR  = TIM_EGR_UG;
+  TIM2_CNT  = 0;
+  TIM2_SR   = 0;
+  TIM2_CR1 |= TIM_CR1_CEN;
+}
+
+void tone_init(void) {
+  tone_clock_init();
+  audio_init_pa_output();
+  tim2_init_tick();
+  audio_low();
+}
+
+void play_note(unsigned note, unsigned dur) {
+  if (dur == 0) return;
+  if (note == SCORE_REST) {                 /* one update = whole rest */
+    tim2_run(dur - 1u);
+    MEASURE_SETUP();
+    tim2_wait_update();
+    return;
+  }
+
+  unsigned arr = note_arr[note & 127u];
+  /* toggles = round(dur / half period) */
+  unsigned toggles = (unsigned)(((unsigned long long)dur * note_inv[note & 127u] + 0x80000000ULL) >> 32);
+
+  tim2_run(arr);
+  MEASURE_NOTE(arr);
+  MEASURE_SETUP();
+
+  for (unsigned i = 0; i < toggles; ++i) {
+    tim2_wait_update();
+    audio_toggle();
+    MEASURE_EDGE();
+  }
+  audio_low();
+}
+
+/* Blocking player for the busy-wait engine; the ISR and DDS engines get
+ * play_score() from the sequencer (seq.c) */
+void play_score(const score_t *score) {
+#if TONE_MEASURE
+  tone_measure_begin();
+#endif
+  const score_word_t *w = score->notes;
+  while (*w != SCORE_END) {
+#if TONE_MEASURE
+    tone_measure_fetch();
+#endif
+    unsigned note  = SCORE_NOTE_OF(*w);
+    unsigned ticks = SCORE_TICKS_OF(*w);
+    ++w;
+    while (SCORE_NOTE_OF(*w) == SCORE_TIE) { ticks += SCORE_TICKS_OF(*w); ++w; }
+    if (note == SCORE_TIE) continue;        /* tie with nothing to extend */
+    play_note(note, ticks * score->tick_len);
+  }
+#if TONE_MEASURE
+  tone_measure_end();
+#endif
+}
+#endif /* TONE_ENGINE (TONE_ENGINE_DDS lives in dds.c) */
@@ -0,0 +1,100 @@
+/*********************************************************************
+*  tone.h — E155 Lab 4: square-wave tone engine on PA11
+*  - TONE_ENGINE_ISR (default): TIM2 update ISR toggles the pin,
+*    TIM6 one-pulse times the note, core sleeps in WFI meanwhile
+*  - TONE_ENGINE_BUSYWAIT: original polled loop, kept for comparison
+*  - TONE_ENGINE_DDS: multi-voice synthesizer on the DAC (dds.c, PA4)
+*  - Santiago Burgos-Fallon
+*********************************************************************/
+#ifndef TONE_H
+#define TONE_H
+
+#include "score.h"
+
+#define TONE_ENGINE_BUSYWAIT  0
+#define TONE_ENGINE_ISR       1
+#define TONE_ENGINE_DDS       2
+
+#ifndef TONE_ENGINE
+#define TONE_ENGINE TONE_ENGINE_ISR
+#endif
+
+/* Build with -DTONE_MEASURE=1 to collect tone_stats with the DWT cycle counter */
+#ifndef TONE_MEASURE
+#define TONE_MEASURE 0
+#endif
+
+/*Timer input clock (Hz) — also SYSCLK; 80 MHz brings up the PLL */
+#ifndef TIMER_CLK_HZ
+#if TONE_ENGINE == TONE_ENGINE_DDS
+#define TIMER_CLK_HZ 80000000UL   /* mixing several voices needs the PLL */
+#else
+#define TIMER_CLK_HZ 4000000UL
+#endif
+#endif
+
+/* Unit of note durations for the compiled engine */
+#if TONE_ENGINE == TONE_ENGINE_DDS
+#define TONE_DUR_HZ  32000UL           /* DAC samples (DDS_FS_HZ) */
+#elif TONE_ENGINE == TONE_ENGINE_ISR
+#define TONE_DUR_HZ  2000UL            /* TIM6 one-pulse counts   */
+#else
+#define TONE_DUR_HZ  TIMER_CLK_HZ      /* TIM2 counts             */
+#endif
+
+/* Score tick (µs) -> duration units, folded at compile time */
+#define SCORE_TICK_LEN(us) ((unsigned)((unsigned long long)(us) * TONE_DUR_HZ / 1000000ULL))
+
+#define AUDIO_PIN        11u  /* PA11: toggle to LM386 IN+ */
+
+/* Filled in by play_score() when TONE_MEASURE=1 (read from the debugger).
+ * Cycles are CPU cycles; the core and TIM2 both run at TIMER_CLK_HZ. */
+typedef struct {
+  unsigned total_cycles;    /* wall time spent inside play_score()      */
+  unsigned idle_cycles;     /* part of it spent asleep in WFI           */
+  unsigned edges;           /* audio edges measured (first edge of each note excluded) */
+  unsigned jitter_max;      /* max |edge interval - nominal half period| */
+  unsigned long long jitter_sum; /* sum of |deviation|, for the mean     */
+  unsigned notes;           /* score events started                      */
+  unsigned setup_cycles_max;/* word fetch -> timers running, worst note  */
+  unsigned setup_cycles_sum;
+} tone_stats_t;
+
+extern volatile tone_stats_t tone_stats;
+
+/* Button press -> first audio edge, in CPU cycles (TONE_MEASURE=1).
+ * The press time is taken on entry to the EXTI handler; the edge is the
+ * first pin toggle (ISR engine) or the DMA reaching the half buffer that
+ * holds the note's first sample (DDS). */
+#define TONE_LAT_LOG 16u
+typedef struct {
+  unsigned count;                /* presses logged                         */
+  unsigned min, max;
+  unsigned long long sum;
+  unsigned log[TONE_LAT_LOG];    /* most recent at log[(count-1) % TONE_LAT_LOG] */
+} tone_latency_t;
+
+extern volatile tone_latency_t tone_latency;
+
+void tone_init(void);
+void tone_clock_init(void);
+void play_note(unsigned note, unsigned dur);   /* MIDI note (SCORE_REST = 0), dur in TONE_DUR_HZ units */
+void play_score(const score_t *score);
+
+/* Non-blocking interface used by the sequencer (ISR and DDS engines).
+ * tone_start() replaces whatever is sounding and returns at once; the
+ * engine calls seq_note_done() from its end-of-note interrupt. */
+void tone_start(unsigned note, unsigned dur);
+void tone_stop(void);
+void tone_flush(void);               /* make a just-started note audible as early as possible */
+
+/* TONE_MEASURE builds only */
+void tone_measure_init(void);
+void tone_measure_begin(void);       /* song starts: reset tone_stats      */
+void tone_measure_end(void);         /* song ends: total_cycles            */
+void tone_measure_fetch(void);       /* score word fetched                 */
+void tone_measure_setup_done(void);  /* ... and the note is running        */
+void tone_measure_press(unsigned t0);/* arm the latency timer (CYCCNT at press) */
+void tone_measure_first_edge(void);  /* first audio edge since the press   */
+
+#endif /* TONE_H */
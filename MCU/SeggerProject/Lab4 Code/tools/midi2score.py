@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+"""
+midi2score.py — E155 Lab 4: convert a Standard MIDI File to a packed score
+
+Usage:
+    python3 midi2score.py song.mid --name song > song.c
+    python3 midi2score.py song.mid --name song --track 1 --channel 0 --transpose -12
+
+The player is monophonic, so overlapping notes are reduced to the highest
+sounding pitch ("skyline"). Event boundaries are quantized to one score
+tick. By default the tick is the largest multiple of 500 us that divides
+every event length (to within --tolerance); pass --tick-us to force one.
+Events longer than 511 ticks are split into a note word plus SCORE_TIE
+words (or several rests). No event, ties included, runs past 32.768 s
+(SCORE_EVENT_MAX_US, the ISR engine's limit): a longer note is struck
+again at that point.
+
+The generated .c file defines `const score_t <name>`; add it to the
+project and declare it in scores.h. A size report goes to stderr.
+
+Word format (see score.h):  [15:9] MIDI note (0 rest, 127 tie)  [8:0] ticks
+"""
+
+import argparse
+import struct
+import sys
+
+REST = 0
+TIE = 127
+MAX_TICKS = 511
+EVENT_MAX_US = 32768000        # SCORE_EVENT_MAX_US
+TICK_QUANTUM_US = 500          # every engine's duration unit divides 500 us
+
+
+# ---------------------------------------------------------------- SMF parsing
+def read_vlq(data, i):
+    value = 0
+    while True:
+        b = data[i]
+        i += 1
+        value = (value << 7) | (b & 0x7F)
+        if not b & 0x80:
+            return value, i
+
+
+def parse_smf(data):
+    """Return (division, tracks) where each track is a list of
+    (abs_tick, kind, a, b) with kind in {'on', 'off', 'tempo'}."""
+    if data[:4] != b"MThd":
+        raise ValueError("not a Standard MIDI File")
+    hlen, fmt, ntrks, division = struct.unpack(">IHHH", data[4:14])
+    if division & 0x8000:
+        raise ValueError("SMPTE time division is not supported")
+    i = 8 + hlen
+    tracks = []
+    for _ in range(ntrks):
+        if data[i:i + 4] != b"MTrk":
+            raise ValueError("bad track chunk at offset %d" % i)
+        tlen = struct.unpack(">I", data[i + 4:i + 8])[0]
+        tracks.append(parse_track(data[i + 8:i + 8 + tlen]))
+        i += 8 + tlen
+    return division, tracks
+
+
+def parse_track(trk):
+    events = []
+    i = 0
+    tick = 0
+    status = 0
+    while i < len(trk):
+        delta, i = read_vlq(trk, i)
+        tick += delta
+        b = trk[i]
+        if b & 0x80:
+            status = b
+            i += 1
+        if status == 0xFF:                       # meta event
+            mtype = trk[i]
+            mlen, i = read_vlq(trk, i + 1)
+            if mtype == 0x51 and mlen == 3:      # set tempo (us per quarter)
+                events.append((tick, "tempo", int.from_bytes(trk[i:i + 3], "big"), 0))
+            elif mtype == 0x2F:                  # end of track
+                break
+            i += mlen
+            status = 0
+        elif status in (0xF0, 0xF7):             # sysex
+            slen, i = read_vlq(trk, i)
+            i += slen
+            status = 0
+        else:
+            kind = status & 0xF0
+            ch = status & 0x0F
+            nbytes = 1 if kind in (0xC0, 0xD0) else 2
+            a = trk[i]
+            bb = trk[i + 1] if nbytes == 2 else 0
+            i += nbytes
+            if kind == 0x90 and bb > 0:
+                events.append((tick, "on", a, ch))
+            elif kind == 0x80 or (kind == 0x90 and bb == 0):
+                events.append((tick, "off", a, ch))
+    return events
+
+
+# ------------------------------------------------------------ note extraction
+def tick_to_us_fn(division, tempo_events):
+    """Piecewise-linear tick -> microseconds from the tempo map."""
+    segs = [(0, 0.0, 500000)]                    # (tick, us, us_per_quarter)
+    for tick, _, tempo, _ in sorted(tempo_events):
+        t0, us0, tq = segs[-1]
+        us = us0 + (tick - t0) * tq / division
+        if tick == t0:
+            segs[-1] = (t0, us0, tempo)
+        else:
+            segs.append((tick, us, tempo))
+
+    def conv(tick):
+        seg = segs[0]
+        for s in segs:
+            if s[0] <= tick:
+                seg = s
+            else:
+                break
+        return seg[1] + (tick - seg[0]) * seg[2] / division
+    return conv
+
+
+def skyline(notes_on_off):
+    """Reduce (tick, kind, note) events to monophonic segments
+    [(start_tick, end_tick, note)] keeping the highest sounding note."""
+    sounding = {}
+    segs = []
+    cur = None
+    cur_start = 0
+    by_tick = {}
+    for tick, kind, note in notes_on_off:
+        by_tick.setdefault(tick, []).append((kind, note))
+    for tick in sorted(by_tick):
+        for kind, note in sorted(by_tick[tick], key=lambda e: e[0] != "off"):
+            if kind == "on":
+                sounding[note] = sounding.get(note, 0) + 1
+            elif sounding.get(note):
+                sounding[note] -= 1
+                if not sounding[note]:
+                    del sounding[note]
+        top = max(sounding) if sounding else None
+        if top != cur:
+            if cur is not None and tick > cur_start:
+                segs.append((cur_start, tick, cur))
+            cur = top
+            cur_start = tick
+    return segs
+
+
+def choose_tick_us(lengths_us, tolerance):
+    """Largest multiple of 500 us that every length is (almost) a multiple of."""
+    longest = max(lengths_us)
+    k = int(min(longest, 250000) // TICK_QUANTUM_US)
+    while k > 1:
+        tick = k * TICK_QUANTUM_US
+        if all(abs(l / tick - round(l / tick)) * tick <= tolerance * tick and round(l / tick) >= 1
+               for l in lengths_us):
+            return tick
+        k -= 1
+    return TICK_QUANTUM_US
+
+
+def to_words(events, tick_us):
+    """events: [(note, start_us, end_us)] with rests already filled in."""
+    event_max = EVENT_MAX_US // tick_us
+    words = []
+    ticks_done = 0
+    for note, start_us, end_us in events:
+        end_ticks = int(round(end_us / tick_us))
+        n = end_ticks - ticks_done
+        if n <= 0:
+            continue                      # shorter than one tick: dropped
+        ticks_done = end_ticks
+        left = 0                          # ticks the current event may still tie on
+        while n > 0:
+            if note == REST or left == 0:
+                left = event_max
+                chunk = min(n, MAX_TICKS, left)
+                words.append((note, chunk))
+            else:
+                chunk = min(n, MAX_TICKS, left)
+                words.append((TIE, chunk))
+            left -= chunk
+            n -= chunk
+    # merge adjacent rests
+    limit = min(MAX_TICKS, event_max)
+    merged = []
+    for w in words:
+        if merged and w[0] == REST and merged[-1][0] == REST and merged[-1][1] + w[1] <= limit:
+            merged[-1] = (REST, merged[-1][1] + w[1])
+        else:
+            merged.append(w)
+    return merged
+
+
+def emit_c(name, source, tick_us, words, out):
+    per_line = 8
+    out.write("/*********************************************************************\n")
+    out.write("*  %s.c — generated by tools/midi2score.py from %s\n" % (name, source))
+    out.write("*  - %d words, tick = %d us (see score.h for the format)\n" % (len(words), tick_us))
+    out.write("*********************************************************************/\n\n")
+    out.write('#include "tone.h"\n\n')
+    out.write("static const score_word_t %s_notes[] = {\n" % name)
+    for i in range(0, len(words), per_line):
+        chunk = words[i:i + per_line]
+        out.write("  " + " ".join("SCORE_NOTE(%d,%d)," % w for w in chunk) + "\n")
+    out.write("  SCORE_END\n};\n")
+    out.write("const score_t %s = { SCORE_TICK_LEN(%d), %s_notes };\n" % (name, tick_us, name))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("midi")
+    ap.add_argument("--name", required=True, help="C identifier of the score_t")
+    ap.add_argument("--track", type=int, default=None, help="only this track (default: all)")
+    ap.add_argument("--channel", type=int, default=None, help="only this channel 0-15 (default: all but 9)")
+    ap.add_argument("--transpose", type=int, default=0, help="semitones added to every note")
+    ap.add_argument("--tick-us", type=int, default=None, help="force the score tick (multiple of 500)")
+    ap.add_argument("--tolerance", type=float, default=0.02,
+                    help="max quantization error per event, fraction of a tick (default 0.02)")
+    ap.add_argument("-o", "--output", default="-")
+    args = ap.parse_args()
+
+    with open(args.midi, "rb") as f:
+        division, tracks = parse_smf(f.read())
+
+    tempo = [e for t in tracks for e in t if e[1] == "tempo"]
+    to_us = tick_to_us_fn(division, tempo)
+
+    raw = []
+    for ti, t in enumerate(tracks):
+        if args.track is not None and ti != args.track:
+            continue
+        for tick, kind, note, ch in t:
+            if kind == "tempo":
+                continue
+            if args.channel is not None and ch != args.channel:
+                continue
+            if args.channel is None and ch == 9:     # GM percussion
+                continue
+            raw.append((tick, kind, note))
+    segs = skyline(raw)
+    if not segs:
+        sys.exit("no notes found")
+
+    # Segments -> (note, start_us, end_us), rests filling the gaps, time 0 = first note
+    origin = to_us(segs[0][0])
+    events = []
+    t_prev = 0.0
+    for start, end, note in segs:
+        s_us = to_us(start) - origin
+        e_us = to_us(end) - origin
+        if s_us > t_prev:
+            events.append((REST, t_prev, s_us))
+        n = note + args.transpose
+        if not 1 <= n <= 126:
+            sys.exit("note %d out of range after transpose" % n)
+        events.append((n, s_us, e_us))
+        t_prev = e_us
+
+    if args.tick_us is not None:
+        if args.tick_us % TICK_QUANTUM_US or not 0 < args.tick_us <= EVENT_MAX_US:
+            sys.exit("--tick-us must be a multiple of %d up to %d" % (TICK_QUANTUM_US, EVENT_MAX_US))
+        tick_us = args.tick_us
+    else:
+        tick_us = choose_tick_us([e - s for _, s, e in events], args.tolerance)
+
+    words = to_words(events, tick_us)
+
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    emit_c(args.name, args.midi.replace("\\", "/").split("/")[-1], tick_us, words, out)
+    if out is not sys.stdout:
+        out.close()
+
+    notes = sum(1 for n, _ in words if n not in (REST, TIE))
+    song_s = events[-1][2] / 1e6
+    nbytes = 2 * (len(words) + 1) + 8          # words + SCORE_END + score_t
+    err = max(abs(e / tick_us - round(e / tick_us)) * tick_us for _, _, e in events)
+    sys.stderr.write(
+        "%s: %d notes, %d words, %.1f s, tick %d us, max boundary error %.0f us\n"
+        "flash: %d bytes (%.2f bytes/note; the old {Hz, ms} int table was 8 bytes/note)\n"
+        % (args.name, notes, len(words), song_s, tick_us, err, nbytes, nbytes / max(notes, 1)))
+
+
+if __name__ == "__main__":
+    main()
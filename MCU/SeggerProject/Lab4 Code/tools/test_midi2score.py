@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+test_midi2score.py — E155 Lab 4: checks for tools/midi2score.py
+
+Usage:
+    python3 test_midi2score.py        (or: make -C ../host test)
+
+Builds small Standard MIDI Files in memory, converts them and reads the
+words back out of the generated C.
+"""
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOOL = os.path.join(HERE, "midi2score.py")
+sys.path.insert(0, HERE)
+import midi2score  # noqa: E402
+
+DIVISION = 480                 # ticks per quarter; 120 bpm: 1 s = 960 ticks
+
+
+def vlq(n):
+    out = [n & 0x7F]
+    n >>= 7
+    while n:
+        out.append(0x80 | (n & 0x7F))
+        n >>= 7
+    return bytes(reversed(out))
+
+
+def smf(notes):
+    """notes: [(note, start_s, end_s)] on channel 0, format 0, 120 bpm."""
+    ev = []
+    for n, s, e in notes:
+        ev.append((round(s * 2 * DIVISION), 1, bytes([0x90, n, 100])))
+        ev.append((round(e * 2 * DIVISION), 0, bytes([0x80, n, 0])))
+    trk, t = b"", 0
+    for tick, _, msg in sorted(ev):
+        trk += vlq(tick - t) + msg
+        t = tick
+    trk += vlq(0) + b"\xff\x2f\x00"
+    return (b"MThd" + (6).to_bytes(4, "big") + (0).to_bytes(2, "big") + (1).to_bytes(2, "big")
+            + DIVISION.to_bytes(2, "big") + b"MTrk" + len(trk).to_bytes(4, "big") + trk)
+
+
+def convert(notes, *args):
+    """Returns (tick_us, [(note, ticks)])."""
+    with tempfile.TemporaryDirectory() as d:
+        path = os.path.join(d, "t.mid")
+        with open(path, "wb") as f:
+            f.write(smf(notes))
+        c = subprocess.run([sys.executable, TOOL, path, "--name", "t"] + list(args),
+                           check=True, capture_output=True, text=True).stdout
+    tick_us = int(re.search(r"SCORE_TICK_LEN\((\d+)\)", c).group(1))
+    words = [(int(n), int(t)) for n, t in re.findall(r"SCORE_NOTE\((\d+),(\d+)\)", c)]
+    return tick_us, words
+
+
+def events(words):
+    """Group words as the engines do: a word plus the ties after it."""
+    out = []
+    for n, t in words:
+        if n == midi2score.TIE and out:
+            out[-1][1] += t
+        else:
+            out.append([n, t])
+    return out
+
+
+class LongEvents(unittest.TestCase):
+    def check(self, tick_us, words):
+        for n, t in words:
+            self.assertTrue(1 <= t <= midi2score.MAX_TICKS, (n, t))
+        for n, t in events(words):
+            self.assertLessEqual(t * tick_us, midi2score.EVENT_MAX_US, (n, t))
+
+    def test_sustained_note_over_33_s(self):
+        for tick in ([], ["--tick-us", "500"]):
+            tick_us, words = convert([(69, 0, 40), (72, 40, 41)], *tick)
+            self.check(tick_us, words)
+            ev = events(words)
+            self.assertEqual([n for n, _ in ev], [69, 69, 72])      # struck again once
+            self.assertEqual(sum(t for n, t in ev if n == 69) * tick_us, 40000000)
+
+    def test_rest_over_33_s(self):
+        tick_us, words = convert([(60, 0, 1), (62, 41, 42)])
+        self.check(tick_us, words)
+        self.assertEqual(sum(t for n, t in words if n == midi2score.REST) * tick_us, 40000000)
+
+    def test_short_song_unchanged(self):
+        tick_us, words = convert([(60, 0, 0.5), (64, 0.5, 1), (67, 1.5, 2)])
+        self.assertEqual(tick_us, 250000)            # the largest tick tried
+        self.assertEqual(words, [(60, 2), (64, 2), (0, 2), (67, 2)])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,98 @@
+// enc_bench.c — Lab 5: maximum edge rate each encoder mode sustains
+// TIM1 generates quadrature in hardware: CH1 (PA8) and CH2 (PA9) toggle
+// once per period at 1/4 and 3/4 of it, i.e. 2 edges per period, 90°
+// apart. A repetition-counted one-pulse burst gives an exact edge count.
+//
+// Jumpers: PA8 -> PA0 and PA6 (A), PA9 -> PA1 and PB4 (B), so both
+// modes see the same signal and can be switched at run time.
+//
+// Each rate runs one burst forward (A leading B) and one in reverse. It
+// passes when they move the position by exactly -edges and +edges, the
+// QEM16 sign in both modes, and no invalid transition was seen. The sweep for a mode stops at the
+// first failure; the previous rate is the maximum it sustains.
+
+#include "main.h"
+#include "encoder.h"
+#include "enc_bench.h"
+#include <stdio.h>
+
+#if ENC_BENCH
+
+#define GEN_A_PIN 8u   // PA8 -> TIM1_CH1 (AF1)
+#define GEN_B_PIN 9u   // PA9 -> TIM1_CH2 (AF1)
+
+static void delay_ms(uint32_t n) {
+  uint32_t t0 = ms;
+  while ((ms - t0) < n) {}
+}
+
+static void gen_init(void) {
+  RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+  RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+  uint32_t pins2 = (0x3u << (GEN_A_PIN * 2)) | (0x3u << (GEN_B_PIN * 2));
+  GPIOA->MODER   = (GPIOA->MODER & ~pins2) | (0x2u << (GEN_A_PIN * 2)) | (0x2u << (GEN_B_PIN * 2));
+  GPIOA->OSPEEDR |= pins2;                                  // very high speed
+  GPIOA->AFR[1]  = (GPIOA->AFR[1] & ~((0xFu << ((GEN_A_PIN - 8) * 4)) | (0xFu << ((GEN_B_PIN - 8) * 4))))
+                 | (0x1u << ((GEN_A_PIN - 8) * 4)) | (0x1u << ((GEN_B_PIN - 8) * 4));
+
+  TIM1->CR1   = TIM_CR1_OPM;                                // stop after RCR+1 periods
+  TIM1->PSC   = 0;
+  TIM1->CCMR1 = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC2M_2;        // forced inactive (low)
+  TIM1->CCER  = TIM_CCER_CC1E | TIM_CCER_CC2E;
+  TIM1->BDTR  = TIM_BDTR_MOE;
+}
+
+// One burst of 2*periods edges at 2*fclk/(arr+1) edges/s; returns the
+// position change. reverse swaps which channel leads.
+static int64_t gen_burst(uint32_t arr, uint32_t periods, int reverse) {
+  uint32_t q = (arr + 1u) / 4u;
+  TIM1->CCMR1 = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC2M_2;        // both low
+  TIM1->ARR   = arr;
+  TIM1->CCR1  = reverse ? 3u * q : q;
+  TIM1->CCR2  = reverse ? q : 3u * q;
+  TIM1->RCR   = periods - 1u;
+  TIM1->EGR   = TIM_EGR_UG;                                 // load RCR, CNT = 0
+  TIM1->SR    = 0;
+  delay_ms(2);                                              // pins and filters settle
+
+  int64_t p0 = enc_position();
+  TIM1->CCMR1 = TIM_CCMR1_OC1M_0 | TIM_CCMR1_OC1M_1         // toggle on match
+              | TIM_CCMR1_OC2M_0 | TIM_CCMR1_OC2M_1;
+  TIM1->CR1  |= TIM_CR1_CEN;
+  while (TIM1->CR1 & TIM_CR1_CEN) {}                        // OPM clears CEN
+  delay_ms(2);                                              // drain the ISR backlog
+  return enc_position() - p0;
+}
+
+static uint32_t sweep(enc_mode_t mode, uint32_t fclk) {
+  uint32_t edges = 2u * ENC_BENCH_PERIODS, best = 0;
+  enc_init(mode);
+  printf("\n%s mode\n  edges/s     fwd     rev  invalid  result\n",
+         (mode == ENC_MODE_TIM) ? "TIM2 encoder" : "EXTI QEM16");
+  for (uint32_t arr = 799u; arr >= 3u; arr = arr * 4u / 5u) {
+    uint32_t rate = (uint32_t)(2ull * fclk / (arr + 1u));
+    enc_reset();
+    int64_t fwd = gen_burst(arr, ENC_BENCH_PERIODS, 0);
+    int64_t rev = gen_burst(arr, ENC_BENCH_PERIODS, 1);
+    uint32_t bad = enc_invalid();
+    int ok = (fwd == -(int64_t)edges) && (rev == (int64_t)edges) && (bad == 0u);
+    printf("%9lu  %6ld  %6ld  %7lu  %s\n", (unsigned long)rate, (long)fwd, (long)rev,
+           (unsigned long)bad, ok ? "ok" : "MISCOUNT");
+    if (!ok) break;
+    best = rate;
+  }
+  return best;
+}
+
+void enc_bench_run(void) {
+  uint32_t fclk = SystemCoreClock;                          // TIM1 on APB2, prescaler 1
+  gen_init();
+  printf("Lab5 encoder stress: SYSCLK %lu Hz, %u edges per burst\n",
+         (unsigned long)fclk, 2u * ENC_BENCH_PERIODS);
+  uint32_t tim  = sweep(ENC_MODE_TIM, fclk);
+  uint32_t exti = sweep(ENC_MODE_EXTI, fclk);
+  printf("\nmax sustained edge rate: TIM %lu /s, EXTI %lu /s\n",
+         (unsigned long)tim, (unsigned long)exti);
+}
+
+#endif // ENC_BENCH
@@ -0,0 +1,14 @@
+// enc_bench.h — Lab 5: encoder stress benchmark (build with -DENC_BENCH=1)
+
+#ifndef ENC_BENCH_H
+#define ENC_BENCH_H
+
+#ifndef ENC_BENCH
+#define ENC_BENCH 0
+#endif
+
+#define ENC_BENCH_PERIODS 1000u   // generator periods per burst (2 edges each)
+
+void enc_bench_run(void);         // sweep both modes, print the table over ITM
+
+#endif // ENC_BENCH_H
@@ -0,0 +1,199 @@
+// encoder.c — Lab 5: quadrature encoder, hardware or EXTI decoding (STM32L432KC)
+// TIM mode: TIM2 encoder mode 3 counts x4 in silicon; its 32-bit counter
+// wraps into enc_hi from the update IRQ (over- or underflow).
+// EXTI mode: qdec.c decodes every axis in enc_axes[] on each edge
+// interrupt; axis 0 is this encoder and feeds the edge log.
+
+#include "main.h"
+#include "encoder.h"
+#include "qdec.h"
+
+static enc_mode_t enc_mode = ENC_MODE_EXTI;
+
+// --- Globals shared with ISRs ---
+// Writers are the encoder ISRs (one priority, never nested) and the
+// SysTick poll (IRQs off). Each update bumps `upd`; readers retry until
+// it is unchanged across their read, so they never see a torn state.
+static volatile int32_t  enc_hi = 0;        // TIM mode: position bits 63..32
+static volatile uint32_t last_edge_ms = 0;  // time of last valid edge
+static volatile uint32_t last_edge_cyc = 0; // DWT->CYCCNT of the same
+static volatile uint32_t upd = 0;           // update counter (seqlock)
+static uint32_t cnt_prev = 0;               // TIM mode: CNT at the last poll
+
+// --- Edge log: SPSC ring, EXTI ISRs produce, main consumes ---
+static enc_edge_t        edge_log[ENC_LOG_LEN];
+static volatile uint32_t log_head = 0;      // written by the ISR only
+static volatile uint32_t log_tail = 0;      // written by the consumer only
+static volatile uint32_t log_dropped = 0;   // records lost to a full ring
+
+// EXTI mode axes. Every A/B pin number must be distinct (one EXTI line each).
+static const qdec_cfg_t enc_axes[] = {
+  { ENC_A_PORT, ENC_A_PIN, ENC_B_PORT, ENC_B_PIN },   // axis 0: PA6/PB4
+};
+#define ENC_AXES (sizeof enc_axes / sizeof enc_axes[0])
+
+static inline void log_push(uint32_t t, uint8_t ab, int8_t d) {
+  uint32_t h = log_head;
+  if ((h - log_tail) >= ENC_LOG_LEN) { log_dropped++; return; }
+  enc_edge_t *e = &edge_log[h & (ENC_LOG_LEN - 1u)];
+  e->t  = t;
+  e->ab = ab;
+  e->d  = d;
+  __DMB();                                   // record before the index
+  log_head = h + 1u;
+}
+
+// qdec hook, in the EXTI ISR: axis 0 bookkeeping and edge log
+static void axis0_event(const qdec_event_t *ev) {
+  if (!(((ev->a ^ ev->a_old) | (ev->b ^ ev->b_old)) & 1u)) return;   // other axes only
+  uint8_t ab = (uint8_t)(((ev->a_old & 1u) << 3) | ((ev->b_old & 1u) << 2) |
+                         ((ev->a & 1u) << 1) | (ev->b & 1u));
+  int8_t  d  = (ev->fwd & 1u) ? +1 : (ev->rev & 1u) ? -1 : ENC_EDGE_INVALID;
+  if (d != ENC_EDGE_INVALID) { last_edge_ms = ms; last_edge_cyc = ev->t; }
+  upd++;
+  log_push(ev->t, ab, d);
+}
+
+// --- ISRs ---
+void TIM2_IRQHandler(void) {             // CNT wrapped (URS: only over/underflow)
+  if (TIM2->SR & TIM_SR_UIF) {
+    TIM2->SR = ~TIM_SR_UIF;
+    enc_hi += (TIM2->CNT < 0x80000000u) ? 1 : -1;   // near 0: overflow, near max: underflow
+    upd++;
+  }
+}
+
+// --- Init ---
+static void tim_init_encoder(void) {
+  RCC->AHB2ENR  |= RCC_AHB2ENR_GPIOAEN;
+  RCC->APB1ENR1 |= RCC_APB1ENR1_TIM2EN;
+
+  // PA0/PA1 -> AF1 (TIM2_CH1/CH2) with pull-ups
+  uint32_t pins2 = (0x3u << (ENC_TIM_A_PIN * 2)) | (0x3u << (ENC_TIM_B_PIN * 2));
+  GPIOA->MODER  = (GPIOA->MODER & ~pins2) | (0x2u << (ENC_TIM_A_PIN * 2)) | (0x2u << (ENC_TIM_B_PIN * 2));
+  GPIOA->PUPDR  = (GPIOA->PUPDR & ~pins2) | (0x1u << (ENC_TIM_A_PIN * 2)) | (0x1u << (ENC_TIM_B_PIN * 2));
+  GPIOA->AFR[0] = (GPIOA->AFR[0] & ~((0xFu << (ENC_TIM_A_PIN * 4)) | (0xFu << (ENC_TIM_B_PIN * 4))))
+                | (0x1u << (ENC_TIM_A_PIN * 4)) | (0x1u << (ENC_TIM_B_PIN * 4));
+
+  TIM2->CR1   = 0;
+  TIM2->SMCR  = (TIM2->SMCR & ~TIM_SMCR_SMS) | TIM_SMCR_SMS_0 | TIM_SMCR_SMS_1;   // encoder mode 3: x4
+  TIM2->CCMR1 = (0x1u << TIM_CCMR1_CC1S_Pos) | (0x1u << TIM_CCMR1_CC2S_Pos)       // IC1=TI1, IC2=TI2
+              | (ENC_TIM_ICF << TIM_CCMR1_IC1F_Pos) | (ENC_TIM_ICF << TIM_CCMR1_IC2F_Pos);
+  TIM2->CCER  = TIM_CCER_CC1P;                   // TI1 inverted: A leading B counts down, as QEM16
+  TIM2->PSC   = 0;
+  TIM2->ARR   = 0xFFFFFFFFu;
+  TIM2->CR1   = TIM_CR1_URS;                     // UG does not raise UIF
+  TIM2->EGR   = TIM_EGR_UG;
+  TIM2->CNT   = 0;
+  TIM2->SR    = 0;
+  TIM2->DIER  = TIM_DIER_UIE;
+  NVIC_SetPriority(TIM2_IRQn, ENC_IRQ_PRIO);
+  NVIC_EnableIRQ(TIM2_IRQn);
+  TIM2->CR1  |= TIM_CR1_CEN;
+}
+
+static void enc_disable(void) {
+  qdec_stop();
+  NVIC_DisableIRQ(TIM2_IRQn);
+  TIM2->CR1  &= ~TIM_CR1_CEN;
+  TIM2->DIER  = 0;
+}
+
+void enc_init(enc_mode_t mode) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  // edge timestamps
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  enc_disable();
+  enc_mode = mode;
+  if (mode == ENC_MODE_TIM) {
+    tim_init_encoder();
+  } else {
+    qdec_init(enc_axes, ENC_AXES, axis0_event);
+  }
+  enc_reset();
+}
+
+void enc_reset(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (enc_mode == ENC_MODE_TIM) {
+    TIM2->CNT = 0;
+    TIM2->SR  = ~TIM_SR_UIF;
+    cnt_prev  = 0;
+  } else {
+    qdec_reset();                            // all axes = 0, resync to the pins
+  }
+  enc_hi        = 0;
+  last_edge_ms  = ms;
+  last_edge_cyc = DWT->CYCCNT;
+  log_tail      = log_head;                  // drop logged edges
+  log_dropped   = 0;
+  upd++;
+  __set_PRIMASK(primask);
+}
+
+// Position only; a read racing an update is retried (see `upd`).
+// A wrap the update IRQ has not folded in yet is still flagged in SR.
+static int64_t position_raw(void) {
+  if (enc_mode != ENC_MODE_TIM) return qdec_count(0);
+  int32_t  hi = enc_hi;
+  uint32_t lo = TIM2->CNT;
+  if (TIM2->SR & TIM_SR_UIF) {
+    lo  = TIM2->CNT;
+    hi += (lo < 0x80000000u) ? 1 : -1;
+  }
+  return (int64_t)(((uint64_t)(uint32_t)hi << 32) | lo);
+}
+
+int64_t enc_position(void) {
+  uint32_t u;
+  int64_t  pos;
+  do {
+    u   = upd;
+    pos = position_raw();
+  } while (u != upd);
+  return pos;
+}
+
+void enc_snapshot(enc_snapshot_t *s) {
+  uint32_t u;
+  do {
+    u = upd;
+    s->position = position_raw();
+    s->edge_ms  = last_edge_ms;
+    s->edge_cyc = last_edge_cyc;
+    s->invalid  = enc_invalid();
+  } while (u != upd);
+  s->log_dropped = log_dropped;
+}
+
+uint32_t enc_log_read(enc_edge_t *dst, uint32_t max) {
+  uint32_t t = log_tail;
+  uint32_t n = log_head - t;
+  __DMB();                                   // index before the records
+  if (n > max) n = max;
+  for (uint32_t i = 0; i < n; i++) dst[i] = edge_log[(t + i) & (ENC_LOG_LEN - 1u)];
+  __DMB();
+  log_tail = t + n;
+  return n;
+}
+
+uint32_t enc_log_dropped(void) { return log_dropped; }
+
+uint32_t enc_last_edge_ms(void) { return last_edge_ms; }
+
+uint32_t enc_invalid(void) { return (enc_mode == ENC_MODE_TIM) ? 0u : qdec_errors(0); }
+
+// TIM mode has no per-edge interrupt; note the time the count last moved
+void enc_poll_1ms(void) {
+  if (enc_mode != ENC_MODE_TIM) return;
+  uint32_t c = TIM2->CNT;
+  if (c != cnt_prev) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();                         // readers may preempt SysTick
+    cnt_prev = c;
+    last_edge_ms  = ms;
+    last_edge_cyc = DWT->CYCCNT;
+    upd++;
+    __set_PRIMASK(primask);
+  }
+}
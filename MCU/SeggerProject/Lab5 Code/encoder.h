@@ -0,0 +1,80 @@
+// encoder.h — Lab 5: quadrature encoder, hardware or EXTI decoding (STM32L432KC)
+//
+// ENC_MODE_TIM : A/B on TIM2_CH1/CH2 in encoder mode 3 (x4), the timer
+//                counts every edge, an update IRQ extends it to 64 bits
+// ENC_MODE_EXTI: A/B on EXTI lines, decoded with every other axis of
+//                enc_axes[] (encoder.c) by qdec.c (fallback). This API is
+//                axis 0; qdec_count(i)/qdec_errors(i) read the others.
+//
+// EXTI mode also logs every edge (DWT timestamp, AB transition, decode
+// result) into a single-producer/single-consumer ring that one consumer,
+// normally the main loop, drains in batches with enc_log_read().
+//
+// The two modes use different pins (PA6/PB4 share no timer), so the
+// encoder can be wired to both sets at once and switched at run time.
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+
+// --- EXTI mode pins ---
+#define ENC_A_PORT GPIOA
+#define ENC_A_PIN  6u      // PA6 -> EXTI6
+#define ENC_B_PORT GPIOB
+#define ENC_B_PIN  4u      // PB4 -> EXTI4
+
+// --- TIM mode pins (AF1) ---
+#define ENC_TIM_A_PIN 0u   // PA0 -> TIM2_CH1
+#define ENC_TIM_B_PIN 1u   // PA1 -> TIM2_CH2
+
+// Input filter for TIM mode (ICxF): 2 = fCK_INT, N=4. An edge must be
+// stable 4 timer clocks, which caps the edge rate at fCK_INT/4 per channel.
+#ifndef ENC_TIM_ICF
+#define ENC_TIM_ICF 2u
+#endif
+
+#define ENC_PPR_X1 120
+#define ENC_CPR_X4 (4 * ENC_PPR_X1)
+
+#ifndef ENC_IRQ_PRIO
+#define ENC_IRQ_PRIO 0u    // TIM2; keep equal to QDEC_IRQ_PRIO so they never nest
+#endif
+
+#ifndef ENC_LOG_LEN
+#define ENC_LOG_LEN 256u   // edge log records, power of 2
+#endif
+
+typedef enum { ENC_MODE_EXTI = 0, ENC_MODE_TIM = 1 } enc_mode_t;
+
+#define ENC_EDGE_INVALID 2 // enc_edge_t.d: both channels changed
+
+typedef struct {
+  uint32_t t;              // DWT->CYCCNT at ISR entry
+  uint8_t  ab;             // (old A<<1|B) << 2 | new A<<1|B
+  int8_t   d;              // +1, -1, ENC_EDGE_INVALID
+} enc_edge_t;
+
+typedef struct {
+  int64_t  position;       // x4 counts
+  uint32_t edge_ms;        // ms of the last count change
+  uint32_t edge_cyc;       // DWT->CYCCNT of the same (TIM mode: 1 ms poll)
+  uint32_t invalid;        // double-step transitions
+  uint32_t log_dropped;    // edge records lost to a full log
+} enc_snapshot_t;
+
+#ifndef ENC_MODE
+#define ENC_MODE ENC_MODE_TIM
+#endif
+
+void     enc_init(enc_mode_t mode);    // (re)configure; position restarts at 0
+void     enc_reset(void);              // position = 0, resync to the pins
+int64_t  enc_position(void);           // x4 counts, consistent 64-bit read
+void     enc_snapshot(enc_snapshot_t *s);  // position and edge time, consistent
+uint32_t enc_log_read(enc_edge_t *dst, uint32_t max);  // drain, returns count
+uint32_t enc_log_dropped(void);
+uint32_t enc_last_edge_ms(void);       // ms of the last count change
+uint32_t enc_invalid(void);            // EXTI mode: double-step transitions seen
+void     enc_poll_1ms(void);           // call from SysTick (TIM mode edge time)
+
+#endif // ENCODER_H
@@ -0,0 +1,11 @@
+// main.h — Lab 5: shared globals (STM32L432KC)
+
+#ifndef MAIN_H
+#define MAIN_H
+
+#include "stm32l432xx.h"
+#include <stdint.h>
+
+extern volatile uint32_t ms;         // SysTick ms
+
+#endif // MAIN_H
@@ -0,0 +1,161 @@
+// qdec.c — Lab 5: table-driven quadrature decoder for N encoders on EXTI (STM32L432KC)
+
+#include "main.h"
+#include "qdec.h"
+
+// 16-entry transition table: idx=(old<<2)|curr; +1 fwd, -1 rev, 0 invalid
+const int8_t QEM16[16] = {
+  /*old=00*/  0, +1, -1,  0,
+  /*old=01*/ -1,  0,  0, +1,
+  /*old=10*/ +1,  0,  0, -1,
+  /*old=11*/  0, -1, +1,  0
+};
+
+// --- Configuration (set by qdec_init) ---
+static GPIO_TypeDef *ports[3];               // distinct ports in use
+static uint32_t n_ports = 0, n_enc = 0;
+static uint8_t  a_port[QDEC_MAX], a_pin[QDEC_MAX];   // port index, pin
+static uint8_t  b_port[QDEC_MAX], b_pin[QDEC_MAX];
+static uint32_t line_mask = 0;               // EXTI lines in use
+static qdec_hook_t hook = 0;
+
+// --- Decoder state (ISR-owned; `seq` bumps on every update) ---
+static uint32_t a_old = 0, b_old = 0;
+static volatile int64_t  count[QDEC_MAX];
+static volatile uint32_t errors[QDEC_MAX];
+static volatile uint32_t seq = 0;
+
+static int port_index(GPIO_TypeDef *p) {
+  for (uint32_t i = 0; i < n_ports; i++) if (ports[i] == p) return (int)i;
+  if (n_ports == 3u) return -1;
+  ports[n_ports] = p;
+  return (int)n_ports++;
+}
+
+static uint32_t exticr_code(GPIO_TypeDef *p) {   // SYSCFG_EXTICR port field
+  return (p == GPIOA) ? 0u : (p == GPIOB) ? 1u : 2u;
+}
+
+static IRQn_Type exti_irqn(uint32_t line) {
+  if (line <= 4u) return (IRQn_Type)(EXTI0_IRQn + (int)line);   // EXTI0..4 are consecutive
+  return (line <= 9u) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+}
+
+static void pin_init(GPIO_TypeDef *p, uint32_t pin) {
+  p->MODER &= ~(0x3u << (pin * 2));                                    // input
+  p->PUPDR  = (p->PUPDR & ~(0x3u << (pin * 2))) | (0x1u << (pin * 2)); // PU
+
+  RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;          // route EXTI
+  uint32_t sh = (pin % 4u) * 4u;
+  SYSCFG->EXTICR[pin / 4u] = (SYSCFG->EXTICR[pin / 4u] & ~(0xFu << sh)) | (exticr_code(p) << sh);
+}
+
+int qdec_init(const qdec_cfg_t *cfg, uint32_t n, qdec_hook_t h) {
+  qdec_stop();
+  if (n == 0u || n > QDEC_MAX) return -1;
+
+  uint32_t lines = 0;
+  n_ports = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t la = 1u << cfg[i].a_pin, lb = 1u << cfg[i].b_pin;
+    if ((lines & la) || (lines & lb) || la == lb) return -1;       // EXTI line taken
+    lines |= la | lb;
+    int pa = port_index(cfg[i].a_port), pb = port_index(cfg[i].b_port);
+    if (pa < 0 || pb < 0) return -1;
+    a_port[i] = (uint8_t)pa;  a_pin[i] = cfg[i].a_pin;
+    b_port[i] = (uint8_t)pb;  b_pin[i] = cfg[i].b_pin;
+  }
+
+  RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN | RCC_AHB2ENR_GPIOBEN | RCC_AHB2ENR_GPIOCEN;
+  for (uint32_t i = 0; i < n; i++) {
+    pin_init(cfg[i].a_port, cfg[i].a_pin);
+    pin_init(cfg[i].b_port, cfg[i].b_pin);
+  }
+  n_enc     = n;
+  line_mask = lines;
+  hook      = h;
+  qdec_reset();
+
+  EXTI->RTSR1 |= lines;                          // rising
+  EXTI->FTSR1 |= lines;                          // falling
+  EXTI->PR1    = lines;                          // clear pending
+  EXTI->IMR1  |= lines;                          // unmask
+  for (uint32_t l = 0; l < 16u; l++) {
+    if (!(lines & (1u << l))) continue;
+    NVIC_SetPriority(exti_irqn(l), QDEC_IRQ_PRIO);
+    NVIC_EnableIRQ(exti_irqn(l));
+  }
+  return 0;
+}
+
+void qdec_stop(void) {
+  EXTI->IMR1 &= ~line_mask;
+  line_mask = 0;
+}
+
+void qdec_sample(qdec_event_t *ev) {
+  uint32_t idr[3], a = 0, b = 0;
+  for (uint32_t p = 0; p < n_ports; p++) idr[p] = ports[p]->IDR;
+  for (uint32_t i = 0; i < n_enc; i++) {
+    a |= ((idr[a_port[i]] >> a_pin[i]) & 1u) << i;
+    b |= ((idr[b_port[i]] >> b_pin[i]) & 1u) << i;
+  }
+  ev->a = a;
+  ev->b = b;
+}
+
+void qdec_decode(qdec_event_t *ev) {
+  uint32_t chA = ev->a ^ a_old, chB = ev->b ^ b_old, x = ev->a ^ ev->b;
+  uint32_t inv = chA & chB;
+  uint32_t fwd = ((chB & x) | (chA & ~x)) & ~inv;
+  uint32_t rev = ((chB & ~x) | (chA & x)) & ~inv;
+  ev->a_old = a_old;  ev->b_old = b_old;
+  ev->fwd = fwd;  ev->rev = rev;  ev->inv = inv;
+  a_old = ev->a;  b_old = ev->b;
+
+  for (; fwd; fwd &= fwd - 1u) count[31u - __CLZ(fwd & -fwd)]++;
+  for (; rev; rev &= rev - 1u) count[31u - __CLZ(rev & -rev)]--;
+  for (; inv; inv &= inv - 1u) errors[31u - __CLZ(inv & -inv)]++;
+  seq++;
+}
+
+void qdec_irq(void) {
+  qdec_event_t ev;
+  ev.t = DWT->CYCCNT;
+  uint32_t pr = EXTI->PR1 & line_mask;
+  if (!pr) return;                       // already handled by another vector
+  EXTI->PR1 = pr;                        // clear before sampling: later edges re-pend
+  qdec_sample(&ev);
+  qdec_decode(&ev);
+  if (hook) hook(&ev);
+}
+
+void qdec_reset(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  qdec_event_t ev;
+  qdec_sample(&ev);                      // seed
+  a_old = ev.a;
+  b_old = ev.b;
+  for (uint32_t i = 0; i < QDEC_MAX; i++) { count[i] = 0; errors[i] = 0; }
+  seq++;
+  __set_PRIMASK(primask);
+}
+
+int64_t qdec_count(uint32_t i) {
+  uint32_t s;
+  int64_t  c;
+  do { s = seq; c = count[i]; } while (s != seq);
+  return c;
+}
+
+uint32_t qdec_errors(uint32_t i) { return errors[i]; }
+
+// --- ISRs: every line funnels into one decode of all encoders ---
+void EXTI0_IRQHandler(void)     { qdec_irq(); }
+void EXTI1_IRQHandler(void)     { qdec_irq(); }
+void EXTI2_IRQHandler(void)     { qdec_irq(); }
+void EXTI3_IRQHandler(void)     { qdec_irq(); }
+void EXTI4_IRQHandler(void)     { qdec_irq(); }
+void EXTI9_5_IRQHandler(void)   { qdec_irq(); }
+void EXTI15_10_IRQHandler(void) { qdec_irq(); }
@@ -0,0 +1,52 @@
+// qdec.h — Lab 5: table-driven quadrature decoder for N encoders on EXTI (STM32L432KC)
+//
+// Each event samples every used port's IDR once, gathers the A and B
+// levels into one bit per encoder and decodes all encoders at once:
+//   chA = a ^ a_old, chB = b ^ b_old, x = a ^ b
+//   fwd = (chB & x) | (chA & ~x)     QEM16 +1 (exactly one channel changed)
+//   rev = (chB & ~x) | (chA & x)     QEM16 -1
+//   inv = chA & chB                  both changed: an edge was lost
+// which is QEM16 evaluated for every encoder in parallel.
+//
+// Every A/B pin needs its own EXTI line, so all pin numbers must differ
+// (line n belongs to one port). All EXTI vectors used run at
+// QDEC_IRQ_PRIO and never nest.
+
+#ifndef QDEC_H
+#define QDEC_H
+
+#include "stm32l432xx.h"
+#include <stdint.h>
+
+#define QDEC_MAX 8u        // 16 EXTI lines, 2 per encoder
+
+#ifndef QDEC_IRQ_PRIO
+#define QDEC_IRQ_PRIO 0u
+#endif
+
+typedef struct {
+  GPIO_TypeDef *a_port;  uint8_t a_pin;
+  GPIO_TypeDef *b_port;  uint8_t b_pin;
+} qdec_cfg_t;
+
+typedef struct {
+  uint32_t t;              // DWT->CYCCNT at ISR entry
+  uint32_t a, b;           // new levels, bit i = encoder i
+  uint32_t a_old, b_old;   // levels before this event
+  uint32_t fwd, rev, inv;  // decode result per encoder
+} qdec_event_t;
+
+typedef void (*qdec_hook_t)(const qdec_event_t *ev);   // called from the ISR
+
+extern const int8_t QEM16[16];   // reference table, idx = (old<<2)|new, A<<1|B
+
+int      qdec_init(const qdec_cfg_t *cfg, uint32_t n, qdec_hook_t hook);  // 0, or -1: bad table
+void     qdec_stop(void);                 // mask all lines
+void     qdec_reset(void);                // counts/errors = 0, resync to the pins
+void     qdec_sample(qdec_event_t *ev);   // ev->a, ev->b from one IDR read per port
+void     qdec_decode(qdec_event_t *ev);   // a/b in; old, fwd/rev/inv out; counts updated
+int64_t  qdec_count(uint32_t i);          // x4 counts of encoder i, consistent read
+uint32_t qdec_errors(uint32_t i);         // invalid transitions of encoder i
+void     qdec_irq(void);                  // body of every EXTI handler
+
+#endif // QDEC_H
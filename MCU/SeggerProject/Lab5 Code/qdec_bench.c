@@ -0,0 +1,109 @@
+// qdec_bench.c — Lab 5: ISR cycles versus number of encoders
+// 1. Checks the bit-parallel decode against QEM16 for all 16 transitions
+//    on every lane.
+// 2. For N = 1..7 encoders (table below, pins idle):
+//      isr     EXTI entry + qdec_irq + exit, triggered through SWIER1
+//      decode  qdec_decode with no lane moving / with every lane stepping
+//      qem16   the old per-encoder path: two pin reads + table per axis
+// Cycles from DWT->CYCCNT, mean of QDEC_BENCH_REPS, timer overhead removed.
+
+#include "main.h"
+#include "qdec.h"
+#include "qdec_bench.h"
+#include <stdio.h>
+
+#if QDEC_BENCH
+
+// Every pin number distinct; skips PA13/PA14 (SWD) and PB3 (SWO)
+static const qdec_cfg_t bench_axes[] = {
+  { GPIOA,  6, GPIOB, 4 }, { GPIOA,  0, GPIOA,  1 }, { GPIOA, 2, GPIOA, 3 },
+  { GPIOA,  8, GPIOA, 9 }, { GPIOA, 10, GPIOA, 11 }, { GPIOA, 12, GPIOB, 5 },
+  { GPIOA, 15, GPIOB, 7 },
+};
+#define BENCH_AXES (sizeof bench_axes / sizeof bench_axes[0])
+
+static uint8_t qem_state[QDEC_MAX];
+static int64_t qem_count[QDEC_MAX];
+
+static void qem16_all(uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t a = (bench_axes[i].a_port->IDR >> bench_axes[i].a_pin) & 1u;
+    uint8_t b = (bench_axes[i].b_port->IDR >> bench_axes[i].b_pin) & 1u;
+    uint8_t curr = (uint8_t)((a << 1) | b);
+    qem_count[i] += QEM16[(qem_state[i] << 2) | curr];
+    qem_state[i] = curr;
+  }
+}
+
+static int check_qem16(void) {
+  int bad = 0;
+  for (uint32_t lane = 0; lane < QDEC_MAX; lane++)
+    for (uint32_t o = 0; o < 4u; o++)
+      for (uint32_t n = 0; n < 4u; n++) {
+        qdec_event_t ev;
+        ev.a = ((o >> 1) & 1u) << lane;  ev.b = (o & 1u) << lane;
+        qdec_decode(&ev);
+        ev.a = ((n >> 1) & 1u) << lane;  ev.b = (n & 1u) << lane;
+        qdec_decode(&ev);
+        int d = (ev.fwd >> lane & 1u) ? 1 : (ev.rev >> lane & 1u) ? -1 : 0;
+        int inv = (int)(ev.inv >> lane & 1u);
+        if (d != QEM16[(o << 2) | n] || inv != ((o ^ n) == 3u)) bad++;
+      }
+  return bad;
+}
+
+void qdec_bench_run(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  uint32_t t0 = DWT->CYCCNT, ovh = DWT->CYCCNT - t0;   // back-to-back reads
+
+  qdec_init(bench_axes, BENCH_AXES, 0);
+  int bad = check_qem16();
+  printf("Lab5 qdec: SYSCLK %lu Hz, bit-parallel vs QEM16: %s (%d mismatches)\n",
+         (unsigned long)SystemCoreClock, bad ? "FAIL" : "ok", bad);
+  printf(" N   isr cyc  decode idle  decode all-step  qem16 cyc\n");
+
+  static const uint8_t gray[4] = { 0, 1, 3, 2 };       // A<<1|B, one step each
+  for (uint32_t n = 1; n <= BENCH_AXES; n++) {
+    uint32_t isr = 0, idle = 0, step = 0, qem = 0;
+    uint32_t all = (1u << n) - 1u, sw = 1u << bench_axes[0].a_pin;
+    qdec_init(bench_axes, n, 0);
+
+    for (uint32_t r = 0; r < QDEC_BENCH_REPS; r++) {
+      t0 = DWT->CYCCNT;
+      EXTI->SWIER1 = sw;                 // pends the line like an edge would
+      __DSB(); __ISB();
+      isr += DWT->CYCCNT - t0 - ovh;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    qdec_event_t ev;
+    for (uint32_t r = 0; r < QDEC_BENCH_REPS; r++) {
+      qdec_sample(&ev);
+      t0 = DWT->CYCCNT;
+      qdec_decode(&ev);
+      idle += DWT->CYCCNT - t0 - ovh;
+
+      uint8_t g = gray[r & 3u];
+      ev.a = (g & 2u) ? all : 0u;
+      ev.b = (g & 1u) ? all : 0u;
+      t0 = DWT->CYCCNT;
+      qdec_decode(&ev);
+      step += DWT->CYCCNT - t0 - ovh;
+
+      t0 = DWT->CYCCNT;
+      qem16_all(n);
+      qem += DWT->CYCCNT - t0 - ovh;
+    }
+    __set_PRIMASK(primask);
+
+    printf("%2lu  %8lu  %11lu  %15lu  %9lu\n", (unsigned long)n,
+           (unsigned long)(isr / QDEC_BENCH_REPS), (unsigned long)(idle / QDEC_BENCH_REPS),
+           (unsigned long)(step / QDEC_BENCH_REPS), (unsigned long)(qem / QDEC_BENCH_REPS));
+  }
+  qdec_stop();
+}
+
+#endif // QDEC_BENCH
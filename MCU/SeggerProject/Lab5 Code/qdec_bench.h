@@ -0,0 +1,14 @@
+// qdec_bench.h — Lab 5: multi-encoder decoder cost (build with -DQDEC_BENCH=1)
+
+#ifndef QDEC_BENCH_H
+#define QDEC_BENCH_H
+
+#ifndef QDEC_BENCH
+#define QDEC_BENCH 0
+#endif
+
+#define QDEC_BENCH_REPS 64u       // timed runs per measurement
+
+void qdec_bench_run(void);        // check against QEM16, print cycles vs N
+
+#endif // QDEC_BENCH_H
@@ -0,0 +1,57 @@
+// telemetry.c — Lab 5: binary telemetry over ITM/SWO (STM32L432KC)
+
+#include "main.h"
+#include "encoder.h"
+#include "telemetry.h"
+#include <string.h>
+
+#define TLM_PORT_MASK ((1u << TLM_PORT_TEXT) | (1u << TLM_PORT_INFO) | (1u << TLM_PORT_ENC) | \
+                       (1u << TLM_PORT_EDGE))
+
+static uint8_t seq[32];                    // per-port record counter
+
+// Stimulus port reads 1 when its FIFO slot is free
+static inline void itm_u8(uint32_t port, uint8_t v) {
+  while (ITM->PORT[port].u32 == 0u) {}
+  ITM->PORT[port].u8 = v;
+}
+
+static inline void itm_u32(uint32_t port, uint32_t w) {
+  while (ITM->PORT[port].u32 == 0u) {}
+  ITM->PORT[port].u32 = w;
+}
+
+void tlm_init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  ITM->LAR = 0xC5ACCE55u;                  // unlock ITM register writes
+  ITM->TER |= TLM_PORT_MASK;               // the probe enables port 0 only
+}
+
+void tlm_record(uint32_t port, const uint32_t *w, uint32_t n) {
+  uint32_t t = DWT->CYCCNT;
+  if (!(ITM->TCR & ITM_TCR_ITMENA_Msk) || !(ITM->TER & (1u << port))) return;   // no probe
+  itm_u8(port, seq[port]++);
+  itm_u32(port, t);
+  for (uint32_t i = 0; i < n; i++) itm_u32(port, w[i]);
+}
+
+void tlm_info(void) {
+  uint32_t w[TLM_INFO_WORDS] = { SystemCoreClock, ENC_CPR_X4, ENC_MODE, ENC_VEL_PERIOD_US };
+  tlm_record(TLM_PORT_INFO, w, TLM_INFO_WORDS);
+}
+
+void tlm_enc(const enc_state_t *s) {
+  uint32_t w[TLM_ENC_WORDS];
+  uint64_t p = (uint64_t)s->position;
+  w[0] = (uint32_t)p;
+  w[1] = (uint32_t)(p >> 32);
+  memcpy(&w[2], &s->velocity, sizeof w[2]);   // raw IEEE-754 bits, no formatting
+  w[3] = s->age_us;
+  tlm_record(TLM_PORT_ENC, w, TLM_ENC_WORDS);
+}
+
+void tlm_edge(const enc_edge_t *e) {
+  uint32_t w[TLM_EDGE_WORDS] = { e->t, (uint32_t)e->ab | ((uint32_t)(uint8_t)e->d << 8) };
+  tlm_record(TLM_PORT_EDGE, w, TLM_EDGE_WORDS);
+}
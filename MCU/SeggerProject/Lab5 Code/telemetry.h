@@ -0,0 +1,41 @@
+// telemetry.h — Lab 5: binary telemetry over ITM/SWO (STM32L432KC)
+//
+// Each record type has its own stimulus port. A record is one 8-bit write
+// (sequence number: marks the start, exposes drops) followed by 32-bit
+// words: DWT cycle timestamp, then the payload. Port 0 stays text (printf).
+// Decode a raw SWO capture with tools/swo2csv.py.
+//
+// One writer context per port: records on a port are not interleaved
+// with each other, so do not emit the same type from main and an ISR.
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "encoder.h"
+#include "velocity.h"
+
+// Port, payload words (after the timestamp). Keep tools/swo2csv.py in sync.
+#define TLM_PORT_TEXT 0u
+#define TLM_PORT_INFO 1u   // sysclk_hz, cpr_x4, enc mode, sample period us
+#define TLM_PORT_ENC  2u   // pos lo, pos hi, velocity (float bits), age_us
+#define TLM_PORT_EDGE 3u   // edge cycles, ab | d << 8 (one per logged edge)
+#define TLM_INFO_WORDS 4u
+#define TLM_ENC_WORDS  4u
+#define TLM_EDGE_WORDS 2u
+
+#ifndef TLM_PERIOD_MS
+#define TLM_PERIOD_MS 1u   // encoder record rate (1 kHz)
+#endif
+
+#ifndef TLM_EDGES
+#define TLM_EDGES 0        // 1: forward the EXTI edge log (17 bytes per edge)
+#endif
+
+void tlm_init(void);       // enable the ports and the cycle counter
+void tlm_record(uint32_t port, const uint32_t *w, uint32_t n);
+void tlm_info(void);
+void tlm_enc(const enc_state_t *s);
+void tlm_edge(const enc_edge_t *e);
+
+#endif // TELEMETRY_H
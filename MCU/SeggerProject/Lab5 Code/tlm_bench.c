@@ -0,0 +1,67 @@
+// tlm_bench.c — Lab 5: cycles per report, printf text vs binary telemetry
+// Times the same encoder report three ways with DWT->CYCCNT:
+//   snprintf      float formatting alone
+//   printf        formatting + _write() + ITM_SendChar per byte (old path)
+//   tlm_enc       binary record, 32-bit stimulus writes
+// Stalls on a full ITM FIFO are included, so the printf and tlm numbers
+// depend on the SWO clock the probe configured; wire bytes are reported
+// so they can be scaled (each ITM packet is 1 header byte + payload).
+
+#include "main.h"
+#include "encoder.h"
+#include "telemetry.h"
+#include "tlm_bench.h"
+#include <stdio.h>
+
+#if TLM_BENCH
+
+typedef struct { uint32_t min, max, sum; } cyc_t;
+
+static void cyc_add(cyc_t *c, uint32_t d) {
+  if (d < c->min) c->min = d;
+  if (d > c->max) c->max = d;
+  c->sum += d;
+}
+
+static void cyc_print(const char *name, const cyc_t *c, uint32_t wire_bytes) {
+  printf("%-10s %8lu %8lu %8lu %10lu\n", name, (unsigned long)c->min,
+         (unsigned long)(c->sum / TLM_BENCH_N), (unsigned long)c->max, (unsigned long)wire_bytes);
+}
+
+#define REPORT_FMT "vel=%0.5f rev/s  dir=%s  age=%lu us  (dticks=%ld)\n"
+
+void tlm_bench_run(void) {
+  cyc_t fmt = { UINT32_MAX, 0, 0 }, txt = fmt, bin = fmt;
+  enc_state_t st = { 123456, 1234.5f, 87u };
+  char buf[96];
+  int  len = 0;
+
+  tlm_init();
+  tlm_info();
+  for (uint32_t i = 0; i < TLM_BENCH_N; i++) {
+    st.position += 7;
+    st.velocity += 0.25f;
+    float rps = st.velocity / (float)ENC_CPR_X4;
+
+    uint32_t t0 = DWT->CYCCNT;
+    len = snprintf(buf, sizeof buf, REPORT_FMT, (double)rps, "FWD", (unsigned long)st.age_us, 7L);
+    cyc_add(&fmt, DWT->CYCCNT - t0);
+
+    t0 = DWT->CYCCNT;
+    printf(REPORT_FMT, (double)rps, "FWD", (unsigned long)st.age_us, 7L);
+    cyc_add(&txt, DWT->CYCCNT - t0);
+
+    t0 = DWT->CYCCNT;
+    tlm_enc(&st);
+    cyc_add(&bin, DWT->CYCCNT - t0);
+  }
+
+  printf("\nLab5 telemetry cost: SYSCLK %lu Hz, %u reports per path\n",
+         (unsigned long)SystemCoreClock, TLM_BENCH_N);
+  printf("path       min cyc  mean cyc  max cyc  wire bytes\n");
+  cyc_print("snprintf", &fmt, 0);
+  cyc_print("printf",   &txt, 2u * (uint32_t)len);
+  cyc_print("tlm_enc",  &bin, 2u + 5u * (1u + TLM_ENC_WORDS));
+}
+
+#endif // TLM_BENCH
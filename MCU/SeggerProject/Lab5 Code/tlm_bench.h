@@ -0,0 +1,14 @@
+// tlm_bench.h — Lab 5: telemetry cost benchmark (build with -DTLM_BENCH=1)
+
+#ifndef TLM_BENCH_H
+#define TLM_BENCH_H
+
+#ifndef TLM_BENCH
+#define TLM_BENCH 0
+#endif
+
+#define TLM_BENCH_N 64u           // reports timed per path
+
+void tlm_bench_run(void);         // print cycles per report for each path
+
+#endif // TLM_BENCH_H
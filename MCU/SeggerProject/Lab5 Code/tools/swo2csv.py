@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+swo2csv.py — E155 Lab 5: decode a raw SWO capture of the binary telemetry
+
+Usage:
+    python3 swo2csv.py capture.swo              # writes capture_enc.csv, capture_info.csv
+    python3 swo2csv.py capture.swo -o run1_     # writes run1_enc.csv, ...
+    python3 swo2csv.py capture.swo --clock 80000000
+
+The input is the ITM byte stream as the probe delivers it (TPIU formatter
+off, e.g. J-Link SWO or `tpiu config ... uart off` in OpenOCD). Text on
+stimulus port 0 (printf) goes to stderr.
+
+Record format (see telemetry.h): on the record's own port, one 8-bit
+write with a sequence number, then 32-bit words: DWT cycle timestamp,
+payload. Timestamps are unwrapped to 64 bits and converted to seconds
+with the clock from the INFO record (or --clock).
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+
+PORT_TEXT = 0
+RECORDS = {
+    # port: (name, payload words, CSV columns after t_cycles, t_s, seq)
+    1: ("info", 4, ["sysclk_hz", "cpr_x4", "enc_mode", "vel_period_us"]),
+    2: ("enc", 4, ["pos", "vel_cps", "vel_rps", "age_us"]),
+    3: ("edge", 2, ["edge_cycles", "ab_old", "ab_new", "result"]),
+}
+
+
+# ------------------------------------------------------------ ITM packets
+def itm_packets(data):
+    """Yield ('sw', port, size, value) for stimulus packets and
+    ('overflow',) for overflow packets; everything else is skipped."""
+    i = 0
+    n = len(data)
+    while i < n:
+        h = data[i]
+        i += 1
+        if h == 0x00:                               # sync: zeros then 0x80
+            while i < n and data[i] == 0x00:
+                i += 1
+            if i < n and data[i] == 0x80:
+                i += 1
+            continue
+        if h == 0x70:
+            yield ("overflow",)
+            continue
+        size = h & 0x03
+        if size:                                    # source packet
+            nbytes = (1, 2, 4)[size - 1]
+            payload = data[i:i + nbytes]
+            i += nbytes
+            if len(payload) < nbytes:
+                return
+            if not h & 0x04:                        # software (stimulus port)
+                yield ("sw", h >> 3, nbytes, int.from_bytes(payload, "little"))
+            continue
+        # protocol packets: timestamps and extensions, with continuation bytes
+        if h & 0x80 or h in (0x94, 0xB4):
+            while i < n and data[i] & 0x80:
+                i += 1
+            i += 1
+
+
+# ------------------------------------------------------------ records
+class Decoder:
+    def __init__(self, clock):
+        self.clock = clock
+        self.cpr = None
+        self.t_full = None                          # last timestamp, unwrapped
+        self.open = {}                              # port -> [seq, words]
+        self.last_seq = {}
+        self.rows = {name: [] for name, _, _ in RECORDS.values()}
+        self.dropped = 0
+        self.overflows = 0
+        self.partial = 0
+        self.text = bytearray()
+
+    def unwrap(self, t):
+        """Records from different ports may be slightly out of order, so
+        only a forward step (mod 2^32) advances the reference."""
+        if self.t_full is None:
+            self.t_full = t
+            return t
+        d = (t - self.t_full) & 0xFFFFFFFF
+        if d < 1 << 31:
+            self.t_full += d
+            return self.t_full
+        return self.t_full - ((1 << 32) - d)
+
+    @staticmethod
+    def unwrap_edge(t_edge, t_rec):
+        """Edge time from the ISR, unwrapped against the (later) record time."""
+        return t_rec - ((t_rec - t_edge) & 0xFFFFFFFF)
+
+    def feed(self, pkt):
+        if pkt[0] == "overflow":
+            self.overflows += 1
+            return
+        _, port, size, value = pkt
+        if port == PORT_TEXT:
+            if size == 1:
+                self.text.append(value)
+            return
+        if port not in RECORDS:
+            return
+        if size == 1:                               # record start
+            if port in self.open:
+                self.partial += 1
+            prev = self.last_seq.get(port)
+            if prev is not None:
+                self.dropped += (value - prev - 1) & 0xFF
+            self.last_seq[port] = value
+            self.open[port] = [value, []]
+            return
+        if size != 4 or port not in self.open:
+            return                                  # mid-record at capture start
+        rec = self.open[port]
+        rec[1].append(value)
+        nwords = RECORDS[port][1]
+        if len(rec[1]) == 1 + nwords:
+            del self.open[port]
+            self.emit(port, rec[0], rec[1])
+
+    def emit(self, port, seq, words):
+        name = RECORDS[port][0]
+        t = self.unwrap(words[0])
+        p = words[1:]
+        if name == "info":
+            self.clock = self.clock or p[0]
+            self.cpr = p[1]
+            fields = p
+        elif name == "edge":
+            d = struct.unpack("<b", bytes([(p[1] >> 8) & 0xFF]))[0]
+            fields = [self.unwrap_edge(p[0], t), (p[1] >> 2) & 3, p[1] & 3,
+                      "invalid" if d == 2 else d]
+        else:
+            pos = struct.unpack("<q", struct.pack("<II", p[0], p[1]))[0]
+            vel = struct.unpack("<f", struct.pack("<I", p[2]))[0]
+            rps = vel / self.cpr if self.cpr else ""
+            fields = [pos, "%.6g" % vel, "%.6g" % rps if rps != "" else "", p[3]]
+        t_s = "%.9f" % (t / self.clock) if self.clock else ""
+        self.rows[name].append([t, t_s, seq] + list(fields))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("capture")
+    ap.add_argument("-o", "--prefix", default=None,
+                    help="output prefix (default: capture name + '_')")
+    ap.add_argument("--clock", type=int, default=None,
+                    help="core clock in Hz if the capture has no INFO record")
+    args = ap.parse_args()
+
+    with open(args.capture, "rb") as f:
+        data = f.read()
+    prefix = args.prefix
+    if prefix is None:
+        prefix = os.path.splitext(args.capture)[0] + "_"
+
+    dec = Decoder(args.clock)
+    for pkt in itm_packets(data):
+        dec.feed(pkt)
+
+    for name, _, cols in RECORDS.values():
+        rows = dec.rows[name]
+        if not rows:
+            continue
+        path = prefix + name + ".csv"
+        with open(path, "w", newline="") as f:
+            w = csv.writer(f)
+            w.writerow(["t_cycles", "t_s", "seq"] + cols)
+            w.writerows(rows)
+        sys.stderr.write("%s: %d records\n" % (path, len(rows)))
+
+    if dec.text:
+        sys.stderr.write(dec.text.decode("utf-8", "replace"))
+    sys.stderr.write("dropped %d records, %d ITM overflows, %d truncated\n"
+                     % (dec.dropped, dec.overflows, dec.partial))
+    if dec.clock is None:
+        sys.stderr.write("no INFO record and no --clock: t_s left empty\n")
+
+
+if __name__ == "__main__":
+    main()
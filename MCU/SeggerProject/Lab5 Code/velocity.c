@@ -0,0 +1,135 @@
+// velocity.c — Lab 5: M/T velocity estimate from input-capture edge times (STM32L432KC)
+
+#include "main.h"
+#include "encoder.h"
+#include "velocity.h"
+
+#define VEL_A_PIN 2u   // PA2 -> TIM15_CH1 (AF14)
+#define VEL_B_PIN 3u   // PA3 -> TIM15_CH2 (AF14)
+
+typedef struct { int64_t p; uint32_t t; } vel_snap_t;
+
+// --- State (owned by the TIM6 ISR) ---
+static uint32_t   now_t = 0;           // TIM15 time unwrapped to 32 bits
+static uint16_t   now16 = 0;           // TIM15->CNT at the last sample
+static vel_snap_t hist[VEL_HIST];      // newest edge snapshots, ring
+static uint32_t   n_hist = 0, head = 0;
+static uint32_t   t_last = 0;          // time of the newest edge
+static volatile float    v_est = 0.0f; // x4 counts/s
+static volatile uint32_t t_est = 0;    // time velocity refers to
+
+// Newest snapshot at least ENC_VEL_SPAN_US before s (or the oldest one)
+static void vel_update(const vel_snap_t *s) {
+  for (uint32_t k = 1; k < n_hist; k++) {
+    const vel_snap_t *o = &hist[(head + VEL_HIST - k) % VEL_HIST];
+    int64_t  dn = s->p - o->p;
+    uint32_t dt = s->t - o->t;
+    if (dt == 0u) continue;
+    if ((dt >= ENC_VEL_SPAN_US || k == n_hist - 1u) &&
+        (dn >= ENC_VEL_MIN_COUNTS || dn <= -ENC_VEL_MIN_COUNTS)) {
+      v_est = (float)dn * ((float)VEL_TICK_HZ / (float)dt);
+      t_est = s->t;
+      return;
+    }
+  }
+}
+
+static void vel_sample(void) {
+  int edge = (TIM15->SR & TIM_SR_CC1IF) != 0;
+  uint16_t c1 = 0;
+  int64_t  p  = 0;
+  if (edge) {                          // reading CCR1 clears CC1IF
+    TIM15->SR = ~TIM_SR_CC1OF;
+    do { c1 = (uint16_t)TIM15->CCR1; p = enc_position(); } while ((uint16_t)TIM15->CCR1 != c1);
+  }
+  uint16_t n = (uint16_t)TIM15->CNT;   // after the capture read: c1 is in the past
+  now_t += (uint16_t)(n - now16);
+  now16  = n;
+
+  if (edge) {
+    uint32_t te = now_t - (uint16_t)(n - c1);
+    if ((te - t_last) >= ENC_VEL_STOP_US) n_hist = 0;   // restart after a stop
+    t_last = te;
+    hist[head].p = p;
+    hist[head].t = te;
+    head = (head + 1u) % VEL_HIST;
+    if (n_hist < VEL_HIST) n_hist++;
+    vel_update(&hist[(head + VEL_HIST - 1u) % VEL_HIST]);
+    return;
+  }
+
+  uint32_t idle = now_t - t_last;      // no edge since the last sample
+  if (idle >= ENC_VEL_STOP_US) {
+    if (v_est != 0.0f) { v_est = 0.0f; t_est = now_t; }
+  } else if (idle > 0u) {
+    float vmax = (float)VEL_TICK_HZ / (float)idle;
+    if      (v_est >  vmax) { v_est =  vmax; t_est = now_t; }
+    else if (v_est < -vmax) { v_est = -vmax; t_est = now_t; }
+  }
+}
+
+// --- ISRs ---
+void TIM6_DAC_IRQHandler(void) {       // sample tick
+  if (TIM6->SR & TIM_SR_UIF) {
+    TIM6->SR = ~TIM_SR_UIF;
+    vel_sample();
+  }
+}
+
+// --- Init ---
+static void tim15_init_capture(void) {
+  RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+  RCC->APB2ENR |= RCC_APB2ENR_TIM15EN;
+
+  // PA2/PA3 -> AF14 (TIM15_CH1/CH2) with pull-ups
+  uint32_t pins2 = (0x3u << (VEL_A_PIN * 2)) | (0x3u << (VEL_B_PIN * 2));
+  GPIOA->MODER  = (GPIOA->MODER & ~pins2) | (0x2u << (VEL_A_PIN * 2)) | (0x2u << (VEL_B_PIN * 2));
+  GPIOA->PUPDR  = (GPIOA->PUPDR & ~pins2) | (0x1u << (VEL_A_PIN * 2)) | (0x1u << (VEL_B_PIN * 2));
+  GPIOA->AFR[0] = (GPIOA->AFR[0] & ~((0xFu << (VEL_A_PIN * 4)) | (0xFu << (VEL_B_PIN * 4))))
+                | (0xEu << (VEL_A_PIN * 4)) | (0xEu << (VEL_B_PIN * 4));
+
+  TIM15->CR1   = 0;
+  TIM15->CR2   = TIM_CR2_TI1S;                          // TI1 = CH1 xor CH2: every edge
+  TIM15->CCMR1 = (0x1u << TIM_CCMR1_CC1S_Pos)           // IC1 = TI1, same filter as TIM2
+               | (ENC_TIM_ICF << TIM_CCMR1_IC1F_Pos);
+  TIM15->CCER  = TIM_CCER_CC1P | TIM_CCER_CC1NP | TIM_CCER_CC1E;   // both edges
+  TIM15->PSC   = SystemCoreClock / VEL_TICK_HZ - 1u;
+  TIM15->ARR   = 0xFFFFu;
+  TIM15->EGR   = TIM_EGR_UG;
+  TIM15->SR    = 0;
+  TIM15->CR1   = TIM_CR1_CEN;
+}
+
+static void tim6_init_sample(void) {
+  RCC->APB1ENR1 |= RCC_APB1ENR1_TIM6EN;
+  TIM6->CR1  = 0;
+  TIM6->PSC  = SystemCoreClock / VEL_TICK_HZ - 1u;
+  TIM6->ARR  = ENC_VEL_PERIOD_US - 1u;
+  TIM6->CR1  = TIM_CR1_URS;
+  TIM6->EGR  = TIM_EGR_UG;
+  TIM6->SR   = 0;
+  TIM6->DIER = TIM_DIER_UIE;
+  NVIC_SetPriority(TIM6_DAC_IRQn, 1);  // below the encoder IRQs
+  NVIC_EnableIRQ(TIM6_DAC_IRQn);
+  TIM6->CR1 |= TIM_CR1_CEN;
+}
+
+void vel_init(void) {
+  NVIC_DisableIRQ(TIM6_DAC_IRQn);
+  n_hist = 0; head = 0;
+  v_est  = 0.0f;
+  tim15_init_capture();
+  now_t  = 0; now16 = 0;
+  t_last = 0; t_est = 0;
+  tim6_init_sample();
+}
+
+void vel_get(enc_state_t *s) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t t = now_t + (uint16_t)((uint16_t)TIM15->CNT - now16);
+  s->position = enc_position();
+  s->velocity = v_est;
+  s->age_us   = (t - t_est) / (VEL_TICK_HZ / 1000000u);
+  __set_PRIMASK(primask);
+}
@@ -0,0 +1,49 @@
+// velocity.h — Lab 5: M/T velocity estimate from input-capture edge times (STM32L432KC)
+//
+// TIM15 runs free at 1 MHz and captures the time of every quadrature edge:
+// A on PA2 (TIM15_CH1) and B on PA3 (TIM15_CH2), XORed into IC1 (TI1S),
+// both polarities. No interrupt per edge: CCR1 just holds the latest one.
+//
+// Every ENC_VEL_PERIOD_US, TIM6 samples (position, time of last edge)
+// together. Velocity = counts between two edge snapshots / time between
+// those edges, over the newest pair at least ENC_VEL_SPAN_US apart:
+//   fast: many counts per span, error <= 2 us / span (timer quantization)
+//   slow: fewer than one edge per span, it is the time between edges
+// Between edges |v| is bounded by 1 count / (time since the last edge),
+// so the estimate decays while stopping; after ENC_VEL_STOP_US it is 0.
+//
+// The encoder is wired to PA2/PA3 in addition to the pins of its counting
+// mode (see encoder.h). Call vel_init() after enc_init().
+
+#ifndef VELOCITY_H
+#define VELOCITY_H
+
+#include <stdint.h>
+
+#define VEL_TICK_HZ 1000000u        // TIM15 timestamp clock (1 us)
+
+#ifndef ENC_VEL_PERIOD_US
+#define ENC_VEL_PERIOD_US 250u      // sample period (TIM6)
+#endif
+#ifndef ENC_VEL_SPAN_US
+#define ENC_VEL_SPAN_US   1000u     // min edge-to-edge span per estimate
+#endif
+#ifndef ENC_VEL_MIN_COUNTS
+#define ENC_VEL_MIN_COUNTS 1        // 4 averages out quadrature phase error
+#endif
+#ifndef ENC_VEL_STOP_US
+#define ENC_VEL_STOP_US   100000u   // no edge this long -> velocity 0
+#endif
+
+#define VEL_HIST 8u                 // edge snapshots kept (> span / period)
+
+typedef struct {
+  int64_t  position;   // x4 counts, now
+  float    velocity;   // x4 counts/s
+  uint32_t age_us;     // time since the newest edge (or bound) behind velocity
+} enc_state_t;
+
+void vel_init(void);
+void vel_get(enc_state_t *s);
+
+#endif // VELOCITY_H